@@ -1,5 +1,6 @@
 #include "Particle.h"
 #include "CellularHelper.h"
+#include "CellularHelperCommandStats.h"
 
 // STARTUP(cellular_credentials_set("epc.tmobile.com", "", "", NULL));
 
@@ -43,9 +44,13 @@ State state = STARTUP_WAIT_STATE;
 unsigned long stateTime = 0;
 bool buttonClicked = false;
 
+// How long each modem command takes, logged after the tests
+CellularHelperCommandStatsStatic<24> commandStats;
+
 void setup() {
 	Serial.begin(9600);
 	System.on(button_click, buttonHandler);
+	CellularHelper.setCommandStats(&commandStats);
 }
 
 void loop() {
@@ -246,6 +251,14 @@ void runCellularTests() {
 	CellularHelperLocationResponse locResp = CellularHelper.getLocation();
 	Log.info(locResp.toString());
 
+	// The same information as above, except location, using one command line for most of it
+	unsigned long start = millis();
+	CellularHelperDiagnostics diag;
+	CellularHelper.getDiagnostics(CellularHelperDiagnostics::FIELD_ALL, diag);
+	Log.info("diagnostics took %lu ms", millis() - start);
+	diag.logDiagnostics();
+
+	commandStats.logStats();
 }
 
 void buttonHandler(system_event_t event, int param) {
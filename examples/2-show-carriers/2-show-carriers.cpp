@@ -1,5 +1,6 @@
 #include "Particle.h"
 #include "CellularHelper.h"
+#include "CellularHelperOperatorDB.h"
 
 // STARTUP(cellular_credentials_set("epc.tmobile.com", "", "", NULL));
 
@@ -27,7 +28,8 @@ enum State {
 State state = STARTUP_WAIT_STATE;
 unsigned long stateTime = 0;
 bool buttonClicked = false;
-CellularHelperEnvironmentResponseStatic<32> envResp;
+// Neighbors are stored packed (16 bytes each instead of 48) to save RAM
+CellularHelperEnvironmentResponsePackedStatic<32> envResp;
 
 void setup() {
 	Serial.begin(9600);
@@ -86,141 +88,13 @@ void loop() {
 	}
 }
 
-class OperatorName {
-public:
-	int mcc;
-	int mnc;
-	String name;
-};
-
-class CellularHelperCOPNResponse : public CellularHelperCommonResponse {
-public:
-	CellularHelperCOPNResponse();
-
-	void requestOperator(CellularHelperEnvironmentCellData *data);
-	void requestOperator(int mcc, int mnc);
-	void checkOperator(char *buf);
-	const char *getOperatorName(int mcc, int mnc) const;
-
-	virtual int parse(int type, const char *buf, int len);
-
-	// Maximum number of operator names that can be looked up
-	static const size_t MAX_OPERATORS = 16;
-
-private:
-	size_t numOperators;
-	OperatorName operators[MAX_OPERATORS];
-};
-CellularHelperCOPNResponse copnResp;
-
-
-CellularHelperCOPNResponse::CellularHelperCOPNResponse() : numOperators(0) {
-
-}
+// Operator names from AT+COPN. Only the countries found in the scan are stored.
+CellularHelperOperatorIndexStatic<256, 2048> operatorIndex;
 
-void CellularHelperCOPNResponse::requestOperator(CellularHelperEnvironmentCellData *data) {
+void addMCCFilter(const CellularHelperEnvironmentCellData *data) {
 	if (data && data->isValid(true)) {
-		requestOperator(data->mcc, data->mnc);
-	}
-}
-
-void CellularHelperCOPNResponse::requestOperator(int mcc, int mnc) {
-	for(size_t ii = 0; ii < numOperators; ii++) {
-		if (operators[ii].mcc == mcc && operators[ii].mnc == mnc) {
-			// Already requested
-			return;
-		}
-	}
-	if (numOperators < MAX_OPERATORS) {
-		// There is room to request another
-		operators[numOperators].mcc = mcc;
-		operators[numOperators].mnc = mnc;
-		numOperators++;
-	}
-}
-
-const char *CellularHelperCOPNResponse::getOperatorName(int mcc, int mnc) const {
-	for(size_t ii = 0; ii < numOperators; ii++) {
-		if (operators[ii].mcc == mcc && operators[ii].mnc == mnc) {
-			return operators[ii].name.c_str();
-		}
+		operatorIndex.addMCCFilter(data->mcc);
 	}
-	return "unknown";
-}
-
-
-void CellularHelperCOPNResponse::checkOperator(char *buf) {
-	if (buf[0] == '"') {
-		char *numStart = &buf[1];
-		char *numEnd = strchr(numStart, '"');
-		if (numEnd && ((numEnd - numStart) == 6)) {
-			char temp[4];
-			temp[3] = 0;
-			strncpy(temp, numStart, 3);
-			int mcc = atoi(temp);
-
-			strncpy(temp, numStart + 3, 3);
-			int mnc = atoi(temp);
-
-			*numEnd = 0;
-			char *nameStart = strchr(numEnd + 1, '"');
-			if (nameStart) {
-				nameStart++;
-				char *nameEnd = strchr(nameStart, '"');
-				if (nameEnd) {
-					*nameEnd = 0;
-
-					// Log.info("mcc=%d mnc=%d name=%s", mcc, mnc, nameStart);
-
-					for(size_t ii = 0; ii < numOperators; ii++) {
-						if (operators[ii].mcc == mcc && operators[ii].mnc == mnc) {
-							operators[ii].name = String(nameStart);
-						}
-					}
-				}
-			}
-		}
-	}
-}
-
-
-int CellularHelperCOPNResponse::parse(int type, const char *buf, int len) {
-	if (enableDebug) {
-		logCellularDebug(type, buf, len);
-	}
-	if (type == TYPE_PLUS) {
-		// Copy to temporary string to make processing easier
-		char *copy = (char *) malloc(len + 1);
-		if (copy) {
-			strncpy(copy, buf, len);
-			copy[len] = 0;
-
-			/*
-			 	0000018684 [app] INFO: +COPN: "901012","MCP Maritime Com"\r\n
-				0000018694 [app] INFO: cellular response type=TYPE_PLUS len=28
-				0000018694 [app] INFO: \r\n
-				0000018695 [app] INFO: +COPN: "901021","Seanet"\r\n
-				0000018705 [app] INFO: cellular response type=TYPE_ERROR len=39
-				0000018705 [app] INFO: \r\n
-			 *
-			 */
-
-			char *start = strstr(copy, "\n+COPN: ");
-			if (start) {
-				start += 8; // length of COPN string
-
-				char *end = strchr(start, '\r');
-				if (end) {
-					*end = 0;
-
-					checkOperator(start);
-				}
-			}
-
-			free(copy);
-		}
-	}
-	return WAIT;
 }
 
 void printCellData(CellularHelperEnvironmentCellData *data) {
@@ -228,7 +102,14 @@ void printCellData(CellularHelperEnvironmentCellData *data) {
 
 	// Log.info("mcc=%d mnc=%d", data->mcc, data->mnc);
 
-	const char *operatorName = copnResp.getOperatorName(data->mcc, data->mnc);
+	const char *operatorName = operatorIndex.getOperatorName(data->mcc, data->mnc);
+	if (!operatorName) {
+		// Fall back to the built-in table
+		operatorName = CellularHelperOperatorDB::getOperatorName(*data);
+	}
+	if (!operatorName) {
+		operatorName = "unknown";
+	}
 
 	Serial.printlnf("%s %s %s %d bars (%03d%03d)", whichG, operatorName, data->getBandString().c_str(), data->getBars(), data->mcc, data->mnc);
 }
@@ -244,10 +125,12 @@ void cellularScan() {
 	if (envResp.resp == RESP_OK) {
 		envResp.logResponse();
 
-		copnResp.requestOperator(&envResp.service);
-		if (envResp.neighbors) {
-			for(size_t ii = 0; ii < envResp.numNeighbors; ii++) {
-				copnResp.requestOperator(&envResp.neighbors[ii]);
+		operatorIndex.clearMCCFilter();
+		addMCCFilter(&envResp.service);
+		for(size_t ii = 0; ii < envResp.numNeighbors; ii++) {
+			CellularHelperEnvironmentCellData neighbor;
+			if (envResp.getNeighbor(ii, neighbor)) {
+				addMCCFilter(&neighbor);
 			}
 		}
 	}
@@ -255,17 +138,21 @@ void cellularScan() {
 
 	Log.info("looking up operator names...");
 
-	copnResp.enableDebug = false;
-	copnResp.resp = Cellular.command(CellularHelperClass::responseCallback, (void *)&copnResp, 120000, "AT+COPN\r\n");
+	// The names are kept, so AT+COPN (which takes about 2 minutes) only runs again if the
+	// serving operator is not already in the index
+	if (!operatorIndex.getOperatorName(envResp.service.mcc, envResp.service.mnc)) {
+		operatorIndex.clear();
+		CellularHelper.getOperatorIndex(operatorIndex);
+		Log.info("operators=%u arenaUsed=%u dropped=%u", operatorIndex.getNumOperators(), operatorIndex.getArenaUsed(), operatorIndex.getNumDropped());
+	}
 
 	Log.info("results...");
 
 	printCellData(&envResp.service);
-	if (envResp.neighbors) {
-		for(size_t ii = 0; ii < envResp.numNeighbors; ii++) {
-			if (envResp.neighbors[ii].isValid(true /* ignoreCI */)) {
-				printCellData(&envResp.neighbors[ii]);
-			}
+	for(size_t ii = 0; ii < envResp.numNeighbors; ii++) {
+		CellularHelperEnvironmentCellData neighbor;
+		if (envResp.getNeighbor(ii, neighbor)) {
+			printCellData(&neighbor);
 		}
 	}
 
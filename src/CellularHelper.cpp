@@ -1,6 +1,11 @@
 #include "Particle.h"
 
+#include <limits.h>
+
 #include "CellularHelper.h"
+#include "CellularHelperCommandStats.h"
+#include "CellularHelperRegistrationMonitor.h"
+#include "CellularHelperResultQueue.h"
 
 // This check is here so it can be a library dependency for a library that's compiled for both
 // cellular and Wi-Fi.
@@ -9,91 +14,132 @@
 
 CellularHelperClass CellularHelper;
 
-void CellularHelperCommonResponse::logCellularDebug(int type, const char *buf, int len) const {
-	String typeStr;
-	switch(type) {
-	case TYPE_UNKNOWN:
-		typeStr = "TYPE_UNKNOWN";
-		break;
-
-	case TYPE_OK:
-		typeStr = "TYPE_OK";
-		break;
-
-	case TYPE_ERROR:
-		typeStr = "TYPE_ERROR";
-		break;
-
-	case TYPE_RING:
-		typeStr = "TYPE_ERROR";
-		break;
-
-	case TYPE_CONNECT:
-		typeStr = "TYPE_CONNECT";
-		break;
-
-	case TYPE_NOCARRIER:
-		typeStr = "TYPE_NOCARRIER";
-		break;
+static const struct {
+	int type;
+	const char *name;
+} typeNames[] = {
+	{ TYPE_UNKNOWN, "TYPE_UNKNOWN" },
+	{ TYPE_OK, "TYPE_OK" },
+	{ TYPE_ERROR, "TYPE_ERROR" },
+	{ TYPE_RING, "TYPE_RING" },
+	{ TYPE_CONNECT, "TYPE_CONNECT" },
+	{ TYPE_NOCARRIER, "TYPE_NOCARRIER" },
+	{ TYPE_NODIALTONE, "TYPE_NODIALTONE" },
+	{ TYPE_BUSY, "TYPE_BUSY" },
+	{ TYPE_NOANSWER, "TYPE_NOANSWER" },
+	{ TYPE_PROMPT, "TYPE_PROMPT" },
+	{ TYPE_PLUS, "TYPE_PLUS" },
+	{ TYPE_TEXT, "TYPE_TEXT" },
+	{ TYPE_ABORTED, "TYPE_ABORTED" }
+};
+
+void CellularHelperCommonResponse::setDebugBudget(size_t maxBytes, size_t maxLines) {
+	enableDebug = true;
+	debugMaxBytes = maxBytes;
+	debugMaxLines = maxLines;
+	debugBytes = 0;
+	debugLines = 0;
+	debugSuppressed = 0;
+}
 
-	case TYPE_NODIALTONE:
-		typeStr = "TYPE_NODIALTONE";
-		break;
+void CellularHelperCommonResponse::logCellularDebug(int type, const char *buf, int len) {
+	if (!buf || len < 0) {
+		return;
+	}
 
-	case TYPE_BUSY:
-		typeStr = "TYPE_BUSY";
-		break;
+	if (isDebugBudgetUsed()) {
+		suppressDebug((size_t)len);
+		return;
+	}
 
-	case TYPE_NOANSWER:
-		typeStr = "TYPE_NOANSWER";
-		break;
+	const char *typeName = getTypeName(type);
+	if (typeName) {
+		Log.info("cellular response type=%s len=%d", typeName, len);
+	}
+	else {
+		Log.info("cellular response type=0x%x len=%d", type, len);
+	}
+	debugLines++;
+
+	char line[DEBUG_LINE_SIZE];
+	size_t offset = 0;
+	while(offset < (size_t)len) {
+		// The budget is checked before each line, so a line that starts within it is logged in full
+		if (isDebugBudgetUsed()) {
+			suppressDebug((size_t)len - offset);
+			break;
+		}
 
-	case TYPE_PROMPT:
-		typeStr = "TYPE_PROMPT";
-		break;
+		size_t start = offset;
+		escapeDebugLine(line, sizeof(line), buf, (size_t)len, offset);
+		Log.info("%s", line);
 
-	case TYPE_PLUS:
-		typeStr = "TYPE_PLUS";
-		break;
+		debugBytes += offset - start;
+		debugLines++;
+	}
+}
 
-	case TYPE_TEXT:
-		typeStr = "TYPE_PLUS";
-		break;
+bool CellularHelperCommonResponse::isDebugBudgetUsed() const {
+	return (debugMaxBytes != 0 && debugBytes >= debugMaxBytes) || (debugMaxLines != 0 && debugLines >= debugMaxLines);
+}
 
-	case TYPE_ABORTED:
-		typeStr = "TYPE_ABORTED";
-		break;
+void CellularHelperCommonResponse::suppressDebug(size_t bytes) {
+	if (debugSuppressed == 0) {
+		Log.info("cellular debug budget used (%u bytes, %u lines), not logging the rest", (unsigned int)debugBytes, (unsigned int)debugLines);
+	}
+	debugSuppressed += bytes;
+}
 
-	default:
-		typeStr = String::format("type=0x%x", type);
-		break;
+// [static]
+const char *CellularHelperCommonResponse::getTypeName(int type) {
+	for(size_t ii = 0; ii < sizeof(typeNames) / sizeof(typeNames[0]); ii++) {
+		if (typeNames[ii].type == type) {
+			return typeNames[ii].name;
+		}
 	}
+	return NULL;
+}
 
-	Log.info("cellular response type=%s len=%d", typeStr.c_str(), len);
-	String out;
-	for(int ii = 0; ii < len; ii++) {
-		if (buf[ii] == '\n') {
-			out += "\\n";
-			Log.info(out);
-			out = "";
+// [static]
+size_t CellularHelperCommonResponse::escapeDebugLine(char *line, size_t lineSize, const char *buf, size_t len, size_t &offset) {
+	static const char hexDigits[] = "0123456789abcdef";
+
+	// Leave room for the longest escape (\xNN) and the null terminator
+	size_t lineLen = 0;
+	while(offset < len && lineLen + 5 <= lineSize) {
+		// Copy runs of printable characters in bulk
+		size_t runEnd = offset;
+		size_t maxRun = lineSize - 1 - lineLen;
+		while(runEnd < len && runEnd - offset < maxRun && buf[runEnd] >= ' ' && buf[runEnd] < 127) {
+			runEnd++;
 		}
-		else
-		if (buf[ii] == '\r') {
-			out += "\\r";
+		if (runEnd > offset) {
+			memcpy(&line[lineLen], &buf[offset], runEnd - offset);
+			lineLen += runEnd - offset;
+			offset = runEnd;
+			continue;
+		}
+
+		// Compare as unsigned so bytes >= 0x80 aren't negative
+		unsigned char c = (unsigned char) buf[offset++];
+		line[lineLen++] = '\\';
+		if (c == '\r') {
+			line[lineLen++] = 'r';
 		}
 		else
-		if (buf[ii] < ' ' || buf[ii] >= 127) {
-			char hex[10];
-			snprintf(hex, sizeof(hex), "0x%02x", buf[ii]);
-			out.concat(hex);
+		if (c == '\n') {
+			line[lineLen++] = 'n';
+			break;
 		}
 		else {
-			out.concat(buf[ii]);
+			line[lineLen++] = 'x';
+			line[lineLen++] = hexDigits[c >> 4];
+			line[lineLen++] = hexDigits[c & 0xf];
 		}
 	}
-	if (out.length() > 0) {
-		Log.info(out);
-	}
+	line[lineLen] = 0;
+
+	return lineLen;
 }
 
 
@@ -115,31 +161,11 @@ int CellularHelperPlusStringResponse::parse(int type, const char *buf, int len)
 		logCellularDebug(type, buf, len);
 	}
 	if (type == TYPE_PLUS) {
-		// Copy to temporary string to make processing easier
-		char *copy = (char *) malloc(len + 1);
-		if (copy) {
-			strncpy(copy, buf, len);
-			copy[len] = 0;
-
-			// We return the parts of the + response corresponding to the command we requested
-			char searchFor[32];
-			snprintf(searchFor, sizeof(searchFor), "\n+%s: ", command.c_str());
-
-			//Log.info("searching for: +%s:", command.c_str());
-
-			char *start = strstr(copy, searchFor);
-			if (start) {
-				start += strlen(searchFor);
-
-				char *end = strchr(start, '\r');
-				CellularHelperClass::appendBufferToString(string, start, end - start);
-				//Log.info("found %s", string.c_str());
-			}
-			else {
-				//Log.info("not found");
-			}
-
-			free(copy);
+		// We return the parts of the + response corresponding to the command we requested
+		size_t valueLen;
+		const char *value = CellularHelperClass::findPlusResponse(buf, len, command.c_str(), command.length(), valueLen);
+		if (value) {
+			CellularHelperClass::appendBufferToString(string, value, (int)valueLen);
 		}
 	}
 	return WAIT;
@@ -169,9 +195,168 @@ String CellularHelperPlusStringResponse::getDoubleQuotedPart(bool onlyFirst) con
 	return result;
 }
 
+CellularHelperPlusBufferResponse::CellularHelperPlusBufferResponse(char *buffer, size_t bufferSize) :
+	buffer(buffer), bufferSize(bufferSize) {
+	clear();
+}
+
+void CellularHelperPlusBufferResponse::setCommand(const char *command) {
+	this->command = command;
+	commandLen = strlen(command);
+}
+
+void CellularHelperPlusBufferResponse::clear() {
+	length = 0;
+	if (buffer && bufferSize) {
+		buffer[0] = 0;
+	}
+}
+
+int CellularHelperPlusBufferResponse::parse(int type, const char *buf, int len) {
+	if (enableDebug) {
+		logCellularDebug(type, buf, len);
+	}
+	if (type == TYPE_PLUS && buffer && bufferSize) {
+		size_t valueLen;
+		const char *value = CellularHelperClass::findPlusResponse(buf, len, command, commandLen, valueLen);
+		if (value) {
+			length = CellularHelperClass::appendBufferToBuffer(buffer, bufferSize, length, value, (int)valueLen);
+		}
+	}
+	return WAIT;
+}
+
+CellularHelperFieldParser::CellularHelperFieldParser(const char *buf, size_t len) : cur(buf), end(buf + len) {
+}
+
+CellularHelperFieldParser::CellularHelperFieldParser(const char *str) : cur(str), end(str + strlen(str)) {
+}
+
+bool CellularHelperFieldParser::nextInt(int &value, int base) {
+	const char *field;
+	size_t fieldLen;
+
+	if (!nextField(field, fieldLen)) {
+		return false;
+	}
+	return parseInt(field, fieldLen, base, value);
+}
+
+bool CellularHelperFieldParser::nextFloat(float &value) {
+	const char *field;
+	size_t fieldLen;
+
+	if (!nextField(field, fieldLen)) {
+		return false;
+	}
+
+	// strtod needs a null terminated string, so copy the field to the stack. Numbers in modem
+	// responses are much shorter than this.
+	char num[24];
+	if (fieldLen >= sizeof(num)) {
+		fieldLen = sizeof(num) - 1;
+	}
+	memcpy(num, field, fieldLen);
+	num[fieldLen] = 0;
+
+	char *numEnd;
+	double result = strtod(num, &numEnd);
+	if (numEnd == num) {
+		return false;
+	}
+	value = (float)result;
+	return true;
+}
+
+bool CellularHelperFieldParser::skipField() {
+	const char *field;
+	size_t fieldLen;
+
+	return nextField(field, fieldLen);
+}
+
+bool CellularHelperFieldParser::nextField(const char *&field, size_t &fieldLen) {
+	if (cur >= end) {
+		return false;
+	}
+
+	field = cur;
+	const char *comma = (const char *)memchr(cur, ',', end - cur);
+	const char *fieldEnd = comma ? comma : end;
+	cur = comma ? comma + 1 : end;
+
+	while(field < fieldEnd && *field == ' ') {
+		field++;
+	}
+	if (field < fieldEnd && *field == '"') {
+		field++;
+	}
+
+	fieldLen = fieldEnd - field;
+	return true;
+}
+
+bool CellularHelperFieldParser::isNextQuoted() const {
+	const char *field = cur;
+	while(field < end && *field == ' ') {
+		field++;
+	}
+	return field < end && *field == '"';
+}
+
+// [static]
+bool CellularHelperFieldParser::parseInt(const char *buf, size_t len, int base, int &value) {
+	const char *end = buf + len;
+	bool negative = false;
+	bool hasDigits = false;
+	unsigned result = 0;
+
+	while(buf < end && *buf == ' ') {
+		buf++;
+	}
+	if (buf < end && (*buf == '-' || *buf == '+')) {
+		negative = (*buf == '-');
+		buf++;
+	}
+	for(; buf < end; buf++) {
+		int digit;
+		char ch = *buf;
+		if (ch >= '0' && ch <= '9') {
+			digit = ch - '0';
+		}
+		else
+		if (ch >= 'a' && ch <= 'f') {
+			digit = ch - 'a' + 10;
+		}
+		else
+		if (ch >= 'A' && ch <= 'F') {
+			digit = ch - 'A' + 10;
+		}
+		else {
+			break;
+		}
+		if (digit >= base) {
+			break;
+		}
+		// Saturate instead of overflowing on a garbled value
+		if (result <= (unsigned)(INT_MAX - digit) / base) {
+			result = result * base + digit;
+		}
+		else {
+			result = INT_MAX;
+		}
+		hasDigits = true;
+	}
+	if (hasDigits) {
+		value = negative ? -(int)result : (int)result;
+	}
+	return hasDigits;
+}
 
 void CellularHelperRSSIQualResponse::postProcess() {
-	if (sscanf(string.c_str(), "%d,%d", &rssi, &qual) == 2) {
+	CellularHelperFieldParser parser(string.c_str(), string.length());
+
+	if (parser.nextInt(rssi) && parser.nextInt(qual)) {
 
 		// The range is the following:
 		// 0: -113 dBm or less
@@ -179,7 +364,7 @@ void CellularHelperRSSIQualResponse::postProcess() {
 		// 2..30: from -109 to -53 dBm with 2 dBm steps
 		// 31: -51 dBm or greater
 		// 99: not known or not detectable or currently not available
-		if (rssi < 99) {
+		if (rssi >= 0 && rssi < 99) {
 			rssi = -113 + (rssi * 2);
 		}
 		else {
@@ -202,8 +387,14 @@ String CellularHelperRSSIQualResponse::toString() const {
 
 void CellularHelperExtendedQualResponse::postProcess() {
 	int values[6];
+	size_t numValues = 0;
 
-	if (sscanf(string.c_str(), "%d,%d,%d,%d,%d,%d", &values[0], &values[1], &values[2], &values[3], &values[4], &values[5]) == 6) {
+	CellularHelperFieldParser parser(string.c_str(), string.length());
+	while(numValues < 6 && parser.nextInt(values[numValues])) {
+		numValues++;
+	}
+
+	if (numValues == 6) {
 
 		rxlev = (uint8_t) values[0];
 		ber = (uint8_t) values[1];
@@ -236,6 +427,10 @@ CellularHelperEnvironmentResponse::CellularHelperEnvironmentResponse(CellularHel
 
 }
 
+CellularHelperEnvironmentResponse::CellularHelperEnvironmentResponse(CellularHelperPackedCellData *packedNeighbors, size_t numNeighbors) :
+	neighbors(0), numNeighbors(numNeighbors), packedNeighbors(packedNeighbors) {
+}
+
 int CellularHelperEnvironmentResponse::parse(int type, const char *buf, int len) {
 	if (enableDebug) {
 		logCellularDebug(type, buf, len);
@@ -243,82 +438,102 @@ int CellularHelperEnvironmentResponse::parse(int type, const char *buf, int len)
 
 	if (type == TYPE_UNKNOWN || type == TYPE_PLUS) {
 		// We get this for AT+CGED=5
-		// Copy to temporary string to make processing easier
-		char *copy = (char *) malloc(len + 1);
-		if (copy) {
-			strncpy(copy, buf, len);
-			copy[len] = 0;
-
-			// This is used for skipping over the +CGED: part of the response
-			char searchFor[32];
-			size_t searchForLen = snprintf(searchFor, sizeof(searchFor), "+%s: ", command.c_str());
-
-			char *endStr;
-
-			char *line = strtok_r(copy, "\r\n", &endStr);
-			while(line) {
-				if (line[0]) {
-					// Not an empty line
-
-					if (type == TYPE_PLUS && strncmp(line, searchFor, searchForLen) == 0) {
-						line += searchForLen;
-					}
-
-					if (strncmp(line, "MCC:", 4) == 0) {
-						// Line begins with MCC:
-						// This happens for 2G and 3G
-						if (curDataIndex < 0) {
-							service.parse(line);
-							curDataIndex++;
-						}
-						else
-						if (neighbors && (size_t)curDataIndex < numNeighbors) {
-							neighbors[curDataIndex++].parse(line);
-						}
-					}
-					else
-					if (strncmp(line, "RAT:", 4) == 0) {
-						// Line begins with RAT:
-						// This happens for 3G in the + response so you know whether
-						// the response is for a 2G or 3G tower
-						service.parse(line);
-					}
-				}
-				line = strtok_r(NULL, "\r\n", &endStr);
+		// The data is parsed in place, a line at a time, without copying it
+		CellularHelperTokenizer lines(buf, (size_t)len, "\r\n");
+
+		const char *line;
+		size_t lineLen;
+		while(lines.next(line, lineLen)) {
+			// Skip over the +CGED: part of the response
+			if (type == TYPE_PLUS && lineLen >= command.length() + 3 && line[0] == '+' &&
+				memcmp(&line[1], command.c_str(), command.length()) == 0 &&
+				line[command.length() + 1] == ':' && line[command.length() + 2] == ' ') {
+				line += command.length() + 3;
+				lineLen -= command.length() + 3;
 			}
 
-			free(copy);
+			if (lineLen >= 4 && strncmp(line, "MCC:", 4) == 0) {
+				// Line begins with MCC:
+				// This happens for 2G and 3G
+				if (curDataIndex < 0) {
+					service.parse(line, lineLen);
+					curDataIndex++;
+				}
+				else
+				if (neighbors && (size_t)curDataIndex < numNeighbors) {
+					neighbors[curDataIndex++].parse(line, lineLen);
+				}
+				else
+				if (packedNeighbors && (size_t)curDataIndex < numNeighbors) {
+					CellularHelperEnvironmentCellData data;
+					data.parse(line, lineLen);
+					packedNeighbors[curDataIndex++].pack(data);
+				}
+			}
+			else
+			if (lineLen >= 4 && strncmp(line, "RAT:", 4) == 0) {
+				// Line begins with RAT:
+				// This happens for 3G in the + response so you know whether
+				// the response is for a 2G or 3G tower
+				service.parse(line, lineLen);
+			}
 		}
 	}
 	return WAIT;
 }
 
 void CellularHelperEnvironmentCellData::parse(const char *str) {
-	char *mutableCopy = strdup(str);
+	parse(str, strlen(str));
+}
 
-	char *endStr;
+void CellularHelperEnvironmentCellData::parse(const char *str, size_t len) {
+	CellularHelperTokenizer pairs(str, len, ",");
 
-	char *pair = strtok_r(mutableCopy, ",", &endStr);
-	while(pair) {
+	const char *pair;
+	size_t pairLen;
+	while(pairs.next(pair, pairLen)) {
 		// Remove leading spaces caused by ", " combination
-		while(*pair == ' ') {
+		while(pairLen > 0 && *pair == ' ') {
 			pair++;
+			pairLen--;
 		}
 
-		char *colon = strchr(pair, ':');
+		const char *colon = (const char *)memchr(pair, ':', pairLen);
 		if (colon != NULL) {
-			*colon = 0;
-			const char *key = pair;
-			const char *value = ++colon;
-
-			addKeyValue(key, value);
+			size_t keyLen = colon - pair;
+			addKeyValue(pair, keyLen, colon + 1, pairLen - keyLen - 1);
 		}
+	}
+}
+
+CellularHelperTokenizer::CellularHelperTokenizer(const char *buf, size_t len, const char *delimiters) :
+	cur(buf), end(buf + len), delimiters(delimiters) {
+}
 
-		pair = strtok_r(NULL, ",", &endStr);
+bool CellularHelperTokenizer::next(const char *&token, size_t &tokenLen) {
+	// Skip leading delimiters
+	while(cur < end && isDelimiter(*cur)) {
+		cur++;
+	}
+	if (cur >= end) {
+		return false;
 	}
 
+	token = cur;
+	while(cur < end && !isDelimiter(*cur)) {
+		cur++;
+	}
+	tokenLen = cur - token;
+	return true;
+}
 
-	free(mutableCopy);
+bool CellularHelperTokenizer::isDelimiter(char ch) const {
+	for(const char *d = delimiters; *d; d++) {
+		if (ch == *d) {
+			return true;
+		}
+	}
+	return false;
 }
 
 bool CellularHelperEnvironmentCellData::isValid(bool ignoreCI) const {
@@ -328,7 +543,7 @@ bool CellularHelperEnvironmentCellData::isValid(bool ignoreCI) const {
 	}
 
 	if (!ignoreCI) {
-		if (isUMTS) {
+		if (isUMTS || isLTE) {
 			if (ci >= 0xfffffff) {
 				return false;
 			}
@@ -343,273 +558,448 @@ bool CellularHelperEnvironmentCellData::isValid(bool ignoreCI) const {
 }
 
 
-void CellularHelperEnvironmentCellData::addKeyValue(const char *key, const char *value) {
-	char ucCopy[16];
-	if (strlen(key) > (sizeof(ucCopy) - 1)) {
-		Log.info("key too long key=%s value=%s", key, value);
-		return;
-	}
-	size_t ii = 0;
-	for(; key[ii]; ii++) {
-		ucCopy[ii] = toupper(key[ii]);
-	}
-	ucCopy[ii] = 0;
+// Keys that can appear in the AT+CGED and AT+COPS=5 responses
+enum CellularHelperEnvironmentKey {
+	KEY_UNKNOWN,
+	KEY_IGNORED,
+	KEY_RAT,
+	KEY_MCC,
+	KEY_MNC,
+	KEY_LAC,
+	KEY_CI,
+	KEY_BSIC,
+	KEY_ARFCN,
+	KEY_RXLEV,
+	KEY_DLF,
+	KEY_ULF,
+	KEY_RSCP_LEV,
+	KEY_EARFCN
+};
+
+// ASCII-only toupper, which avoids the locale lookup in the C library version
+static inline char keyToUpper(char ch) {
+	return (ch >= 'a' && ch <= 'z') ? (ch - 'a' + 'A') : ch;
+}
 
-	if (strcmp(ucCopy, "RAT") == 0) {
-		isUMTS = (strstr(value, "UMTS") != NULL);
-	}
-	else
-	if (strcmp(ucCopy, "MCC") == 0) {
-		mcc = atoi(value);
-	}
-	else
-	if (strcmp(ucCopy, "MNC") == 0) {
-		mnc = atoi(value);
-	}
-	else
-	if (strcmp(ucCopy, "LAC") == 0) {
-		lac = (int) strtol(value, NULL, 16); // hex
-	}
-	else
-	if (strcmp(ucCopy, "CI") == 0) {
-		ci = (int) strtol(value, NULL, 16); // hex
-	}
-	else
-	if (strcmp(ucCopy, "BSIC") == 0) {
-		bsic = (int) strtol(value, NULL, 16); // hex
-	}
-	else
-	if (strcmp(ucCopy, "ARFCN") == 0) { // Usually "Arfcn"
-		// Documentation says this is hex, but this does not appear to be the case!
-		// arfcn = (int) strtol(value, NULL, 16); // hex
-		arfcn = atoi(value);
-	}
-	else
-	if (strcmp(ucCopy, "ARFCN_DED") == 0 || strcmp(ucCopy, "RXLEVSUB") == 0 || strcmp(ucCopy, "T_ADV") == 0) {
-		// Ignored 2G fields: Arfcn_ded, RxLevSub, t_adv
-	}
-	else
-	if (strcmp(ucCopy, "RXLEV") == 0) { // Sometimes RxLev
-		rxlev = (int) strtol(value, NULL, 16); // hex
-	}
-	else
-	if (strcmp(ucCopy, "DLF") == 0) {
-		dlf = atoi(value);
+// Compares a key of known length case-insensitively against an upper case constant
+static bool keyEquals(const char *key, const char *ucKey, size_t keyLen) {
+	for(size_t ii = 0; ii < keyLen; ii++) {
+		if (keyToUpper(key[ii]) != ucKey[ii]) {
+			return false;
+		}
 	}
-	else
-	if (strcmp(ucCopy, "ULF") == 0) {
-		ulf = atoi(value);
+	return true;
+}
 
-		// For AT+COPS=5, we don't get a RAT, but if ULF is present it's 3G
-		isUMTS = true;
+// Instead of a strcmp for each possible key, switch on the length and the first character,
+// which narrows each key down to at most two candidates, then confirm with a single compare.
+static CellularHelperEnvironmentKey lookupKey(const char *key, size_t keyLen) {
+	const char *ucKey = NULL;
+	const char *ucKey2 = NULL;
+	CellularHelperEnvironmentKey result = KEY_UNKNOWN, result2 = KEY_UNKNOWN;
+
+	if (keyLen == 0) {
+		return KEY_UNKNOWN;
 	}
-	else
-	if (strcmp(ucCopy, "RSCP LEV") == 0) {
-		rscpLev = atoi(value);
+
+	switch(keyLen) {
+	case 2:
+		switch(keyToUpper(key[0])) {
+		case 'C': ucKey = "CI"; result = KEY_CI; break;
+		case 'S': ucKey = "SC"; result = KEY_IGNORED; break;
+		}
+		break;
+
+	case 3:
+		switch(keyToUpper(key[0])) {
+		case 'R': ucKey = "RAT"; result = KEY_RAT; ucKey2 = "RAC"; result2 = KEY_IGNORED; break;
+		case 'M': ucKey = "MCC"; result = KEY_MCC; ucKey2 = "MNC"; result2 = KEY_MNC; break;
+		case 'L': ucKey = "LAC"; result = KEY_LAC; break;
+		case 'D': ucKey = "DLF"; result = KEY_DLF; break;
+		case 'U': ucKey = "ULF"; result = KEY_ULF; break;
+		}
+		break;
+
+	case 4:
+		switch(keyToUpper(key[0])) {
+		case 'B': ucKey = "BSIC"; result = KEY_BSIC; break;
+		}
+		break;
+
+	case 5:
+		switch(keyToUpper(key[0])) {
+		case 'A': ucKey = "ARFCN"; result = KEY_ARFCN; break; // Usually "Arfcn"
+		case 'R': ucKey = "RXLEV"; result = KEY_RXLEV; break; // Sometimes RxLev
+		case 'T': ucKey = "T_ADV"; result = KEY_IGNORED; break;
+		}
+		break;
+
+	case 6:
+		switch(keyToUpper(key[0])) {
+		case 'E': ucKey = "EARFCN"; result = KEY_EARFCN; break;
+		}
+		break;
+
+	case 8:
+		switch(keyToUpper(key[0])) {
+		case 'R': ucKey = "RSCP LEV"; result = KEY_RSCP_LEV; ucKey2 = "RXLEVSUB"; result2 = KEY_IGNORED; break;
+		case 'E': ucKey = "ECN0 LEV"; result = KEY_IGNORED; break;
+		}
+		break;
+
+	case 9:
+		switch(keyToUpper(key[0])) {
+		case 'A': ucKey = "ARFCN_DED"; result = KEY_IGNORED; break;
+		}
+		break;
 	}
-	else
-	if (strcmp(ucCopy, "RAC") == 0 || strcmp(ucCopy, "SC") == 0 || strcmp(ucCopy, "ECN0 LEV") == 0) {
-		// We get these with AT+COPS=5, but we don't need the values
+
+	if (ucKey && keyEquals(key, ucKey, keyLen)) {
+		return result;
 	}
-	else {
-		Log.info("unknown key=%s value=%s", key, value);
+	if (ucKey2 && keyEquals(key, ucKey2, keyLen)) {
+		return result2;
 	}
+	return KEY_UNKNOWN;
+}
 
+// Like strtol, but value does not need to be null terminated. Returns 0 if not a number.
+static int parseIntValue(const char *value, size_t valueLen, int base) {
+	int result = 0;
+	CellularHelperFieldParser::parseInt(value, valueLen, base, result);
+	return result;
 }
 
-int CellularHelperEnvironmentCellData::getBand() const {
-	int freq = 0;
+void CellularHelperEnvironmentCellData::addKeyValue(const char *key, const char *value) {
+	addKeyValue(key, strlen(key), value, strlen(value));
+}
 
-	if (isUMTS) {
-		// 3G radio
+void CellularHelperEnvironmentCellData::addKeyValue(const char *key, size_t keyLen, const char *value, size_t valueLen) {
+	switch(lookupKey(key, keyLen)) {
+	case KEY_RAT:
+		isUMTS = isLTE = false;
+		for(size_t ii = 0; ii + 3 <= valueLen; ii++) {
+			if (ii + 4 <= valueLen && memcmp(&value[ii], "UMTS", 4) == 0) {
+				isUMTS = true;
+				break;
+			}
+			if (memcmp(&value[ii], "LTE", 3) == 0) {
+				isLTE = true;
+				break;
+			}
+		}
+		break;
 
-		// There are a bunch of special cases:
-		switch(ulf) {
-		case 12:
-		case 37:
-		case 62:
-		case 87:
-		case 112:
-		case 137:
-		case 162:
-		case 187:
-		case 212:
-		case 237:
-		case 262:
-		case 287:
-			freq = 1900; // PCS A-F
-			break;
+	case KEY_EARFCN:
+		earfcn = parseIntValue(value, valueLen, 10);
 
-		case 1662:
-		case 1687:
-		case 1712:
-		case 1737:
-		case 1762:
-		case 1787:
-		case 1812:
-		case 1837:
-		case 1862:
-			freq = 1700; // AWS A-F
-			break;
+		// EARFCN is only present for LTE cells. This assumes the key:value format; the SARA-R4
+		// reports it with AT+UCGED instead, which is not parsed.
+		isLTE = true;
+		isUMTS = false;
+		break;
 
-		case 782:
-		case 787:
-		case 807:
-		case 812:
-		case 837:
-		case 862:
-			freq = 850; // CLR
-			break;
+	case KEY_MCC:
+		mcc = parseIntValue(value, valueLen, 10);
+		break;
 
-		case 2362:
-		case 2387:
-		case 2412:
-		case 2437:
-		case 2462:
-		case 2487:
-		case 2512:
-		case 2537:
-		case 2562:
-		case 2587:
-		case 2612:
-		case 2637:
-		case 2662:
-		case 2687:
-			freq = 2600; // IMT-E
-			break;
+	case KEY_MNC:
+		mnc = parseIntValue(value, valueLen, 10);
+		break;
 
-		case 3187:
-		case 3212:
-		case 3237:
-		case 3262:
-		case 3287:
-		case 3312:
-		case 3337:
-		case 3362:
-		case 3387:
-		case 3412:
-		case 3437:
-		case 3462:
-			freq = 1700; // EAWS A-G
-			break;
+	case KEY_LAC:
+		lac = parseIntValue(value, valueLen, 16); // hex
+		break;
 
-		case 3707:
-		case 3732:
-		case 3737:
-		case 3762:
-		case 3767:
-			freq = 700; // LSMH A/B/C
-			break;
+	case KEY_CI:
+		ci = parseIntValue(value, valueLen, 16); // hex
+		break;
 
-		case 3842:
-		case 3867:
-			freq = 700; // USMH C
-			break;
+	case KEY_BSIC:
+		bsic = parseIntValue(value, valueLen, 16); // hex
+		break;
 
-		case 3942:
-		case 3967:
-			freq = 700; // USMH D
+	case KEY_ARFCN:
+		// Documentation says this is hex, but this does not appear to be the case!
+		// arfcn = parseIntValue(value, valueLen, 16); // hex
+		arfcn = parseIntValue(value, valueLen, 10);
+		break;
 
-		case 387:
-		case 412:
-		case 437:
-			freq = 800;
-			break;
+	case KEY_RXLEV:
+		rxlev = parseIntValue(value, valueLen, 16); // hex
+		break;
 
-		case 6067:
-		case 6092:
-		case 6117:
-		case 6142:
-		case 6167:
-		case 6192:
-		case 6217:
-		case 6242:
-		case 6267:
-		case 6292:
-		case 6317:
-		case 6342:
-		case 6367:
-			freq = 1900; // EPCS A-G
-			break;
+	case KEY_DLF:
+		dlf = parseIntValue(value, valueLen, 10);
+		break;
 
-		case 5712:
-		case 5737:
-		case 5762:
-		case 5767:
-		case 5787:
-		case 5792:
-		case 5812:
-		case 5817:
-		case 5837:
-		case 5842:
-		case 5862:
-			freq = 850; // ECLR
-			break;
+	case KEY_ULF:
+		ulf = parseIntValue(value, valueLen, 10);
 
-		default:
-			if (ulf >= 0 && ulf <= 124) {
-				freq = 900;
-			}
-			else
-			if (ulf >= 128 && ulf <= 251) {
-				freq = 850;
-			}
-			else
-			if (ulf >= 512 && ulf <= 885) {
-				freq = 1800;
-			}
-			else
-			if (ulf >= 975 && ulf <= 1023) {
-				freq = 900;
-			}
-			else
-			if (ulf >= 1312 && ulf <= 1513) {
-				freq = 1700;
-			}
-			else
-			if (ulf >= 2712 && ulf <= 2863) {
-				freq = 900;
-			}
-			else
-			if (ulf >= 4132 && ulf <= 4233) {
-				freq = 850;
-			}
-			else
-			if ((ulf >= 4162 && ulf <= 4188) || (ulf >= 20312 && ulf <= 20363)) {
-				freq = 800;
-			}
-			else
-			if (ulf >= 9262 && ulf <= 9538) {
-				freq = 1900;
-			}
-			else
-			if (ulf >= 9612 && ulf <= 9888) {
-				freq = 2100;
-			}
-			break;
-		}
+		// For AT+COPS=5, we don't get a RAT, but if ULF is present it's 3G
+		isUMTS = true;
+		break;
+
+	case KEY_RSCP_LEV:
+		rscpLev = parseIntValue(value, valueLen, 10);
+		break;
+
+	case KEY_IGNORED:
+		// Ignored 2G fields: Arfcn_ded, RxLevSub, t_adv
+		// We get RAC, SC, ECN0 LEV with AT+COPS=5, but we don't need the values
+		break;
+
+	default:
+		Log.info("unknown key=%.*s value=%.*s", (int)keyLen, key, (int)valueLen, value);
+		break;
+	}
+}
+
+// A range of channel numbers (ARFCN or UARFCN) in a band. Every step channels from first to
+// last are in the band; a single channel has first == last.
+struct CellularHelperBandRange {
+	uint16_t first;
+	uint16_t last;
+	uint16_t step;
+	uint16_t freq; // MHz
+};
+
+// 3G UARFCN ranges and special channels, and ARFCN ranges for GSM and DCS cells reported by
+// 3G modems, merged into one sorted table so a lookup is a single binary search. The special
+// channels take precedence over the ranges they're in, so those ranges are split around them.
+// 4162 - 4188 (800 MHz) is not listed because it is within 4132 - 4233 (850 MHz).
+static constexpr CellularHelperBandRange umtsBandRanges[] = {
+	{ 0, 11, 1, 900 },
+	{ 12, 12, 1, 1900 },		// PCS A-F: 12 - 287, every 25
+	{ 13, 36, 1, 900 },
+	{ 37, 37, 1, 1900 },
+	{ 38, 61, 1, 900 },
+	{ 62, 62, 1, 1900 },
+	{ 63, 86, 1, 900 },
+	{ 87, 87, 1, 1900 },
+	{ 88, 111, 1, 900 },
+	{ 112, 112, 1, 1900 },
+	{ 113, 124, 1, 900 },
+	{ 128, 136, 1, 850 },
+	{ 137, 137, 1, 1900 },
+	{ 138, 161, 1, 850 },
+	{ 162, 162, 1, 1900 },
+	{ 163, 186, 1, 850 },
+	{ 187, 187, 1, 1900 },
+	{ 188, 211, 1, 850 },
+	{ 212, 212, 1, 1900 },
+	{ 213, 236, 1, 850 },
+	{ 237, 237, 1, 1900 },
+	{ 238, 251, 1, 850 },
+	{ 262, 287, 25, 1900 },
+	{ 387, 437, 25, 800 },
+	{ 512, 781, 1, 1800 },
+	{ 782, 782, 1, 850 },		// CLR: 782, 787, 807, 812, 837, 862
+	{ 783, 786, 1, 1800 },
+	{ 787, 787, 1, 850 },
+	{ 788, 806, 1, 1800 },
+	{ 807, 807, 1, 850 },
+	{ 808, 811, 1, 1800 },
+	{ 812, 812, 1, 850 },
+	{ 813, 836, 1, 1800 },
+	{ 837, 837, 1, 850 },
+	{ 838, 861, 1, 1800 },
+	{ 862, 862, 1, 850 },
+	{ 863, 885, 1, 1800 },
+	{ 975, 1023, 1, 900 },
+	{ 1312, 1513, 1, 1700 },
+	{ 1662, 1862, 25, 1700 },	// AWS A-F
+	{ 2362, 2687, 25, 2600 },	// IMT-E
+	{ 2712, 2863, 1, 900 },
+	{ 3187, 3462, 25, 1700 },	// EAWS A-G
+	{ 3707, 3707, 1, 700 },		// LSMH A/B/C
+	{ 3732, 3737, 5, 700 },
+	{ 3762, 3767, 5, 700 },
+	{ 3842, 3867, 25, 700 },	// USMH C
+	{ 3942, 3967, 25, 700 },	// USMH D
+	{ 4132, 4233, 1, 850 },
+	{ 5712, 5762, 25, 850 },	// ECLR
+	{ 5767, 5767, 1, 850 },
+	{ 5787, 5792, 5, 850 },
+	{ 5812, 5817, 5, 850 },
+	{ 5837, 5842, 5, 850 },
+	{ 5862, 5862, 1, 850 },
+	{ 6067, 6367, 25, 1900 },	// EPCS A-G
+	{ 9262, 9538, 1, 1900 },
+	{ 9612, 9888, 1, 2100 },
+	{ 20312, 20363, 1, 800 },
+};
+
+// 2G ARFCN ranges
+static constexpr CellularHelperBandRange gsmBandRanges[] = {
+	{ 0, 124, 1, 900 },
+	{ 128, 251, 1, 850 },
+	{ 512, 885, 1, 1800 },
+	{ 975, 1023, 1, 900 },
+};
+
+// LTE E-UTRA bands by downlink EARFCN (3GPP TS 36.101 table 5.7.3-1). The downlink frequency
+// in MHz is (fDlLow + earfcn - first) / 10.
+struct CellularHelperEARFCNRange {
+	uint32_t first;  // N_Offs-DL, the first EARFCN in the band
+	uint32_t last;
+	uint16_t fDlLow; // F_DL_low in units of 100 kHz
+	uint8_t band;    // E-UTRA operating band number
+	uint16_t freq;   // Nominal band in MHz, as returned by getBand()
+};
+
+static constexpr CellularHelperEARFCNRange lteBandRanges[] = {
+	{ 0, 599, 21100, 1, 2100 },
+	{ 600, 1199, 19300, 2, 1900 },
+	{ 1200, 1949, 18050, 3, 1800 },
+	{ 1950, 2399, 21100, 4, 1700 },
+	{ 2400, 2649, 8690, 5, 850 },
+	{ 2650, 2749, 8750, 6, 850 },
+	{ 2750, 3449, 26200, 7, 2600 },
+	{ 3450, 3799, 9250, 8, 900 },
+	{ 3800, 4149, 18449, 9, 1800 },
+	{ 4150, 4749, 21100, 10, 1700 },
+	{ 4750, 4949, 14759, 11, 1500 },
+	{ 5010, 5179, 7290, 12, 700 },
+	{ 5180, 5279, 7460, 13, 700 },
+	{ 5280, 5379, 7580, 14, 700 },
+	{ 5730, 5849, 7340, 17, 700 },
+	{ 5850, 5999, 8600, 18, 850 },
+	{ 6000, 6149, 8750, 19, 850 },
+	{ 6150, 6449, 7910, 20, 800 },
+	{ 6450, 6599, 14959, 21, 1500 },
+	{ 6600, 7399, 35100, 22, 3500 },
+	{ 7500, 7699, 21800, 23, 2000 },
+	{ 7700, 8039, 15250, 24, 1600 },
+	{ 8040, 8689, 19300, 25, 1900 },
+	{ 8690, 9039, 8590, 26, 850 },
+	{ 9040, 9209, 8520, 27, 800 },
+	{ 9210, 9659, 7580, 28, 700 },
+	{ 9660, 9769, 7170, 29, 700 },
+	{ 9770, 9869, 23500, 30, 2300 },
+	{ 9870, 9919, 4625, 31, 450 },
+	{ 9920, 10359, 14520, 32, 1500 },
+	{ 36000, 36199, 19000, 33, 1900 },
+	{ 36200, 36349, 20100, 34, 2000 },
+	{ 36350, 36949, 18500, 35, 1900 },
+	{ 36950, 37549, 19300, 36, 1900 },
+	{ 37550, 37749, 19100, 37, 1900 },
+	{ 37750, 38249, 25700, 38, 2600 },
+	{ 38250, 38649, 18800, 39, 1900 },
+	{ 38650, 39649, 23000, 40, 2300 },
+	{ 39650, 41589, 24960, 41, 2500 },
+	{ 41590, 43589, 34000, 42, 3500 },
+	{ 43590, 45589, 36000, 43, 3700 },
+	{ 45590, 46589, 7030, 44, 700 },
+	{ 46590, 46789, 14470, 45, 1500 },
+	{ 46790, 54539, 51500, 46, 5200 },
+	{ 54540, 55239, 58550, 47, 5900 },
+	{ 55240, 56739, 35500, 48, 3600 },
+	{ 56740, 58239, 35500, 49, 3600 },
+	{ 58240, 59089, 14320, 50, 1500 },
+	{ 59090, 59139, 14270, 51, 1500 },
+	{ 59140, 60139, 33000, 52, 3300 },
+	{ 60140, 60254, 24835, 53, 2500 },
+	{ 65536, 66435, 21100, 65, 2100 },
+	{ 66436, 67335, 21100, 66, 1700 },
+	{ 67336, 67535, 7380, 67, 700 },
+	{ 67536, 67835, 7530, 68, 700 },
+	{ 67836, 68335, 25700, 69, 2600 },
+	{ 68336, 68585, 19950, 70, 1700 },
+	{ 68586, 68935, 6170, 71, 600 },
+	{ 68936, 68985, 4610, 72, 450 },
+	{ 68986, 69035, 4600, 73, 450 },
+	{ 69036, 69465, 14750, 74, 1500 },
+	{ 69466, 70315, 14320, 75, 1500 },
+	{ 70316, 70365, 14270, 76, 1500 },
+	{ 70366, 70545, 7280, 85, 700 },
+	{ 70546, 70595, 4200, 87, 410 },
+	{ 70596, 70645, 4220, 88, 410 },
+};
+
+#define BAND_TABLE_SIZE(table) (sizeof(table) / sizeof(table[0]))
+
+// The binary search requires that the tables be sorted and not overlap, which is checked at compile time
+template<class T>
+static constexpr bool bandTableIsSorted(const T *table, size_t count) {
+	return (count < 2) || (table[0].first <= table[0].last && table[0].last < table[1].first && bandTableIsSorted(&table[1], count - 1));
+}
+static_assert(bandTableIsSorted(umtsBandRanges, BAND_TABLE_SIZE(umtsBandRanges)), "umtsBandRanges must be sorted");
+static_assert(bandTableIsSorted(gsmBandRanges, BAND_TABLE_SIZE(gsmBandRanges)), "gsmBandRanges must be sorted");
+static_assert(bandTableIsSorted(lteBandRanges, BAND_TABLE_SIZE(lteBandRanges)), "lteBandRanges must be sorted");
+
+// Returns the entry in table where channel is between first and last, or NULL if there isn't one.
+// The size is a template parameter so the search loop is unrolled.
+template<class T, size_t N>
+static inline const T *findBandRange(const T (&table)[N], long channel) {
+	size_t count = N;
+
+	// Most channels that aren't in the table are outside it entirely
+	if (channel < 0 || (unsigned long)channel < table[0].first || (unsigned long)channel > table[N - 1].last) {
+		return NULL;
+	}
 
+	// Find the last range that starts at or before channel. The loop always runs log2(count) times
+	// and the comparison becomes a conditional move instead of a branch that's hard to predict.
+	const T *base = table;
+	while(count > 1) {
+		size_t half = count / 2;
+		base = ((unsigned long)channel >= base[half].first) ? &base[half] : base;
+		count -= half;
+	}
+	return ((unsigned long)channel <= base->last) ? base : NULL;
+}
 
+// Returns the frequency in MHz for channel, or 0 if it's not in table
+template<size_t N>
+static inline int lookupBand(const CellularHelperBandRange (&table)[N], int channel) {
+	const CellularHelperBandRange *range = findBandRange(table, channel);
+	// The step is usually 1, which saves a division
+	if (range && (range->step == 1 || ((channel - range->first) % range->step) == 0)) {
+		return range->freq;
+	}
+	return 0;
+}
+
+int CellularHelperEnvironmentCellData::getBand() const {
+	int freq = 0;
+
+	if (isLTE) {
+		const CellularHelperEARFCNRange *range = findBandRange(lteBandRanges, earfcn);
+		if (range) {
+			freq = range->freq;
+		}
+	}
+	else
+	if (isUMTS) {
+		// 3G radio, the special channels are in the same table as the ranges
+		freq = lookupBand(umtsBandRanges, ulf);
 	}
 	else {
 		// 2G, use arfcn
-		if (arfcn >= 0 && arfcn <= 124) {
-			freq = 900;
-		}
-		else
-		if (arfcn >= 128 && arfcn <= 251) {
-			freq = 850;
-		}
-		else
-		if (arfcn >= 512 && arfcn <= 885) {
-			freq = 1800;
+		freq = lookupBand(gsmBandRanges, arfcn);
+	}
+	return freq;
+}
+
+int CellularHelperEnvironmentCellData::getLTEBand() const {
+	if (isLTE) {
+		const CellularHelperEARFCNRange *range = findBandRange(lteBandRanges, earfcn);
+		if (range) {
+			return range->band;
 		}
-		else
-		if (arfcn >= 975 && arfcn <= 1023) {
-			freq = 900;
+	}
+	return 0;
+}
+
+float CellularHelperEnvironmentCellData::getLTEDownlinkFrequency() const {
+	if (isLTE) {
+		const CellularHelperEARFCNRange *range = findBandRange(lteBandRanges, earfcn);
+		if (range) {
+			return (float)(range->fDlLow + (earfcn - range->first)) / 10.0;
 		}
 	}
-	return freq;
+	return 0.0;
 }
 
 // Calculated
@@ -618,6 +1008,16 @@ String CellularHelperEnvironmentCellData::getBandString() const {
 
 	int freq = getBand();
 
+	if (isLTE) {
+		int lteBand = getLTEBand();
+		if (lteBand != 0) {
+			band = String::format("LTE B%d %d", lteBand, freq);
+		}
+		else {
+			band = "LTE unknown";
+		}
+	}
+	else
 	if (isUMTS) {
 		// 3G radio
 		if ((ulf >= 0 && ulf <= 124) ||
@@ -669,210 +1069,787 @@ int CellularHelperEnvironmentCellData::getRSSI() const {
 	if (isUMTS) {
 		// 3G radio
 
-		if (rscpLev <= 96) {
+		if (rscpLev >= 0 && rscpLev <= 96) {
 			rssi = -121 + rscpLev;
 		}
 	}
 	else {
 		// 2G
-		if (rxlev <= 96) {
+		if (rxlev >= 0 && rxlev <= 96) {
 			rssi = -121 + rxlev;
 		}
 	}
-	return rssi;
+	return rssi;
+}
+
+int CellularHelperEnvironmentCellData::getBars() const {
+	return CellularHelperClass::rssiToBars(getRSSI());
+}
+
+String CellularHelperEnvironmentCellData::toString() const {
+	String common = String::format("mcc=%d, mnc=%d, lac=%x ci=%x band=%s rssi=%d",
+			mcc, mnc, lac, ci, getBandString().c_str(), getRSSI());
+
+	if (isLTE) {
+		return String::format("rat=LTE %s earfcn=%d", common.c_str(), earfcn);
+	}
+	else
+	if (isUMTS) {
+		return String::format("rat=UMTS %s dlf=%d ulf=%d", common.c_str(), dlf, ulf);
+	}
+	else {
+		return String::format("rat=GSM %s bsic=%x arfcn=%d rxlev=%d", common.c_str(), bsic, arfcn, rxlev);
+	}
+}
+
+void CellularHelperEnvironmentResponse::clear() {
+	curDataIndex = -1;
+}
+
+
+void CellularHelperEnvironmentResponse::logResponse() const {
+	Log.info("service %s", service.toString().c_str());
+	if (neighbors) {
+		for(size_t ii = 0; ii < numNeighbors; ii++) {
+			if (neighbors[ii].isValid(true /* ignoreCI */)) {
+				Log.info("neighbor %d %s", (int)ii, neighbors[ii].toString().c_str());
+			}
+		}
+	}
+	else
+	if (packedNeighbors) {
+		for(size_t ii = 0; ii < numNeighbors; ii++) {
+			if (packedNeighbors[ii].isValid(true /* ignoreCI */)) {
+				Log.info("neighbor %d %s", (int)ii, packedNeighbors[ii].toString().c_str());
+			}
+		}
+	}
+}
+
+size_t CellularHelperEnvironmentResponse::getNumNeighbors() const {
+	if (curDataIndex < 0) {
+		return 0;
+	}
+	else {
+		if (neighbors) {
+			for(size_t ii = 0; ii < (size_t)curDataIndex; ii++) {
+				if (!neighbors[ii].isValid()) {
+					return ii;
+				}
+			}
+		}
+		else
+		if (packedNeighbors) {
+			for(size_t ii = 0; ii < (size_t)curDataIndex; ii++) {
+				if (!packedNeighbors[ii].isValid()) {
+					return ii;
+				}
+			}
+		}
+		return curDataIndex;
+	}
+}
+
+
+bool CellularHelperEnvironmentResponse::getNeighbor(size_t index, CellularHelperEnvironmentCellData &data) const {
+	if (index >= numNeighbors) {
+		return false;
+	}
+	if (neighbors) {
+		data = neighbors[index];
+	}
+	else
+	if (packedNeighbors) {
+		packedNeighbors[index].unpack(data);
+	}
+	else {
+		return false;
+	}
+	return data.isValid(true /* ignoreCI */);
+}
+
+// Compile-time check that the packed layout did not grow
+static_assert(sizeof(CellularHelperPackedCellData) == 16, "CellularHelperPackedCellData should be 16 bytes");
+
+CellularHelperPackedCellData::CellularHelperPackedCellData() :
+	ciRat(CI_MASK), mccMncBsic(MCC_MNC_MASK | (MCC_MNC_MASK << MNC_SHIFT)), lac(0), chan1(0), chan2(0), level(255), reserved(0) {
+}
+
+CellularHelperPackedCellData::CellularHelperPackedCellData(const CellularHelperEnvironmentCellData &data) {
+	pack(data);
+}
+
+void CellularHelperPackedCellData::pack(const CellularHelperEnvironmentCellData &data) {
+	int rat = data.isLTE ? RAT_LTE : (data.isUMTS ? RAT_UMTS : RAT_GSM);
+
+	uint32_t ci = (data.ci >= 0 && (uint32_t)data.ci < CI_MASK) ? (uint32_t)data.ci : CI_MASK;
+	ciRat = ci | ((uint32_t)rat << RAT_SHIFT);
+
+	uint32_t mcc = (data.mcc >= 0 && data.mcc <= 999) ? (uint32_t)data.mcc : MCC_MNC_MASK;
+	uint32_t mnc = (data.mnc >= 0 && data.mnc <= 999) ? (uint32_t)data.mnc : MCC_MNC_MASK;
+	mccMncBsic = mcc | (mnc << MNC_SHIFT);
+
+	lac = (uint16_t) data.lac;
+	chan1 = chan2 = 0;
+	reserved = 0;
+
+	switch(rat) {
+	case RAT_LTE:
+		if (data.earfcn >= 0 && data.earfcn <= 0x1fffe) {
+			chan1 = (uint16_t) data.earfcn;
+			if (data.earfcn & 0x10000) {
+				ciRat |= EARFCN_HIGH_BIT;
+			}
+		}
+		else {
+			// 0x1ffff means not known
+			chan1 = 0xffff;
+			ciRat |= EARFCN_HIGH_BIT;
+		}
+		level = (data.rxlev >= 0 && data.rxlev <= 255) ? (uint8_t) data.rxlev : 255;
+		break;
+
+	case RAT_UMTS:
+		chan1 = (uint16_t) data.dlf;
+		chan2 = (uint16_t) data.ulf;
+		level = (data.rscpLev >= 0 && data.rscpLev <= 255) ? (uint8_t) data.rscpLev : 255;
+		break;
+
+	default:
+		mccMncBsic |= ((uint32_t)data.bsic & BSIC_MASK) << BSIC_SHIFT;
+		chan1 = (uint16_t) data.arfcn;
+		level = (data.rxlev >= 0 && data.rxlev <= 255) ? (uint8_t) data.rxlev : 255;
+		break;
+	}
+}
+
+void CellularHelperPackedCellData::unpack(CellularHelperEnvironmentCellData &data) const {
+	data.mcc = getMCC();
+	data.mnc = getMNC();
+	data.lac = getLAC();
+	data.ci = getCI();
+	data.isUMTS = isUMTS();
+	data.isLTE = isLTE();
+	data.bsic = getBSIC();
+	data.arfcn = getARFCN();
+	data.dlf = getDLF();
+	data.ulf = getULF();
+	data.earfcn = getEARFCN();
+	data.rxlev = isUMTS() ? 0 : level;
+	data.rscpLev = isUMTS() ? level : 255;
+}
+
+int CellularHelperPackedCellData::getMCC() const {
+	uint32_t mcc = mccMncBsic & MCC_MNC_MASK;
+	return (mcc == MCC_MNC_MASK) ? 65535 : (int)mcc;
+}
+
+int CellularHelperPackedCellData::getMNC() const {
+	uint32_t mnc = (mccMncBsic >> MNC_SHIFT) & MCC_MNC_MASK;
+	return (mnc == MCC_MNC_MASK) ? 255 : (int)mnc;
+}
+
+int CellularHelperPackedCellData::getEARFCN() const {
+	if (!isLTE()) {
+		return -1;
+	}
+	int earfcn = chan1 | ((ciRat & EARFCN_HIGH_BIT) ? 0x10000 : 0);
+	return (earfcn == 0x1ffff) ? -1 : earfcn;
+}
+
+bool CellularHelperPackedCellData::isValid(bool ignoreCI) const {
+	if ((mccMncBsic & MCC_MNC_MASK) == MCC_MNC_MASK) {
+		return false;
+	}
+
+	if (!ignoreCI) {
+		uint32_t ci = ciRat & CI_MASK;
+		if (isUMTS() || isLTE()) {
+			if (ci >= 0xfffffff) {
+				return false;
+			}
+		}
+		else {
+			if (ci >= 0xffff) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int CellularHelperPackedCellData::getRSSI() const {
+	// Same as CellularHelperEnvironmentCellData::getRSSI(); level is rscpLev for 3G and rxlev otherwise
+	if (level <= 96) {
+		return -121 + level;
+	}
+	return 0;
+}
+
+String CellularHelperPackedCellData::toString() const {
+	CellularHelperEnvironmentCellData data;
+	unpack(data);
+	return data.toString();
+}
+
+// +UULOC: <date>,<time>,<lat>,<long>,<alt>,<uncertainty>
+
+int CellularHelperLocationResponse::parse(int type, const char *buf, int len) {
+	if (enableDebug) {
+		logCellularDebug(type, buf, len);
+	}
+
+	// Only the first +UULOC is used
+	if (type == TYPE_PLUS && !isValid()) {
+		size_t valueLen;
+		const char *value = CellularHelperClass::findPlusResponse(buf, len, command.c_str(), command.length(), valueLen);
+		if (value) {
+			parseLocation(value, valueLen);
+		}
+	}
+	return WAIT;
+}
+
+void CellularHelperLocationResponse::postProcess() {
+	if (!isValid() && string.length() != 0) {
+		parseLocation(string.c_str(), string.length());
+	}
+}
+
+bool CellularHelperLocationResponse::parseLocation(const char *value, size_t valueLen) {
+	// 13/04/2020,15:03:33.000,42.3601700,-71.0589000,0,1472
+	// date, time, lat, lon, alt, uncertainty
+	float newLat, newLon;
+	int newAlt, newUncertainty;
+
+	CellularHelperFieldParser parser(value, valueLen);
+	if (!parser.skipField() || !parser.skipField() || !parser.nextFloat(newLat) || !parser.nextFloat(newLon) ||
+		!parser.nextInt(newAlt) || !parser.nextInt(newUncertainty)) {
+		return false;
+	}
+
+	lat = newLat;
+	lon = newLon;
+	alt = newAlt;
+	uncertainty = newUncertainty;
+	resp = RESP_OK;
+
+	// Set last, with release ordering, so a thread that sees isValid() return true also sees
+	// the values above. The URC handler runs on the system thread. valid is a plain bool with
+	// atomic access, rather than std::atomic, so the response can still be copied.
+	__atomic_store_n(&valid, true, __ATOMIC_RELEASE);
+	return true;
+}
+
+String CellularHelperLocationResponse::toString() const {
+	if (valid) {
+		return String::format("lat=%f lon=%f alt=%d uncertainty=%d", lat, lon, alt, uncertainty);
+	}
+	else {
+		return "valid=false";
+	}
+}
+
+void CellularHelperCREGResponse::postProcess() {
+	// "\r\n+CREG: 2,1,\"FFFE\",\"C45C010\",8\r\n"
+	// The quoted values are hex. Parse all of the fields in one pass, then use the position of
+	// the first quoted field to tell which format it is.
+	int values[5];
+	size_t numValues = 0;
+	int firstQuoted = -1;
+
+	CellularHelperFieldParser parser(string.c_str(), string.length());
+	while(numValues < 5 && !parser.atEnd()) {
+		bool quoted = parser.isNextQuoted();
+		if (quoted && firstQuoted < 0) {
+			firstQuoted = (int)numValues;
+		}
+		if (!parser.nextInt(values[numValues], quoted ? 16 : 10)) {
+			break;
+		}
+		numValues++;
+	}
+
+	if (numValues == 5 && firstQuoted == 2) {
+		// SARA-R4 does include the n (5 parameters)
+		stat = values[1];
+		lac = values[2];
+		ci = values[3];
+		rat = values[4];
+		valid = true;
+	}
+	else
+	if (numValues >= 4 && firstQuoted == 1) {
+		// SARA-U and SARA-G don't include the n (4 parameters)
+		stat = values[0];
+		lac = values[1];
+		ci = values[2];
+		rat = values[3];
+		valid = true;
+	}
+
+}
+
+String CellularHelperCREGResponse::toString() const {
+	if (valid) {
+		return String::format("stat=%d lac=0x%x ci=0x%x rat=%d", stat, lac, ci, rat);
+	}
+	else {
+		return "valid=false";
+	}
+}
+
+CellularHelperOperatorIndex::CellularHelperOperatorIndex(Entry *entries, size_t maxEntries, char *arena, size_t arenaSize) :
+	entries(entries), maxEntries(maxEntries), arena(arena), arenaSize(arenaSize > 65535 ? 65535 : arenaSize) {
+}
+
+void CellularHelperOperatorIndex::clear() {
+	numEntries = 0;
+	arenaUsed = 0;
+	numDropped = 0;
+}
+
+bool CellularHelperOperatorIndex::addMCCFilter(int mcc) {
+	for(size_t ii = 0; ii < numMCCFilters; ii++) {
+		if (mccFilters[ii] == mcc) {
+			return true;
+		}
+	}
+	if (numMCCFilters >= MAX_MCC_FILTERS) {
+		return false;
+	}
+	mccFilters[numMCCFilters++] = (uint16_t) mcc;
+	return true;
+}
+
+bool CellularHelperOperatorIndex::addOperator(int mcc, int mnc, const char *name, size_t nameLen) {
+	if (mcc < 0 || mcc > 999 || mnc < 0 || mnc > 999) {
+		return false;
+	}
+
+	if (numMCCFilters) {
+		size_t ii;
+		for(ii = 0; ii < numMCCFilters; ii++) {
+			if (mccFilters[ii] == mcc) {
+				break;
+			}
+		}
+		if (ii == numMCCFilters) {
+			return false;
+		}
+	}
+
+	// AT+COPN is mostly in order, so check the end before doing a binary search
+	size_t index;
+	if (numEntries == 0 || entries[numEntries - 1].mcc < mcc ||
+		(entries[numEntries - 1].mcc == mcc && entries[numEntries - 1].mnc < mnc)) {
+		index = numEntries;
+	}
+	else {
+		index = lowerBound((uint16_t)mcc, (uint16_t)mnc);
+		if (index < numEntries && entries[index].mcc == mcc && entries[index].mnc == mnc) {
+			// Already present; the first name wins
+			return true;
+		}
+	}
+
+	uint16_t nameOffset;
+	if (numEntries >= maxEntries || !internName(name, nameLen, nameOffset)) {
+		numDropped++;
+		return false;
+	}
+
+	if (index < numEntries) {
+		memmove(&entries[index + 1], &entries[index], (numEntries - index) * sizeof(Entry));
+	}
+	entries[index].mcc = (uint16_t) mcc;
+	entries[index].mnc = (uint16_t) mnc;
+	entries[index].nameOffset = nameOffset;
+	numEntries++;
+
+	return true;
+}
+
+const char *CellularHelperOperatorIndex::getOperatorName(int mcc, int mnc) const {
+	if (mcc < 0 || mcc > 999 || mnc < 0 || mnc > 999) {
+		return NULL;
+	}
+
+	size_t index = lowerBound((uint16_t)mcc, (uint16_t)mnc);
+	if (index < numEntries && entries[index].mcc == mcc && entries[index].mnc == mnc) {
+		return &arena[entries[index].nameOffset];
+	}
+	return NULL;
+}
+
+size_t CellularHelperOperatorIndex::lowerBound(uint16_t mcc, uint16_t mnc) const {
+	size_t low = 0;
+	size_t high = numEntries;
+
+	while(low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (entries[mid].mcc < mcc || (entries[mid].mcc == mcc && entries[mid].mnc < mnc)) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+bool CellularHelperOperatorIndex::internName(const char *name, size_t nameLen, uint16_t &offset) {
+	if (nameLen > 255) {
+		nameLen = 255;
+	}
+
+	// Each name is stored as a length byte, the name, and a null terminator, so the arena can
+	// be walked by skipping over names of a different length without comparing them.
+	size_t pos = 0;
+	while(pos < arenaUsed) {
+		size_t len = (uint8_t) arena[pos];
+		if (len == nameLen && memcmp(&arena[pos + 1], name, nameLen) == 0) {
+			offset = (uint16_t)(pos + 1);
+			return true;
+		}
+		pos += len + 2;
+	}
+
+	if (arenaUsed + nameLen + 2 > arenaSize) {
+		return false;
+	}
+
+	arena[arenaUsed] = (char) nameLen;
+	memcpy(&arena[arenaUsed + 1], name, nameLen);
+	arena[arenaUsed + 1 + nameLen] = 0;
+	offset = (uint16_t)(arenaUsed + 1);
+	arenaUsed += nameLen + 2;
+
+	return true;
+}
+
+void CellularHelperOperatorIndex::parseLine(const char *line, size_t lineLen) {
+	// "901012","MCP Maritime Com"
+	// The numeric part is 3 digits of mcc followed by 2 or 3 digits of mnc
+	const char *end = line + lineLen;
+	if (lineLen < 1 || line[0] != '"') {
+		return;
+	}
+
+	const char *numStart = line + 1;
+	const char *numEnd = numStart;
+	while(numEnd < end && *numEnd >= '0' && *numEnd <= '9') {
+		numEnd++;
+	}
+	size_t numLen = numEnd - numStart;
+	if (numEnd >= end || *numEnd != '"' || numLen < 5 || numLen > 6) {
+		return;
+	}
+
+	int mcc, mnc;
+	if (!CellularHelperFieldParser::parseInt(numStart, 3, 10, mcc) ||
+		!CellularHelperFieldParser::parseInt(numStart + 3, numLen - 3, 10, mnc)) {
+		return;
+	}
+
+	const char *nameStart = (const char *) memchr(numEnd + 1, '"', end - (numEnd + 1));
+	if (!nameStart) {
+		return;
+	}
+	nameStart++;
+
+	const char *nameEnd = (const char *) memchr(nameStart, '"', end - nameStart);
+	if (!nameEnd) {
+		return;
+	}
+
+	addOperator(mcc, mnc, nameStart, nameEnd - nameStart);
+}
+
+int CellularHelperOperatorIndex::parse(int type, const char *buf, int len) {
+	if (enableDebug) {
+		logCellularDebug(type, buf, len);
+	}
+
+	if (type == TYPE_PLUS) {
+		// +COPN: "901012","MCP Maritime Com"
+		// Parsed in place without copying, usually one line per callback
+		CellularHelperTokenizer lines(buf, (size_t)len, "\r\n");
+
+		const char *line;
+		size_t lineLen;
+		while(lines.next(line, lineLen)) {
+			if (lineLen > 7 && memcmp(line, "+COPN: ", 7) == 0) {
+				parseLine(line + 7, lineLen - 7);
+			}
+		}
+	}
+	return WAIT;
+}
+
+
+// Commands that can be concatenated in one command line by getDiagnostics(), in the order they are sent
+struct CellularHelperBatchCommand {
+	int field;				// CellularHelperDiagnostics::FIELD_ bit
+	const char *command;	// Appended after AT or ;
+	const char *plusName;	// Name in the + response, or NULL if the response has no prefix
+};
+
+static const CellularHelperBatchCommand batchCommands[] = {
+	{ CellularHelperDiagnostics::FIELD_MANUFACTURER, "+CGMI", NULL },
+	{ CellularHelperDiagnostics::FIELD_MODEL, "+CGMM", NULL },
+	{ CellularHelperDiagnostics::FIELD_FIRMWARE_VERSION, "+CGMR", NULL },
+	{ CellularHelperDiagnostics::FIELD_IMEI, "+CGSN", NULL },
+	{ CellularHelperDiagnostics::FIELD_ICCID, "+CCID", "CCID" },
+	{ CellularHelperDiagnostics::FIELD_RSSI_QUAL, "+CSQ", "CSQ" },
+	{ CellularHelperDiagnostics::FIELD_EXTENDED_QUAL, "+CESQ", "CESQ" },
+	{ CellularHelperDiagnostics::FIELD_OPERATOR_NAME, "+UDOPN=9", "UDOPN" },
+};
+
+void CellularHelperDiagnostics::logDiagnostics() const {
+	if (isValid(FIELD_MANUFACTURER)) {
+		Log.info("manufacturer=%s", manufacturer.c_str());
+	}
+	if (isValid(FIELD_MODEL)) {
+		Log.info("model=%s", model.c_str());
+	}
+	if (isValid(FIELD_FIRMWARE_VERSION)) {
+		Log.info("firmware version=%s", firmwareVersion.c_str());
+	}
+	if (isValid(FIELD_ORDERING_CODE)) {
+		Log.info("ordering code=%s", orderingCode.c_str());
+	}
+	if (isValid(FIELD_IMEI)) {
+		Log.info("IMEI=%s", imei.c_str());
+	}
+	if (isValid(FIELD_ICCID)) {
+		Log.info("ICCID=%s", iccid.c_str());
+	}
+	if (isValid(FIELD_OPERATOR_NAME)) {
+		Log.info("operator name=%s", operatorName.c_str());
+	}
+	if (isValid(FIELD_RSSI_QUAL)) {
+		Log.info("%s", rssiQual.toString().c_str());
+	}
+	if (isValid(FIELD_EXTENDED_QUAL)) {
+		Log.info("extended qual %s", extendedQual.toString().c_str());
+	}
+	if (isValid(FIELD_ENVIRONMENT)) {
+		Log.info("service %s", environment.service.toString().c_str());
+	}
 }
 
-int CellularHelperEnvironmentCellData::getBars() const {
-	return CellularHelperClass::rssiToBars(getRSSI());
+CellularHelperBatchResponse::CellularHelperBatchResponse(CellularHelperDiagnostics &result, int fields) :
+	result(result), fields(fields & BATCH_FIELDS) {
 }
 
-String CellularHelperEnvironmentCellData::toString() const {
-	String common = String::format("mcc=%d, mnc=%d, lac=%x ci=%x band=%s rssi=%d",
-			mcc, mnc, lac, ci, getBandString().c_str(), getRSSI());
+size_t CellularHelperBatchResponse::buildCommand(char *buf, size_t bufSize) const {
+	size_t numCommands = 0;
+	size_t offset = snprintf(buf, bufSize, "AT");
 
-	if (isUMTS) {
-		return String::format("rat=UMTS %s dlf=%d ulf=%d", common.c_str(), dlf, ulf);
+	for(size_t ii = 0; ii < sizeof(batchCommands) / sizeof(batchCommands[0]); ii++) {
+		if ((fields & batchCommands[ii].field) != 0 && offset < bufSize) {
+			offset += snprintf(&buf[offset], bufSize - offset, "%s%s", (numCommands ? ";" : ""), batchCommands[ii].command);
+			numCommands++;
+		}
 	}
-	else {
-		return String::format("rat=GSM %s bsic=%x arfcn=%d rxlev=%d", common.c_str(), bsic, arfcn, rxlev);
+	if (offset < bufSize) {
+		snprintf(&buf[offset], bufSize - offset, "\r\n");
 	}
-}
 
-void CellularHelperEnvironmentResponse::clear() {
-	curDataIndex = -1;
+	return numCommands;
 }
 
+int CellularHelperBatchResponse::parse(int type, const char *buf, int len) {
+	if (enableDebug) {
+		logCellularDebug(type, buf, len);
+	}
 
-void CellularHelperEnvironmentResponse::logResponse() const {
-	Log.info("service %s", service.toString().c_str());
-	if (neighbors) {
-		for(size_t ii = 0; ii < numNeighbors; ii++) {
-			if (neighbors[ii].isValid(true /* ignoreCI */)) {
-				Log.info("neighbor %d %s", ii, neighbors[ii].toString().c_str());
+	if (type != TYPE_UNKNOWN && type != TYPE_PLUS) {
+		return WAIT;
+	}
+
+	CellularHelperTokenizer lines(buf, (size_t)len, "\r\n");
+
+	const char *line;
+	size_t lineLen;
+	while(lines.next(line, lineLen)) {
+		if (type == TYPE_UNKNOWN) {
+			// Responses without a prefix come back in the order the commands were sent
+			for(size_t ii = 0; ii < sizeof(batchCommands) / sizeof(batchCommands[0]); ii++) {
+				const CellularHelperBatchCommand &cmd = batchCommands[ii];
+				if (!cmd.plusName && (fields & cmd.field) != 0 && (fieldsReceived & cmd.field) == 0) {
+					storeValue(cmd.field, line, lineLen);
+					break;
+				}
 			}
 		}
-	}
-}
+		else
+		if (lineLen > 1 && line[0] == '+') {
+			const char *colon = (const char *) memchr(line, ':', lineLen);
+			if (!colon) {
+				continue;
+			}
+			size_t nameLen = colon - (line + 1);
 
-size_t CellularHelperEnvironmentResponse::getNumNeighbors() const {
-	if (curDataIndex < 0) {
-		return 0;
-	}
-	else {
-		if (neighbors) {
-			for(size_t ii = 0; ii < (size_t)curDataIndex; ii++) {
-				if (!neighbors[ii].isValid()) {
-					return ii;
+			const char *value = colon + 1;
+			const char *end = line + lineLen;
+			while(value < end && *value == ' ') {
+				value++;
+			}
+
+			for(size_t ii = 0; ii < sizeof(batchCommands) / sizeof(batchCommands[0]); ii++) {
+				const CellularHelperBatchCommand &cmd = batchCommands[ii];
+				if (cmd.plusName && (fields & cmd.field) != 0 && 
+					strlen(cmd.plusName) == nameLen && memcmp(cmd.plusName, line + 1, nameLen) == 0) {
+					storeValue(cmd.field, value, end - value);
+					break;
 				}
 			}
 		}
-		return curDataIndex;
 	}
+
+	return WAIT;
 }
 
+void CellularHelperBatchResponse::storeValue(int field, const char *value, size_t valueLen) {
+	String *str = NULL;
 
+	switch(field) {
+	case CellularHelperDiagnostics::FIELD_MANUFACTURER:
+		str = &result.manufacturer;
+		break;
 
-// +UULOC: <date>,<time>,<lat>,<long>,<alt>,<uncertainty>
+	case CellularHelperDiagnostics::FIELD_MODEL:
+		str = &result.model;
+		break;
 
-void CellularHelperLocationResponse::postProcess() {
-	char *mutableCopy = strdup(string.c_str());
-	if (mutableCopy) {
-		char *part, *endStr;
-
-		part = strtok_r(mutableCopy, ",", &endStr);
-		if (part) {
-			// part is date
-			part = strtok_r(NULL, ",", &endStr);
-			if (part) {
-				// part is time
-				part = strtok_r(NULL, ",", &endStr);
-				if (part) {
-					// part is lat
-					lat = atof(part);
-
-					part = strtok_r(NULL, ",", &endStr);
-					if (part) {
-						// part is lon
-						lon = atof(part);
-
-						part = strtok_r(NULL, ",", &endStr);
-						if (part) {
-							// part is alt
-							alt = atoi(part);
-
-							part = strtok_r(NULL, ",", &endStr);
-							if (part) {
-								// part is uncertainty
-								uncertainty = atoi(part);
-								valid = true;
-								resp = RESP_OK;
-							}
-						}
-					}
-				}
-			}
-		}
+	case CellularHelperDiagnostics::FIELD_FIRMWARE_VERSION:
+		str = &result.firmwareVersion;
+		break;
 
-		free(mutableCopy);
-	}
-}
+	case CellularHelperDiagnostics::FIELD_IMEI:
+		str = &result.imei;
+		break;
 
-String CellularHelperLocationResponse::toString() const {
-	if (valid) {
-		return String::format("lat=%f lon=%f alt=%d uncertainty=%d", lat, lon, alt, uncertainty);
-	}
-	else {
-		return "valid=false";
-	}
-}
+	case CellularHelperDiagnostics::FIELD_ICCID:
+		str = &result.iccid;
+		break;
 
-void CellularHelperCREGResponse::postProcess() {
-	// "\r\n+CREG: 2,1,\"FFFE\",\"C45C010\",8\r\n"
-	int n;
+	case CellularHelperDiagnostics::FIELD_RSSI_QUAL:
+		result.rssiQual.string = "";
+		CellularHelperClass::appendBufferToString(result.rssiQual.string, value, (int)valueLen);
+		result.rssiQual.postProcess();
+		if (result.rssiQual.resp == RESP_OK) {
+			result.validFields |= field;
+		}
+		break;
 
-	if (sscanf(string.c_str(), "%d,%d,\"%x\",\"%x\",%d", &n, &stat, &lac, &ci, &rat) == 5) {
-		// SARA-R4 does include the n (5 parameters)
-		valid = true;
+	case CellularHelperDiagnostics::FIELD_EXTENDED_QUAL:
+		result.extendedQual.string = "";
+		CellularHelperClass::appendBufferToString(result.extendedQual.string, value, (int)valueLen);
+		result.extendedQual.postProcess();
+		if (result.extendedQual.resp == RESP_OK) {
+			result.validFields |= field;
+		}
+		break;
+
+	case CellularHelperDiagnostics::FIELD_OPERATOR_NAME: {
+		// +UDOPN: 9,"T-Mobile"
+		CellularHelperPlusStringResponse udopn;
+		CellularHelperClass::appendBufferToString(udopn.string, value, (int)valueLen);
+		result.operatorName = udopn.getDoubleQuotedPart();
+		result.validFields |= field;
+		break;
 	}
-	else
-	if (sscanf(string.c_str(), "%d,\"%x\",\"%x\",%d", &stat, &lac, &ci, &rat) == 4) {
-		// SARA-U and SARA-G don't include the n (4 parameters)
-		valid = true;
 	}
 
-}
-
-String CellularHelperCREGResponse::toString() const {
-	if (valid) {
-		return String::format("stat=%d lac=0x%x ci=0x%x rat=%d", stat, lac, ci, rat);
-	}
-	else {
-		return "valid=false";
+	if (str) {
+		*str = "";
+		CellularHelperClass::appendBufferToString(*str, value, (int)valueLen);
+		result.validFields |= field;
 	}
+	fieldsReceived |= field;
 }
 
-
 String CellularHelperClass::getManufacturer() const {
-	CellularHelperStringResponse resp;
-
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGMI\r\n");
-
-	return resp.string;
+	return getIdentityString(identityCache.manufacturer, "CGMI", "AT+CGMI\r\n");
 }
 
 String CellularHelperClass::getModel() const {
-	CellularHelperStringResponse resp;
-
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGMM\r\n");
-
-	return resp.string;
+	return getIdentityString(identityCache.model, "CGMM", "AT+CGMM\r\n");
 }
 
 String CellularHelperClass::getOrderingCode() const {
-	CellularHelperStringResponse resp;
-
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "ATI0\r\n");
-
-	return resp.string;
+	return getIdentityString(identityCache.orderingCode, "ATI0", "ATI0\r\n");
 }
 
 String CellularHelperClass::getFirmwareVersion() const {
-	CellularHelperStringResponse resp;
-
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGMR\r\n");
-
-	return resp.string;
+	return getIdentityString(identityCache.firmwareVersion, "CGMR", "AT+CGMR\r\n");
 }
 
 String CellularHelperClass::getIMEI() const {
-	CellularHelperStringResponse resp;
-
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGSN\r\n");
-
-	return resp.string;
+	return getIdentityString(identityCache.imei, "CGSN", "AT+CGSN\r\n");
 }
 
 String CellularHelperClass::getIMSI() const {
 	CellularHelperStringResponse resp;
 
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGMI\r\n");
+	command("CIMI", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CIMI\r\n");
 
 	return resp.string;
 }
 
 String CellularHelperClass::getICCID() const {
-	CellularHelperPlusStringResponse resp;
-	resp.command = "CCID";
+	std::lock_guard<RecursiveMutex> lock(identityLock);
 
-	Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CCID\r\n");
+	if (identityCache.iccid.length() == 0) {
+		CellularHelperPlusStringResponse resp;
+		resp.command = "CCID";
 
-	return resp.string;
+		resp.resp = command("CCID", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CCID\r\n");
+		if (resp.resp != RESP_OK) {
+			return resp.string;
+		}
+		identityCache.iccid = resp.string;
+	}
+
+	return identityCache.iccid;
 }
 
 bool CellularHelperClass::isSARA_R4() const {
 	return getModel().startsWith("SARA-R4");
 }
 
+void CellularHelperClass::clearIdentityCache() {
+	std::lock_guard<RecursiveMutex> lock(identityLock);
+
+	identityCache.manufacturer = "";
+	identityCache.model = "";
+	identityCache.orderingCode = "";
+	identityCache.firmwareVersion = "";
+	identityCache.imei = "";
+	identityCache.iccid = "";
+}
+
+String CellularHelperClass::getIdentityString(String &cache, const char *name, const char *cmd) const {
+	// Held while the command is sent, so two threads don't both send it or read the cache
+	// while the other is filling it in
+	std::lock_guard<RecursiveMutex> lock(identityLock);
+
+	if (cache.length() == 0) {
+		CellularHelperStringResponse resp;
+
+		resp.resp = command(name, responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "%s", cmd);
+		if (resp.resp != RESP_OK) {
+			// Don't cache errors, so the next call tries again
+			return resp.string;
+		}
+		cache = resp.string;
+	}
+	return cache;
+}
+
 
 String CellularHelperClass::getOperatorName(int operatorNameType) const {
 	String result;
@@ -885,7 +1862,7 @@ String CellularHelperClass::getOperatorName(int operatorNameType) const {
 	CellularHelperPlusStringResponse resp;
 	resp.command = "UDOPN";
 
-	int respCode = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+UDOPN=%d\r\n", operatorNameType);
+	int respCode = command("UDOPN", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+UDOPN=%d\r\n", operatorNameType);
 
 	if (respCode == RESP_OK) {
 		result = resp.getDoubleQuotedPart();
@@ -903,11 +1880,14 @@ CellularHelperRSSIQualResponse CellularHelperClass::getRSSIQual() const {
 	CellularHelperRSSIQualResponse resp;
 	resp.command = "CSQ";
 
-	resp.resp = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CSQ\r\n");
+	resp.resp = command("CSQ", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CSQ\r\n");
 
 	if (resp.resp == RESP_OK) {
 		resp.postProcess();
 	}
+	if (resultQueue) {
+		resultQueue->pushSignal(resp);
+	}
 
 	return resp;
 }
@@ -916,11 +1896,14 @@ CellularHelperExtendedQualResponse CellularHelperClass::getExtendedQual() const
 	CellularHelperExtendedQualResponse resp;
 	resp.command = "CESQ";
 
-	resp.resp = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CESQ\r\n");
+	resp.resp = command("CESQ", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CESQ\r\n");
 
 	if (resp.resp == RESP_OK) {
 		resp.postProcess();
 	}
+	if (resultQueue) {
+		resultQueue->pushSignal(resp);
+	}
 
 	return resp;
 }
@@ -933,7 +1916,7 @@ bool CellularHelperClass::selectOperator(const char *mccMnc) const {
 
 	if (mccMnc == NULL) {
 		// Reset back to automatic mode
-		respCode = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+COPS=0\r\n");
+		respCode = command("COPS", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+COPS=0\r\n");
 		return (respCode == RESP_OK);
 	}
 
@@ -947,11 +1930,11 @@ bool CellularHelperClass::selectOperator(const char *mccMnc) const {
 	if (curMccMnc.length() != 0) {
 		// Disconnect from the current operator if there is an operator set.
 		// On cold boot there won't be a name set and the string will be empty
-		respCode = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+COPS=2\r\n");
+		respCode = command("COPS", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+COPS=2\r\n");
 	}
 
 	// Connect
-	respCode = Cellular.command(responseCallback, (void *)&resp, 60000, "AT+COPS=4,2,\"%s\"\r\n", mccMnc);
+	respCode = command("COPS", responseCallback, (void *)&resp, 60000, "AT+COPS=4,2,\"%s\"\r\n", mccMnc);
 
 	return (respCode == RESP_OK);
 }
@@ -961,8 +1944,10 @@ void CellularHelperClass::getEnvironment(int mode, CellularHelperEnvironmentResp
 	resp.command = "CGED";
 	// resp.enableDebug = true;
 
-	resp.resp = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGED=%d\r\n", mode);
-	
+	resp.resp = command("CGED", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CGED=%d\r\n", mode);
+	if (resultQueue) {
+		resultQueue->pushEnvironment(resp);
+	}
 }
 
 CellularHelperLocationResponse CellularHelperClass::getLocation(unsigned long timeoutMs) const {
@@ -973,11 +1958,11 @@ CellularHelperLocationResponse CellularHelperClass::getLocation(unsigned long ti
 	// resp.enableDebug = true;
 
 	// Initialize the mode
-	resp.resp = Cellular.command(5000, "AT+ULOCCELL=0\r\n");
+	resp.resp = command("ULOCCELL", 5000, "AT+ULOCCELL=0\r\n");
 	if (resp.resp == RESP_OK) {
 		unsigned long startTime = millis();
 
-		resp.resp = Cellular.command(responseCallback, (void *)&resp, timeoutMs, "AT+ULOC=2,2,0,%d,5000\r\n", timeoutMs / 1000);
+		resp.resp = command("ULOC", responseCallback, (void *)&resp, timeoutMs, "AT+ULOC=2,2,0,%lu,5000\r\n", timeoutMs / 1000);
 
 		// This command is weird because it returns an OK, and theoretically could return +UULOC response right away,
 		// but usually does not.
@@ -986,13 +1971,13 @@ CellularHelperLocationResponse CellularHelperClass::getLocation(unsigned long ti
 
 			// In the case where we don't get an immediate response, we send empty commands to the
 			// modem to pick up the late +UULOC response
-			while(!resp.valid && millis() - startTime < timeoutMs) {
+			while(!resp.isValid() && millis() - startTime < timeoutMs) {
 				// Allow for some cloud processing before checking again
 				delay(10);
 
 				// Have not received a response yet. Send an empty command so we can get responses that
 				// come afte the OK due to the weird structure of this command
-				Cellular.command(responseCallback, (void *)&resp, 500, "");
+				command("ULOC_POLL", responseCallback, (void *)&resp, 500, "%s", "");
 				resp.postProcess();
 			}
 		}
@@ -1001,34 +1986,362 @@ CellularHelperLocationResponse CellularHelperClass::getLocation(unsigned long ti
 	return resp;
 }
 
+void CellularHelperClass::getOperatorIndex(CellularHelperOperatorIndex &index, unsigned long timeoutMs) const {
+	index.resp = command("COPN", responseCallback, (void *)&index, timeoutMs, "AT+COPN\r\n");
+}
+
+void CellularHelperClass::getDiagnostics(int fields, CellularHelperDiagnostics &result) const {
+	result.validFields = 0;
+
+	// Values that don't change come from the cache if they've already been retrieved
+	struct {
+		int field;
+		String *cache;
+		String *value;
+	} cached[] = {
+		{ CellularHelperDiagnostics::FIELD_MANUFACTURER, &identityCache.manufacturer, &result.manufacturer },
+		{ CellularHelperDiagnostics::FIELD_MODEL, &identityCache.model, &result.model },
+		{ CellularHelperDiagnostics::FIELD_FIRMWARE_VERSION, &identityCache.firmwareVersion, &result.firmwareVersion },
+		{ CellularHelperDiagnostics::FIELD_IMEI, &identityCache.imei, &result.imei },
+		{ CellularHelperDiagnostics::FIELD_ICCID, &identityCache.iccid, &result.iccid },
+		{ CellularHelperDiagnostics::FIELD_ORDERING_CODE, &identityCache.orderingCode, &result.orderingCode },
+	};
+	const size_t numCached = sizeof(cached) / sizeof(cached[0]);
+
+	int needed = fields;
+	{
+		std::lock_guard<RecursiveMutex> lock(identityLock);
+
+		for(size_t ii = 0; ii < numCached; ii++) {
+			if ((needed & cached[ii].field) != 0 && cached[ii].cache->length() != 0) {
+				*cached[ii].value = *cached[ii].cache;
+				result.validFields |= cached[ii].field;
+				needed &= ~cached[ii].field;
+			}
+		}
+	}
+
+	int batchFields = needed & CellularHelperBatchResponse::BATCH_FIELDS;
+	if (batchFields != 0) {
+		if (sendBatch(batchFields, result) != RESP_OK) {
+			// If any command in the command line fails, the modem returns ERROR and skips the rest, 
+			// so send the ones that are missing separately
+			for(int field = 1; field <= CellularHelperBatchResponse::BATCH_FIELDS; field <<= 1) {
+				if ((batchFields & field) != 0 && !result.isValid(field)) {
+					sendBatch(field, result);
+				}
+			}
+		}
+	}
+
+	if ((needed & CellularHelperDiagnostics::FIELD_ORDERING_CODE) != 0) {
+		CellularHelperStringResponse resp;
+
+		resp.resp = command("ATI0", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "ATI0\r\n");
+		if (resp.resp == RESP_OK) {
+			result.orderingCode = resp.string;
+			result.validFields |= CellularHelperDiagnostics::FIELD_ORDERING_CODE;
+		}
+	}
+
+	if ((needed & CellularHelperDiagnostics::FIELD_ENVIRONMENT) != 0) {
+		getEnvironment(ENVIRONMENT_SERVING_CELL, result.environment);
+		if (result.environment.resp == RESP_OK) {
+			result.validFields |= CellularHelperDiagnostics::FIELD_ENVIRONMENT;
+		}
+	}
+
+	std::lock_guard<RecursiveMutex> lock(identityLock);
+
+	for(size_t ii = 0; ii < numCached; ii++) {
+		if (result.isValid(cached[ii].field)) {
+			*cached[ii].cache = *cached[ii].value;
+		}
+	}
+}
+
+int CellularHelperClass::sendBatch(int fields, CellularHelperDiagnostics &result) const {
+	CellularHelperBatchResponse resp(result, fields);
+
+	char cmd[80];
+	resp.buildCommand(cmd, sizeof(cmd));
+
+	resp.resp = command("BATCH", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "%s", cmd);
+	return resp.resp;
+}
+
+#if CELLULARHELPER_ENABLE_URC
+bool CellularHelperClass::startLocation(CellularHelperLocationResponse &resp, unsigned long timeoutMs) const {
+	// There is only one +UULOC handler, so a second request would replace the first one's resp
+	if (locationStarted.exchange(true)) {
+		Log.info("location request already started");
+		return false;
+	}
+
+	resp.string = "";
+	resp.valid = false;
+
+	// Note: Command is ULOC, but the response is UULOC
+	resp.command = "UULOC";
+
+	if (cellular_add_urc_handler("+UULOC", locationUrcCallback, (void *)&resp) != 0) {
+		Log.info("could not add +UULOC handler");
+		locationStarted = false;
+		return false;
+	}
+
+	// Initialize the mode
+	resp.resp = command("ULOCCELL", 5000, "AT+ULOCCELL=0\r\n");
+	if (resp.resp == RESP_OK) {
+		// The +UULOC usually arrives later as a URC, but if it arrives before the OK it's
+		// handled by the same callback here
+		resp.resp = command("ULOC", locationUrcCallback, (void *)&resp, timeoutMs, "AT+ULOC=2,2,0,%lu,5000\r\n", timeoutMs / 1000);
+	}
+	if (resp.resp != RESP_OK) {
+		stopLocation();
+		return false;
+	}
+	return true;
+}
+
+void CellularHelperClass::stopLocation() const {
+	cellular_remove_urc_handler("+UULOC");
+	locationStarted = false;
+}
+
+// [static]
+int CellularHelperClass::locationUrcCallback(int type, const char* buf, int len, void *param) {
+	CellularHelperLocationResponse *presp = (CellularHelperLocationResponse *)param;
+
+	// This runs on the system thread. parse() only uses the first +UULOC and sets valid
+	// after the other values.
+	presp->parse(type, buf, len);
+	return WAIT;
+}
+#endif /* CELLULARHELPER_ENABLE_URC */
+
 void CellularHelperClass::getCREG(CellularHelperCREGResponse &resp) const {
 	int tempResp;
 
-	tempResp = Cellular.command(DEFAULT_TIMEOUT, "AT+CREG=2\r\n");
+#if CELLULARHELPER_ENABLE_URC
+	if (registrationMonitor) {
+		// The monitor needs +CREG reporting left on, and it already has the current values. If
+		// it hasn't received any yet, reporting is on, so AT+CREG? includes the LAC and CI.
+		resp = registrationMonitor->getCREG();
+		if (!resp.valid) {
+			resp.command = "CREG";
+			resp.resp = command("CREG", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CREG?\r\n");
+			if (resp.resp == RESP_OK) {
+				resp.postProcess();
+			}
+		}
+		if (resp.valid && resultQueue) {
+			resultQueue->pushRegistration(resp, false);
+		}
+		return;
+	}
+#endif /* CELLULARHELPER_ENABLE_URC */
+
+	tempResp = command("CREG", DEFAULT_TIMEOUT, "AT+CREG=2\r\n");
 	if (tempResp == RESP_OK) {
 		resp.command = "CREG";
-		resp.resp = Cellular.command(responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CREG?\r\n");
+		resp.resp = command("CREG", responseCallback, (void *)&resp, DEFAULT_TIMEOUT, "AT+CREG?\r\n");
 		if (resp.resp == RESP_OK) {
 			resp.postProcess();
+			if (resultQueue) {
+				resultQueue->pushRegistration(resp, false);
+			}
 
 			// Set back to default
-			tempResp = Cellular.command(DEFAULT_TIMEOUT, "AT+CREG=0\r\n");
+			tempResp = command("CREG", DEFAULT_TIMEOUT, "AT+CREG=0\r\n");
+		}
+	}
+}
+
+
+
+int CellularHelperClass::command(const char *name, int (*cb)(int type, const char* buf, int len, void *param), void *param, system_tick_t timeout, const char *format, ...) const {
+	char cmd[COMMAND_BUF_SIZE];
+
+	va_list ap;
+	va_start(ap, format);
+	int len = vsnprintf(cmd, sizeof(cmd), format, ap);
+	va_end(ap);
+
+	if (len < 0 || (size_t)len >= sizeof(cmd)) {
+		// Sending the truncated command would send the wrong thing, or no CR, to the modem
+		Log.info("%s command too long (%d bytes)", name, len);
+		return RESP_ERROR;
+	}
+
+	return sendCommand(name, cb, param, timeout, cmd);
+}
+
+int CellularHelperClass::command(const char *name, system_tick_t timeout, const char *format, ...) const {
+	char cmd[COMMAND_BUF_SIZE];
+
+	va_list ap;
+	va_start(ap, format);
+	int len = vsnprintf(cmd, sizeof(cmd), format, ap);
+	va_end(ap);
+
+	if (len < 0 || (size_t)len >= sizeof(cmd)) {
+		// Sending the truncated command would send the wrong thing, or no CR, to the modem
+		Log.info("%s command too long (%d bytes)", name, len);
+		return RESP_ERROR;
+	}
+
+	return sendCommand(name, NULL, NULL, timeout, cmd);
+}
+
+int CellularHelperClass::sendCommand(const char *name, int (*cb)(int type, const char* buf, int len, void *param), void *param, system_tick_t timeout, const char *cmd) const {
+	if (!commandStats) {
+		if (cb) {
+			return Cellular.command(cb, param, timeout, "%s", cmd);
+		}
+		else {
+			return Cellular.command(timeout, "%s", cmd);
 		}
 	}
+
+	CommandContext context;
+	context.cb = cb;
+	context.param = param;
+	context.bytes = 0;
+
+	unsigned long start = millis();
+	int resp = Cellular.command(commandCallback, (void *)&context, timeout, "%s", cmd);
+
+	commandStats->record(name, resp, millis() - start, context.bytes);
+	return resp;
 }
 
+// [static]
+int CellularHelperClass::commandCallback(int type, const char* buf, int len, void *param) {
+	CommandContext *context = (CommandContext *)param;
 
+	context->bytes += (size_t)len;
+	if (context->cb) {
+		return context->cb(type, buf, len, context->param);
+	}
+	return WAIT;
+}
 
 // There isn't an overload of String that takes a buffer and length, but that's what comes back from
 // the Cellular.command callback, so that's why this method exists.
 // [static]
 void CellularHelperClass::appendBufferToString(String &str, const char *buf, int len, bool noEOL) {
+	if (!buf || len <= 0) {
+		return;
+	}
 	str.reserve(str.length() + (size_t)len + 1);
-	for(int ii = 0; ii < len; ii++) {
-		if (!noEOL || (buf[ii] != '\r' && buf[ii] != '\n')) {
-			str.concat(buf[ii]);
+
+	// Runs are copied through a small null terminated chunk, since concat only takes a c-string
+	char chunk[APPEND_CHUNK_SIZE];
+	size_t offset = 0;
+	while(offset < (size_t)len) {
+		size_t runLen = findRunLength(&buf[offset], (size_t)len - offset, noEOL);
+
+		while(runLen > 0) {
+			size_t chunkLen = (runLen < sizeof(chunk) - 1) ? runLen : sizeof(chunk) - 1;
+			memcpy(chunk, &buf[offset], chunkLen);
+			chunk[chunkLen] = 0;
+			str.concat(chunk);
+
+			offset += chunkLen;
+			runLen -= chunkLen;
+		}
+
+		// Skip the CR, LF, or null that ended the run
+		offset++;
+	}
+}
+
+// [static]
+size_t CellularHelperClass::appendBufferToBuffer(char *dst, size_t dstSize, size_t dstLen, const char *buf, int len, bool noEOL) {
+	if (!dst || dstSize == 0) {
+		return 0;
+	}
+	if (dstLen > dstSize - 1) {
+		dstLen = dstSize - 1;
+	}
+
+	size_t offset = 0;
+	while(buf && len > 0 && offset < (size_t)len && dstLen < dstSize - 1) {
+		size_t runLen = findRunLength(&buf[offset], (size_t)len - offset, noEOL);
+
+		// Truncate if necessary, leaving room for the null terminator
+		if (runLen > dstSize - 1 - dstLen) {
+			runLen = dstSize - 1 - dstLen;
+		}
+		memcpy(&dst[dstLen], &buf[offset], runLen);
+		dstLen += runLen;
+
+		offset += runLen + 1;
+	}
+	dst[dstLen] = 0;
+
+	return dstLen;
+}
+
+// [static]
+size_t CellularHelperClass::findRunLength(const char *buf, size_t len, bool noEOL) {
+	if (!noEOL) {
+		const char *nul = (const char *) memchr(buf, 0, len);
+		return nul ? (size_t)(nul - buf) : len;
+	}
+
+	// Check a word at a time for a byte that is CR, LF, or null. For each one, a byte in x is 0
+	// when it matches, and (x - 0x01010101) & ~x has the high bit set in the first zero byte.
+	size_t ii = 0;
+	for(; ii + sizeof(uint32_t) <= len; ii += sizeof(uint32_t)) {
+		uint32_t word;
+		memcpy(&word, &buf[ii], sizeof(word));
+
+		uint32_t cr = word ^ 0x0d0d0d0dUL;
+		uint32_t lf = word ^ 0x0a0a0a0aUL;
+		uint32_t found = ((cr - 0x01010101UL) & ~cr) | ((lf - 0x01010101UL) & ~lf) | ((word - 0x01010101UL) & ~word);
+		if (found & 0x80808080UL) {
+			break;
+		}
+	}
+
+	// Find the byte in the word, or check the bytes after the last whole word
+	for(; ii < len; ii++) {
+		if (buf[ii] == '\r' || buf[ii] == '\n' || buf[ii] == 0) {
+			break;
+		}
+	}
+	return ii;
+}
+
+// [static]
+const char *CellularHelperClass::findPlusResponse(const char *buf, int len, const char *command, size_t commandLen, size_t &valueLen) {
+	// Looking for "+" command ": " at the start of a line without copying buf or building the
+	// search string. Responses start with "\r\n", but URC handlers may get the line without it.
+	const char *end = buf + len;
+	const char *cur = buf;
+
+	while(cur < end) {
+		if ((size_t)(end - cur) >= commandLen + 3 && cur[0] == '+' && memcmp(&cur[1], command, commandLen) == 0 && 
+			cur[commandLen + 1] == ':' && cur[commandLen + 2] == ' ') {
+			const char *value = &cur[commandLen + 3];
+
+			const char *valueEnd = value;
+			while(valueEnd < end && *valueEnd != '\r' && *valueEnd != '\n') {
+				valueEnd++;
+			}
+			valueLen = valueEnd - value;
+			return value;
+		}
+
+		const char *lf = (const char *)memchr(cur, '\n', end - cur);
+		if (!lf) {
+			break;
 		}
+		cur = lf + 1;
 	}
+	return NULL;
 }
 
 // [static]
@@ -1049,6 +2362,11 @@ int CellularHelperClass::rssiToBars(int rssi) {
 int CellularHelperClass::responseCallback(int type, const char* buf, int len, void *param) {
 	CellularHelperCommonResponse *presp = (CellularHelperCommonResponse *)param;
 
+	// Not expected from Device OS, but the parsers use len as a size_t
+	if (buf == NULL || len < 0) {
+		return WAIT;
+	}
+
 	return presp->parse(type, buf, len);
 }
 
@@ -3,9 +3,22 @@
 
 #include "Particle.h"
 
+#include <atomic>
 
 #if Wiring_Cellular
 
+// Registering handlers for unsolicited result codes (URCs) like +UULOC and +CREG requires
+// cellular_add_urc_handler, which is available in Device OS 1.0.0 and later.
+#if defined(SYSTEM_VERSION_v100) && (SYSTEM_VERSION >= SYSTEM_VERSION_v100)
+#define CELLULARHELPER_ENABLE_URC 1
+#else
+#define CELLULARHELPER_ENABLE_URC 0
+#endif
+
+
+class CellularHelperCommandStats;
+class CellularHelperResultQueue;
+class CellularHelperRegistrationMonitorClass;
 
 // Class for quering information directly from the u-blox SARA modem
 
@@ -35,6 +48,52 @@ public:
 	 */
 	bool enableDebug = false;
 
+	/**
+	 * @brief Maximum number of response bytes to log when enableDebug is true (default: 0, no limit)
+	 *
+	 * Once the budget is used up the rest of the response is counted in debugSuppressed instead of
+	 * being logged, so debugging can be left on for large responses like AT+COPN.
+	 */
+	size_t debugMaxBytes = 0;
+
+	/**
+	 * @brief Maximum number of log lines to write when enableDebug is true (default: 0, no limit)
+	 */
+	size_t debugMaxLines = 0;
+
+	/**
+	 * @brief Number of response bytes logged so far
+	 */
+	size_t debugBytes = 0;
+
+	/**
+	 * @brief Number of log lines written so far
+	 */
+	size_t debugLines = 0;
+
+	/**
+	 * @brief Number of response bytes not logged because the budget was used up
+	 */
+	size_t debugSuppressed = 0;
+
+	/**
+	 * @brief Size of the stack buffer used for each log line, including the null terminator
+	 *
+	 * Longer response lines are split across multiple log lines.
+	 */
+	static const size_t DEBUG_LINE_SIZE = 96;
+
+	/**
+	 * @brief Enables debug mode with a budget, typically one response object per command
+	 *
+	 * @param maxBytes Maximum number of response bytes to log, or 0 for no limit.
+	 *
+	 * @param maxLines Maximum number of log lines to write, or 0 for no limit.
+	 *
+	 * This also resets the debugBytes, debugLines, and debugSuppressed counters.
+	 */
+	void setDebugBudget(size_t maxBytes, size_t maxLines);
+
 	/**
 	 * @brief Method to parse the output from the modem
 	 * 
@@ -59,8 +118,50 @@ public:
 	 * @param buf a pointer to the character array containing the AT command response.
 	 * 
 	 * @param len length of the AT command response buf.
+	 *
+	 * This does not allocate memory. Each line is escaped into a stack buffer of DEBUG_LINE_SIZE bytes
+	 * and logged once. Output stops when debugMaxBytes or debugMaxLines is reached.
+	 */
+	void logCellularDebug(int type, const char *buf, int len);
+
+	/**
+	 * @brief Gets the name of a Cellular.command callback type, such as "TYPE_PLUS"
+	 *
+	 * @return The name, or NULL if type is not a known type.
+	 */
+	static const char *getTypeName(int type);
+
+	/**
+	 * @brief Escapes one line of a response for logging
+	 *
+	 * @param line Buffer to write to. It is always null terminated.
+	 *
+	 * @param lineSize Size of line in bytes. Must be at least 5.
+	 *
+	 * @param buf The response buffer.
+	 *
+	 * @param len Length of buf.
+	 *
+	 * @param offset On entry, the offset in buf to start at. On return, the offset of the first byte
+	 * that was not escaped.
+	 *
+	 * @return The number of characters written to line, not including the null terminator.
+	 *
+	 * Printable characters are copied as-is, CR and LF become `\r` and `\n`, and other bytes become
+	 * `\xNN`. This stops after a LF or when line is full.
+	 */
+	static size_t escapeDebugLine(char *line, size_t lineSize, const char *buf, size_t len, size_t &offset);
+
+protected:
+	/**
+	 * @brief Returns true if debugMaxBytes or debugMaxLines has been reached
+	 */
+	bool isDebugBudgetUsed() const;
+
+	/**
+	 * @brief Adds bytes to debugSuppressed, logging a message the first time
 	 */
-	void logCellularDebug(int type, const char *buf, int len) const;
+	void suppressDebug(size_t bytes);
 };
 
 /**
@@ -144,6 +245,215 @@ public:
 	String getDoubleQuotedPart(bool onlyFirst = true) const;
 };
 
+/**
+ * @brief Things that return a + response use this to store the result in a fixed buffer
+ * 
+ * This works like CellularHelperPlusStringResponse, except the result is written into a
+ * caller-supplied buffer instead of a String, and the response is scanned in place. No heap
+ * allocation is done while parsing, which makes it suitable for commands that are polled 
+ * frequently, like AT+CSQ and AT+CESQ.
+ * 
+ * You may want to use CellularHelperPlusBufferResponseStatic<> instead of separately allocating
+ * the buffer.
+ *
+ * Since it inherits from CellularHelperCommonResponse you
+ * can check resp == RESP_OK to make sure the call succeeded.
+ */
+class CellularHelperPlusBufferResponse : public CellularHelperCommonResponse {
+public:
+	/**
+	 * @brief Constructor that takes an external buffer
+	 * 
+	 * @param buffer Buffer to store the result in. Will always be null terminated.
+	 * 
+	 * @param bufferSize Size of buffer in bytes, including the null terminator. Longer results
+	 * are truncated.
+	 */
+	CellularHelperPlusBufferResponse(char *buffer, size_t bufferSize);
+
+	/**
+	 * @brief Sets the command to look for (not including the AT+ part)
+	 * 
+	 * @param command The command, for example "CSQ". This pointer is stored, not copied, so 
+	 * it must remain valid; a string constant is typical.
+	 * 
+	 * The length is calculated once here so it does not need to be done for every response.
+	 */
+	void setCommand(const char *command);
+
+	/**
+	 * @brief Clear the result so the object can be reused
+	 */
+	void clear();
+
+	/**
+	 * @brief Method to parse the output from the modem
+	 * 
+	 * @param type one of 13 different enumerated AT command response types.
+	 * 
+	 * @param buf a pointer to the character array containing the AT command response.
+	 * 
+	 * @param len length of the AT command response buf.
+	 * 
+	 * This is called from responseCallback, which is the callback to Cellular.command.
+	 * 
+	 * This class appends all + responses (TYPE_PLUS) that match command into buffer.
+	 */
+	virtual int parse(int type, const char *buf, int len);
+
+	/**
+	 * @brief The command to look for, set using setCommand()
+	 */
+	const char *command = "";
+
+	/**
+	 * @brief The length of command
+	 */
+	size_t commandLen = 0;
+
+	/**
+	 * @brief The buffer the result is stored in. Always null terminated.
+	 */
+	char *buffer;
+
+	/**
+	 * @brief The size of buffer in bytes
+	 */
+	size_t bufferSize;
+
+	/**
+	 * @brief The number of bytes currently in buffer, not including the null terminator
+	 */
+	size_t length = 0;
+};
+
+/**
+ * @brief Response class for a + response with a statically allocated result buffer
+ * 
+ * @param BUFFER_SIZE templated parameter for the size of the buffer, including the null terminator.
+ */
+template <size_t BUFFER_SIZE>
+class CellularHelperPlusBufferResponseStatic : public CellularHelperPlusBufferResponse {
+public:
+	explicit CellularHelperPlusBufferResponseStatic() : CellularHelperPlusBufferResponse(staticBuffer, BUFFER_SIZE) {
+	}
+
+protected:
+	/**
+	 * @brief Buffer to hold the result
+	 */
+	char staticBuffer[BUFFER_SIZE];
+};
+
+/**
+ * @brief Parses comma separated numeric fields, like the + responses to AT+CSQ, AT+CESQ, and AT+CREG
+ * 
+ * This is a small, single-pass replacement for sscanf for the formats the modem uses. Fields 
+ * can optionally be surrounded by double quotes, which are removed, and leading spaces are 
+ * ignored. The buffer does not need to be null terminated and is not modified.
+ * 
+ * ```
+ * CellularHelperFieldParser parser("2,1,\"FFFE\",\"C45C010\",8");
+ * int n, stat, lac;
+ * parser.nextInt(n);
+ * parser.nextInt(stat);
+ * parser.nextInt(lac, 16);
+ * ```
+ */
+class CellularHelperFieldParser {
+public:
+	/**
+	 * @brief Constructor for a buffer and length
+	 * 
+	 * @param buf The buffer to parse. Does not need to be null terminated.
+	 * 
+	 * @param len The number of bytes in buf.
+	 */
+	CellularHelperFieldParser(const char *buf, size_t len);
+
+	/**
+	 * @brief Constructor for a null terminated string
+	 * 
+	 * @param str The string to parse.
+	 */
+	CellularHelperFieldParser(const char *str);
+
+	/**
+	 * @brief Parses the next field as an integer
+	 * 
+	 * @param value Filled in with the value. Only changed if true is returned.
+	 * 
+	 * @param base The number base, 10 (default) or 16 for hex.
+	 * 
+	 * @return true if a number was parsed, or false if there are no more fields or the field
+	 * does not begin with a number. Any characters after the number in the field are ignored.
+	 */
+	bool nextInt(int &value, int base = 10);
+
+	/**
+	 * @brief Parses the next field as a decimal number, such as a latitude
+	 * 
+	 * @param value Filled in with the value. Only changed if true is returned.
+	 * 
+	 * @return true if a number was parsed, or false if there are no more fields or the field
+	 * does not begin with a number.
+	 */
+	bool nextFloat(float &value);
+
+	/**
+	 * @brief Skips the next field
+	 * 
+	 * @return true if a field was skipped, or false if there are no more fields.
+	 */
+	bool skipField();
+
+	/**
+	 * @brief Returns true if the next field is surrounded by double quotes
+	 * 
+	 * Values that are hex in AT command responses are typically quoted.
+	 */
+	bool isNextQuoted() const;
+
+	/**
+	 * @brief Returns true if there are no more fields
+	 */
+	bool atEnd() const { return cur >= end; };
+
+	/**
+	 * @brief Parses an integer from a buffer (used internally)
+	 * 
+	 * @param buf The buffer. Does not need to be null terminated. Leading spaces and an optional 
+	 * sign are allowed.
+	 * 
+	 * @param len The number of bytes in buf.
+	 * 
+	 * @param base The number base, 10 or 16.
+	 * 
+	 * @param value Filled in with the value. Only changed if true is returned.
+	 * 
+	 * @return true if at least one digit was parsed.
+	 */
+	static bool parseInt(const char *buf, size_t len, int base, int &value);
+
+protected:
+	/**
+	 * @brief Gets the next field, without leading spaces or an opening double quote, and moves past it
+	 * 
+	 * @return true if there was a field, or false if there are no more fields.
+	 */
+	bool nextField(const char *&field, size_t &fieldLen);
+
+	/**
+	 * @brief Current position in the buffer
+	 */
+	const char *cur;
+
+	/**
+	 * @brief End of the buffer (one past the last byte)
+	 */
+	const char *end;
+};
+
 /**
  * @brief This class is used to return the rssi and qual values (AT+CSQ)
  *
@@ -280,13 +590,69 @@ public:
 };
 
 
+/**
+ * @brief Splits a buffer into tokens without copying or modifying it
+ * 
+ * This works like strtok_r, except the buffer does not need to be null terminated, it is not
+ * modified, and no copy is made. Each token is returned as a pointer into the original buffer
+ * and a length. Like strtok_r, consecutive delimiters are treated as one, so empty tokens are 
+ * never returned.
+ * 
+ * Used internally to parse the data passed to the Cellular.command callback in place.
+ */
+class CellularHelperTokenizer {
+public:
+	/**
+	 * @brief Constructor
+	 * 
+	 * @param buf The buffer to tokenize. Does not need to be null terminated.
+	 * 
+	 * @param len The number of bytes in buf.
+	 * 
+	 * @param delimiters A null terminated string of delimiter characters, for example "\r\n" or ",".
+	 */
+	CellularHelperTokenizer(const char *buf, size_t len, const char *delimiters);
+
+	/**
+	 * @brief Gets the next token
+	 * 
+	 * @param token Filled in with a pointer to the start of the token in buf.
+	 * 
+	 * @param tokenLen Filled in with the length of the token.
+	 * 
+	 * @return true if a token was returned or false if there are no more tokens.
+	 */
+	bool next(const char *&token, size_t &tokenLen);
+
+protected:
+	/**
+	 * @brief Returns true if ch is one of the delimiters
+	 */
+	bool isDelimiter(char ch) const;
+
+	/**
+	 * @brief Current position in the buffer
+	 */
+	const char *cur;
+
+	/**
+	 * @brief End of the buffer (one past the last byte)
+	 */
+	const char *end;
+
+	/**
+	 * @brief Delimiter characters (null terminated)
+	 */
+	const char *delimiters;
+};
+
 /**
  * @brief Used to hold the results for one cell (service or neighbor) from the AT+CGED command
  * 
  * You will normally use CellularHelperEnvironmentResponseStatic<> or CellularHelperEnvironmentResponse 
  * which includes this as a member.
  */
-class CellularHelperEnvironmentCellData { // 44 bytes
+class CellularHelperEnvironmentCellData { // 48 bytes
 public:
 	/**
 	 * @brief Mobile Country Code
@@ -347,6 +713,11 @@ public:
 	 */ 
 	bool isUMTS = false;
 
+	/**
+	 * @brief RAT is LTE (E-UTRAN). If true, isUMTS is false.
+	 */ 
+	bool isLTE = false;
+
 	/**
 	 * @brief Downlink frequency. 
 	 * 
@@ -373,6 +744,18 @@ public:
 	 */
 	int rscpLev = 255;
 
+	/**
+	 * @brief E-UTRA Absolute Radio Frequency Channel Number (downlink) [LTE only]
+	 * 
+	 * - Range 0 - 70645. -1 if not known.
+	 *
+	 * This is set from an EARFCN:value key in the same key:value format as AT+CGED and AT+COPS=5.
+	 * The 2G and 3G u-blox modems do not report LTE cells, and the SARA-R4 reports the EARFCN with
+	 * AT+UCGED, which has a different format that is not parsed here. So this is currently only
+	 * set when a modem uses that key:value format for LTE cells; otherwise it stays -1.
+	 */
+	int earfcn = -1;
+
 	/**
 	 * @brief Returns true if this object looks valid
 	 *
@@ -395,6 +778,16 @@ public:
 	 */
 	void parse(const char *str);
 
+	/**
+	 * @brief Parses the output from the modem in place (used internally)
+	 * 
+	 * @param str The comma separated response from the modem to parse. Does not need to be null 
+	 * terminated, and is not modified.
+	 * 
+	 * @param len The length of str.
+	 */
+	void parse(const char *str, size_t len);
+
 	/**
 	 * @brief Add a key-value pair (used internally)
 	 * 
@@ -403,6 +796,19 @@ public:
 	 */ 
 	void addKeyValue(const char *key, const char *value);
 
+	/**
+	 * @brief Add a key-value pair that is not null terminated (used internally)
+	 * 
+	 * @param key The key, case insensitive. Does not need to be null terminated.
+	 * 
+	 * @param keyLen The length of key.
+	 * 
+	 * @param value The value. Does not need to be null terminated.
+	 * 
+	 * @param valueLen The length of value.
+	 */ 
+	void addKeyValue(const char *key, size_t keyLen, const char *value, size_t valueLen);
+
 	/**
 	 * @brief Returns a readable representation of this object as a String
 	 * 
@@ -421,9 +827,26 @@ public:
 	 * Note that for 2G, 1800 is returned for the 1900 MHz band. This is because they
 	 * use the same arfcn values. So 1800 really means 1800 or 1900 MHz for 2G.
 	 * 
+	 * For LTE, the nominal frequency of the E-UTRA band containing earfcn is returned,
+	 * for example 700 for band 13. Use getLTEBand() to get the band number.
 	 */
 	int getBand() const;
 
+	/**
+	 * @brief Calculated field to determine the E-UTRA operating band number [LTE only]
+	 * 
+	 * For example, 2, 4, 12, or 13. Returns 0 if not LTE or earfcn is not a known downlink EARFCN.
+	 */
+	int getLTEBand() const;
+
+	/**
+	 * @brief Calculated field for the downlink carrier frequency in MHz [LTE only]
+	 * 
+	 * For example, earfcn 5230 is 751.0 MHz. Returns 0 if not LTE or earfcn is not a known
+	 * downlink EARFCN.
+	 */
+	float getLTEDownlinkFrequency() const;
+
 	/**
 	 * @brief Returns a readable string that identifies the cellular frequency band
 	 * 
@@ -431,6 +854,8 @@ public:
 	 * 
 	 * Example 2G: `rat=GSM mcc=310, mnc=260, lac=ab22 ci=a78a band=DCS 1800 or 1900 rssi=-97 bsic=23 arfcn=596 rxlev=24`
 	 * 
+	 * Example LTE: `rat=LTE mcc=310, mnc=410, lac=2d0f ci=a1b2c03 band=LTE B13 700 rssi=-85 earfcn=5230`
+	 * 
 	 */
 	String getBandString() const;
 
@@ -459,43 +884,216 @@ public:
 };
 
 /**
- * @brief Used to hold the results from the AT+CGED command
+ * @brief Compact version of CellularHelperEnvironmentCellData
  * 
- * You may want to use CellularHelperEnvironmentResponseStatic<> instead of separately allocating this
- * object and the array of CellularHelperEnvironmentCellData. 
+ * CellularHelperEnvironmentCellData is 48 bytes, mostly int fields. This class holds the same 
+ * information in 16 bytes by storing each field in only as many bits as its range requires, 
+ * so you can store three times as many cells in the same amount of RAM.
  * 
- * Using this class with the default contructor is handy if you are using ENVIRONMENT_SERVING_CELL mode
- * with CellularHelper.getLocation()
+ * | Field         | Bits | Note |
+ * | :------------ | :--: | :--- |
+ * | ci            | 28   | |
+ * | RAT           | 2    | GSM, UMTS, or LTE |
+ * | mcc           | 10   | 1023 if not valid |
+ * | mnc           | 10   | 1023 if not valid |
+ * | bsic          | 6    | 2G only |
+ * | lac           | 16   | |
+ * | chan1         | 16   | arfcn (2G), dlf (3G), or low 16 bits of earfcn (LTE) |
+ * | chan2         | 16   | ulf (3G) |
+ * | earfcn high   | 1    | bit 16 of earfcn (LTE) |
+ * | level         | 8    | rxlev (2G and LTE) or rscpLev (3G) |
+ * 
+ * Use pack() and unpack() to convert to and from CellularHelperEnvironmentCellData.
  */
-class CellularHelperEnvironmentResponse : public CellularHelperPlusStringResponse {
+class CellularHelperPackedCellData { // 16 bytes
 public:
 	/**
-	 * @brief Constructor for AT+CGED without neighbor data
-	 * 
-	 * Since only the Electron 2G (SARA-G350) supports getting neighbor data, this constructor can be
-	 * used with ENVIRONMENT_SERVING_CELL to get only the serving cell.
+	 * @brief Constructs an empty (not valid) object
 	 */
-	CellularHelperEnvironmentResponse();
+	CellularHelperPackedCellData();
 
 	/**
-	 * @brief Constructor that takes an external array of CellularHelperEnvironmentCellData 
-	 * 
-	 * @param neighbors Pointer to array of CellularHelperEnvironmentCellData. Can be NULL.
-	 * 
-	 * @param numNeighbors Number of items in neighbors. Can be 0.
-	 * 
-	 * The templated CellularHelperEnvironmentResponseStatic<> uses this constructor but eliminates the 
-	 * need to separately allocate the neighbor CellularHelperEnvironmentCellData and may be easier
-	 * to use. 
+	 * @brief Constructs an object from a CellularHelperEnvironmentCellData
 	 */
-	CellularHelperEnvironmentResponse(CellularHelperEnvironmentCellData *neighbors, size_t numNeighbors);
+	explicit CellularHelperPackedCellData(const CellularHelperEnvironmentCellData &data);
 
 	/**
-	 * @brief Information about the service cell (the one you're connected to)
+	 * @brief Stores the values in data in this object
 	 * 
-	 * Filled in in both ENVIRONMENT_SERVING_CELL and ENVIRONMENT_SERVING_CELL_AND_NEIGHBORS modes.
+	 * Values outside the range of a field are stored as not valid (mcc, mnc, ci, earfcn) or
+	 * truncated to the size of the field (others). 
 	 */
-	CellularHelperEnvironmentCellData service;
+	void pack(const CellularHelperEnvironmentCellData &data);
+
+	/**
+	 * @brief Copies the values from this object into data
+	 * 
+	 * Fields that do not apply to the RAT are set to 0, except rscpLev, which is set to 255, and 
+	 * earfcn, which is set to -1.
+	 */
+	void unpack(CellularHelperEnvironmentCellData &data) const;
+
+	/**
+	 * @brief Mobile Country Code (0 - 999), or 65535 if not valid, the same as CellularHelperEnvironmentCellData
+	 */
+	int getMCC() const;
+
+	/**
+	 * @brief Mobile Network Code (0 - 999), or 255 if not valid, the same as CellularHelperEnvironmentCellData
+	 */
+	int getMNC() const;
+
+	/**
+	 * @brief Location Area Code (0 - 0xffff)
+	 */
+	int getLAC() const { return lac; };
+
+	/**
+	 * @brief Cell Identity (0 - 0xfffffff). 0xfffffff is not valid.
+	 */
+	int getCI() const { return (int)(ciRat & CI_MASK); };
+
+	/**
+	 * @brief Returns true if RAT is UMTS (3G)
+	 */
+	bool isUMTS() const { return getRAT() == RAT_UMTS; };
+
+	/**
+	 * @brief Returns true if RAT is LTE
+	 */
+	bool isLTE() const { return getRAT() == RAT_LTE; };
+
+	/**
+	 * @brief Base Station Identify Code [2G only]
+	 */
+	int getBSIC() const { return (int)((mccMncBsic >> BSIC_SHIFT) & BSIC_MASK); };
+
+	/**
+	 * @brief Absolute Radio Frequency Channel Number, including the band indicator bit [2G only]
+	 */
+	int getARFCN() const { return isUMTS() || isLTE() ? 0 : chan1; };
+
+	/**
+	 * @brief Downlink frequency [3G only]
+	 */
+	int getDLF() const { return isUMTS() ? chan1 : 0; };
+
+	/**
+	 * @brief Uplink frequency [3G only]
+	 */
+	int getULF() const { return isUMTS() ? chan2 : 0; };
+
+	/**
+	 * @brief E-UTRA Absolute Radio Frequency Channel Number [LTE only]. -1 if not known.
+	 */
+	int getEARFCN() const;
+
+	/**
+	 * @brief Received signal level. This is rscpLev for 3G and rxlev otherwise.
+	 */
+	int getLevel() const { return level; };
+
+	/**
+	 * @brief Returns true if this object looks valid
+	 *
+	 * @param ignoreCI Don't check the cell identifier. See CellularHelperEnvironmentCellData::isValid().
+	 */
+	bool isValid(bool ignoreCI = false) const;
+
+	/**
+	 * @brief Get the RSSI (received signal strength indication), the same as CellularHelperEnvironmentCellData::getRSSI()
+	 */
+	int getRSSI() const;
+
+	/**
+	 * @brief Returns a readable representation of this object as a String, the same as CellularHelperEnvironmentCellData::toString()
+	 */
+	String toString() const;
+
+protected:
+	/**
+	 * @brief Radio access technology values stored in ciRat
+	 */
+	enum {
+		RAT_GSM = 0,
+		RAT_UMTS = 1,
+		RAT_LTE = 2
+	};
+
+	static const uint32_t CI_MASK = 0xfffffff;		//!< ci in bits 0 - 27 of ciRat
+	static const int RAT_SHIFT = 28;				//!< RAT in bits 28 - 29 of ciRat
+	static const uint32_t RAT_MASK = 0x3;
+	static const uint32_t EARFCN_HIGH_BIT = 0x40000000;	//!< Bit 16 of earfcn in bit 30 of ciRat
+	static const uint32_t MCC_MNC_MASK = 0x3ff;		//!< mcc in bits 0 - 9, mnc in bits 10 - 19 of mccMncBsic
+	static const int MNC_SHIFT = 10;
+	static const int BSIC_SHIFT = 20;				//!< bsic in bits 20 - 25 of mccMncBsic
+	static const uint32_t BSIC_MASK = 0x3f;
+
+	/**
+	 * @brief Returns RAT_GSM, RAT_UMTS, or RAT_LTE
+	 */
+	int getRAT() const { return (int)((ciRat >> RAT_SHIFT) & RAT_MASK); };
+
+	uint32_t ciRat;			//!< ci, RAT, and earfcn bit 16
+	uint32_t mccMncBsic;	//!< mcc, mnc, and bsic
+	uint16_t lac;			//!< Location area code
+	uint16_t chan1;			//!< arfcn (2G), dlf (3G), or earfcn bits 0 - 15 (LTE)
+	uint16_t chan2;			//!< ulf (3G)
+	uint8_t level;			//!< rxlev (2G, LTE) or rscpLev (3G)
+	uint8_t reserved;		//!< Always 0
+};
+
+/**
+ * @brief Used to hold the results from the AT+CGED command
+ * 
+ * You may want to use CellularHelperEnvironmentResponseStatic<> instead of separately allocating this
+ * object and the array of CellularHelperEnvironmentCellData. 
+ * 
+ * Using this class with the default contructor is handy if you are using ENVIRONMENT_SERVING_CELL mode
+ * with CellularHelper.getLocation()
+ */
+class CellularHelperEnvironmentResponse : public CellularHelperPlusStringResponse {
+public:
+	/**
+	 * @brief Constructor for AT+CGED without neighbor data
+	 * 
+	 * Since only the Electron 2G (SARA-G350) supports getting neighbor data, this constructor can be
+	 * used with ENVIRONMENT_SERVING_CELL to get only the serving cell.
+	 */
+	CellularHelperEnvironmentResponse();
+
+	/**
+	 * @brief Constructor that takes an external array of CellularHelperEnvironmentCellData 
+	 * 
+	 * @param neighbors Pointer to array of CellularHelperEnvironmentCellData. Can be NULL.
+	 * 
+	 * @param numNeighbors Number of items in neighbors. Can be 0.
+	 * 
+	 * The templated CellularHelperEnvironmentResponseStatic<> uses this constructor but eliminates the 
+	 * need to separately allocate the neighbor CellularHelperEnvironmentCellData and may be easier
+	 * to use. 
+	 */
+	CellularHelperEnvironmentResponse(CellularHelperEnvironmentCellData *neighbors, size_t numNeighbors);
+
+	/**
+	 * @brief Constructor that takes an external array of CellularHelperPackedCellData 
+	 * 
+	 * @param packedNeighbors Pointer to array of CellularHelperPackedCellData. Can be NULL.
+	 * 
+	 * @param numNeighbors Number of items in packedNeighbors. Can be 0.
+	 * 
+	 * Each neighbor is stored in 16 bytes instead of 48. The neighbors member will be NULL; use 
+	 * getNeighbor() or packedNeighbors to access the neighbor cells. 
+	 * CellularHelperEnvironmentResponsePackedStatic<> uses this constructor.
+	 */
+	CellularHelperEnvironmentResponse(CellularHelperPackedCellData *packedNeighbors, size_t numNeighbors);
+
+	/**
+	 * @brief Information about the service cell (the one you're connected to)
+	 * 
+	 * Filled in in both ENVIRONMENT_SERVING_CELL and ENVIRONMENT_SERVING_CELL_AND_NEIGHBORS modes.
+	 */
+	CellularHelperEnvironmentCellData service;
 
 	/**
 	 * @brief Information about the neighboring cells
@@ -515,6 +1113,15 @@ public:
 	 */
 	size_t numNeighbors;
 
+	/**
+	 * @brief Information about the neighboring cells, in packed form
+	 * 
+	 * Only set if the packed constructor was used, in which case neighbors is NULL.
+	 * 
+	 * The value of this member is passed into the constructor.
+	 */
+	CellularHelperPackedCellData *packedNeighbors = NULL;
+
 	/**
 	 * @brief Current index we're writing to
 	 * 
@@ -557,12 +1164,23 @@ public:
 	 * - ... 
 	 */
 	size_t getNumNeighbors() const;
+
+	/**
+	 * @brief Gets a neighboring cell, whether stored in neighbors or packedNeighbors
+	 * 
+	 * @param index 0 = first neighbor. Must be less than numNeighbors.
+	 * 
+	 * @param data Filled in with the cell data.
+	 * 
+	 * @return true if index is in range and the neighbor is valid (ignoring the CI).
+	 */
+	bool getNeighbor(size_t index, CellularHelperEnvironmentCellData &data) const;
 };
 
 /**
  * @brief Response class for getting cell tower information with statically defined array of neighbor cells
  * 
- * @param MAX_NEIGHBOR_CELLS templated parameter for number of neighbors to allocate. Each one is 44 bytes. Can be 0.
+ * @param MAX_NEIGHBOR_CELLS templated parameter for number of neighbors to allocate. Each one is 48 bytes. Can be 0.
  * 
  * The maximum the modem supports is 30, however you can set it smaller. Beware of using values over 10 or so
  * when storing this object on the stack as you could get a stack overflow.
@@ -580,16 +1198,42 @@ protected:
 	CellularHelperEnvironmentCellData staticNeighbors[MAX_NEIGHBOR_CELLS];
 };
 
+/**
+ * @brief Response class for getting cell tower information with a statically defined array of packed neighbor cells
+ * 
+ * @param MAX_NEIGHBOR_CELLS templated parameter for number of neighbors to allocate. Each one is 16 bytes. Can be 0.
+ * 
+ * This is the same as CellularHelperEnvironmentResponseStatic<> except the neighbors are stored as 
+ * CellularHelperPackedCellData. Use getNeighbor() to get each neighbor as a CellularHelperEnvironmentCellData.
+ */
+template <size_t MAX_NEIGHBOR_CELLS>
+class CellularHelperEnvironmentResponsePackedStatic : public CellularHelperEnvironmentResponse {
+public:
+	explicit CellularHelperEnvironmentResponsePackedStatic() : CellularHelperEnvironmentResponse(staticNeighbors, MAX_NEIGHBOR_CELLS) {
+	}
+
+protected:
+	/**
+	 * @brief Array of packed neighbor cell data
+	 */
+	CellularHelperPackedCellData staticNeighbors[MAX_NEIGHBOR_CELLS];
+};
+
 /**
  * @brief Reponse class for the AT+ULOC command
  * 
  * This class is returned from CellularHelper.getLocation(). You normally won't instantiate one
  * of these directly.
+ * 
+ * The first +UULOC line is parsed in place as it's received, so string is not used.
  */
 class CellularHelperLocationResponse : public CellularHelperPlusStringResponse {
 public:
 	/**
 	 * @brief Set to true if the values have been set
+	 * 
+	 * With startLocation(), this is set from the system thread, so use isValid() to check it from
+	 * another thread.
 	 */
 	bool valid = false;
 
@@ -615,14 +1259,32 @@ public:
 
 	/**
 	 * @brief Returns true if a valid location was found
+	 * 
+	 * When this returns true, the other fields are set, even if they were set from another thread.
 	 */
-	bool isValid() const { return valid; };
+	bool isValid() const { return __atomic_load_n(&valid, __ATOMIC_ACQUIRE); };
 
 	/**
-	 * @brief Converts the data in string into the broken out fields like lat, lon, alt, uncertainty.
+	 * @brief Parses the first +UULOC line into lat, lon, alt, and uncertainty
+	 * 
+	 * This is called from responseCallback, which is the callback to Cellular.command, and from
+	 * the +UULOC URC handler.
+	 */
+	virtual int parse(int type, const char *buf, int len);
+
+	/**
+	 * @brief Converts the data in string into the broken out fields like lat, lon, alt, uncertainty,
+	 * if they have not already been set by parse().
 	 */
 	void postProcess();
 
+	/**
+	 * @brief Parses the value of a +UULOC response, such as `13/04/2020,15:03:33.000,42.3601700,-71.0589000,0,1472`
+	 * 
+	 * @return true if the values were set.
+	 */
+	bool parseLocation(const char *value, size_t valueLen);
+
 	/**
 	 * @brief Converts this object into a readable string
 	 * 
@@ -704,6 +1366,322 @@ public:
 	String toString() const;
 };
 
+/**
+ * @brief Index of operator names from the AT+COPN command, sorted by mcc and mnc
+ * 
+ * AT+COPN returns the name of every operator the modem knows about, thousands of lines, and takes
+ * about 2 minutes. This class parses each line as it arrives, without copying it, and stores the
+ * results in a fixed-size array of entries sorted by (mcc, mnc) and a fixed-size arena of names.
+ * Each distinct name is only stored once. Once built, getOperatorName() uses a binary search so 
+ * you can look up names without running AT+COPN again.
+ * 
+ * The full list is larger than the RAM available on some devices. Use addMCCFilter() to only
+ * store the operators in the countries you are interested in. Operators that do not fit are counted
+ * in getNumDropped().
+ * 
+ * You will normally use CellularHelperOperatorIndexStatic<> instead of separately allocating the
+ * arrays. Use CellularHelper.getOperatorIndex() to run the AT+COPN command.
+ */
+class CellularHelperOperatorIndex : public CellularHelperCommonResponse {
+public:
+	/**
+	 * @brief One operator (6 bytes)
+	 */
+	struct Entry {
+		uint16_t mcc;			//!< Mobile Country Code
+		uint16_t mnc;			//!< Mobile Network Code
+		uint16_t nameOffset;	//!< Offset of the name in the arena
+	};
+
+	/**
+	 * @brief Constructor that takes external arrays
+	 * 
+	 * @param entries Pointer to an array of Entry
+	 * 
+	 * @param maxEntries Number of items in entries
+	 * 
+	 * @param arena Buffer to hold the names. Each distinct name takes its length plus 2 bytes.
+	 * 
+	 * @param arenaSize Size of arena in bytes. Only the first 65535 bytes are used.
+	 */
+	CellularHelperOperatorIndex(Entry *entries, size_t maxEntries, char *arena, size_t arenaSize);
+
+	/**
+	 * @brief Removes all operators. Does not change the MCC filter.
+	 */
+	void clear();
+
+	/**
+	 * @brief Only store operators with this mobile country code
+	 * 
+	 * @param mcc The mobile country code, for example 310 for the United States
+	 * 
+	 * @return false if there are already MAX_MCC_FILTERS filters
+	 * 
+	 * If no filter is added, all operators are stored.
+	 */
+	bool addMCCFilter(int mcc);
+
+	/**
+	 * @brief Removes all MCC filters so all operators are stored
+	 */
+	void clearMCCFilter() { numMCCFilters = 0; };
+
+	/**
+	 * @brief Adds an operator (used internally, but you can also add your own)
+	 * 
+	 * @param mcc Mobile Country Code
+	 * 
+	 * @param mnc Mobile Network Code
+	 * 
+	 * @param name The operator name. Does not need to be null terminated.
+	 * 
+	 * @param nameLen The length of name. Names longer than 255 bytes are truncated.
+	 * 
+	 * @return true if added or already present, false if filtered out or there was no room.
+	 */
+	bool addOperator(int mcc, int mnc, const char *name, size_t nameLen);
+
+	/**
+	 * @brief Looks up the name of an operator
+	 * 
+	 * @param mcc Mobile Country Code
+	 * 
+	 * @param mnc Mobile Network Code
+	 * 
+	 * @return The name, or NULL if not found. The pointer is valid until clear() is called.
+	 */
+	const char *getOperatorName(int mcc, int mnc) const;
+
+	/**
+	 * @brief Gets the number of operators stored
+	 */
+	size_t getNumOperators() const { return numEntries; };
+
+	/**
+	 * @brief Gets the number of operators that were not stored because entries or arena was full
+	 */
+	size_t getNumDropped() const { return numDropped; };
+
+	/**
+	 * @brief Gets the number of bytes of arena used
+	 */
+	size_t getArenaUsed() const { return arenaUsed; };
+
+	/**
+	 * @brief Method to parse the output from the modem
+	 * 
+	 * @param type one of 13 different enumerated AT command response types.
+	 * 
+	 * @param buf a pointer to the character array containing the AT command response.
+	 * 
+	 * @param len length of the AT command response buf.
+	 * 
+	 * This is called from responseCallback, which is the callback to Cellular.command.
+	 */
+	virtual int parse(int type, const char *buf, int len);
+
+	/**
+	 * @brief Maximum number of MCC filters
+	 */
+	static const size_t MAX_MCC_FILTERS = 4;
+
+protected:
+	/**
+	 * @brief Parses one line of the form `"310410","AT&T"` (the part after +COPN: )
+	 */
+	void parseLine(const char *line, size_t lineLen);
+
+	/**
+	 * @brief Finds the index of the first entry not less than (mcc, mnc)
+	 */
+	size_t lowerBound(uint16_t mcc, uint16_t mnc) const;
+
+	/**
+	 * @brief Returns the offset of name in arena, adding it if it is not already there
+	 * 
+	 * @return true if found or added, false if the arena is full
+	 */
+	bool internName(const char *name, size_t nameLen, uint16_t &offset);
+
+	Entry *entries;				//!< Array of entries, sorted by mcc then mnc
+	size_t maxEntries;			//!< Number of items in entries
+	size_t numEntries = 0;		//!< Number of entries used
+	char *arena;				//!< Names, each stored as a length byte, the name, and a null terminator
+	size_t arenaSize;			//!< Size of arena in bytes
+	size_t arenaUsed = 0;		//!< Number of bytes of arena used
+	size_t numDropped = 0;		//!< Number of operators that did not fit
+	uint16_t mccFilters[MAX_MCC_FILTERS];	//!< MCC filters
+	size_t numMCCFilters = 0;	//!< Number of MCC filters
+};
+
+/**
+ * @brief Operator name index with statically allocated arrays
+ * 
+ * @param MAX_OPERATORS templated parameter for the number of operators. Each one is 6 bytes.
+ * 
+ * @param ARENA_SIZE templated parameter for the number of bytes for names. Names average around 12 bytes
+ * and many operators share a name.
+ * 
+ * The entire list is over 2000 operators, so you will probably want to add MCC filters.
+ */
+template <size_t MAX_OPERATORS, size_t ARENA_SIZE>
+class CellularHelperOperatorIndexStatic : public CellularHelperOperatorIndex {
+public:
+	explicit CellularHelperOperatorIndexStatic() : CellularHelperOperatorIndex(staticEntries, MAX_OPERATORS, staticArena, ARENA_SIZE) {
+	}
+
+protected:
+	/**
+	 * @brief Array of entries
+	 */
+	Entry staticEntries[MAX_OPERATORS];
+
+	/**
+	 * @brief Arena for names
+	 */
+	char staticArena[ARENA_SIZE];
+};
+
+/**
+ * @brief Results from CellularHelper.getDiagnostics()
+ * 
+ * Only the fields requested are filled in. Use isValid() to check whether each one was returned
+ * by the modem.
+ */
+class CellularHelperDiagnostics {
+public:
+	/**
+	 * @brief Field bits for the fields parameter to getDiagnostics() and isValid()
+	 */
+	enum {
+		FIELD_MANUFACTURER		= 0x0001,	//!< manufacturer (AT+CGMI)
+		FIELD_MODEL				= 0x0002,	//!< model (AT+CGMM)
+		FIELD_FIRMWARE_VERSION	= 0x0004,	//!< firmwareVersion (AT+CGMR)
+		FIELD_IMEI				= 0x0008,	//!< imei (AT+CGSN)
+		FIELD_ICCID				= 0x0010,	//!< iccid (AT+CCID)
+		FIELD_RSSI_QUAL			= 0x0020,	//!< rssiQual (AT+CSQ)
+		FIELD_EXTENDED_QUAL		= 0x0040,	//!< extendedQual (AT+CESQ)
+		FIELD_OPERATOR_NAME		= 0x0080,	//!< operatorName (AT+UDOPN=9)
+		FIELD_ORDERING_CODE		= 0x0100,	//!< orderingCode (ATI0)
+		FIELD_ENVIRONMENT		= 0x0200,	//!< environment, serving cell only (AT+CGED=5). 2G/3G only.
+		FIELD_IDENTITY			= 0x011f,	//!< All of the fields that don't change
+		FIELD_ALL				= 0x03ff	//!< All fields
+	};
+
+	String manufacturer;		//!< Manufacturer, for example "u-blox"
+	String model;				//!< Model, for example "SARA-R410M-02B"
+	String firmwareVersion;		//!< Modem firmware version
+	String imei;				//!< IMEI
+	String iccid;				//!< ICCID of the SIM card
+	String operatorName;		//!< Operator name, the same as getOperatorName()
+	String orderingCode;		//!< Ordering code, for example "SARA-R410M-02B"
+
+	/**
+	 * @brief Signal strength and quality
+	 */
+	CellularHelperRSSIQualResponse rssiQual;
+
+	/**
+	 * @brief Extended signal quality
+	 */
+	CellularHelperExtendedQualResponse extendedQual;
+
+	/**
+	 * @brief Serving cell information
+	 */
+	CellularHelperEnvironmentResponse environment;
+
+	/**
+	 * @brief The FIELD_ bits of the fields that were returned by the modem
+	 */
+	int validFields = 0;
+
+	/**
+	 * @brief Returns true if all of the fields in the field bit mask were returned by the modem
+	 */
+	bool isValid(int fields) const { return (validFields & fields) == fields; };
+
+	/**
+	 * @brief Logs the valid fields using Log.info
+	 */
+	void logDiagnostics() const;
+};
+
+/**
+ * @brief Response class for several concatenated commands (used internally)
+ * 
+ * CellularHelper.getDiagnostics() sends one command line like `AT+CGMI;+CGMM;+CSQ` instead of 
+ * a separate command for each field. This class sorts the responses into a CellularHelperDiagnostics 
+ * object. Responses with a + prefix are matched by command name; responses without one (like AT+CGMI) 
+ * are in the same order as the commands.
+ */
+class CellularHelperBatchResponse : public CellularHelperCommonResponse {
+public:
+	/**
+	 * @brief Constructor
+	 * 
+	 * @param result The object to store the responses in
+	 * 
+	 * @param fields The FIELD_ bits of the commands that were sent, from CellularHelperDiagnostics.
+	 */
+	CellularHelperBatchResponse(CellularHelperDiagnostics &result, int fields);
+
+	/**
+	 * @brief Builds the command line for the fields passed to the constructor
+	 * 
+	 * @param buf Buffer to write the command to, including the trailing \r\n
+	 * 
+	 * @param bufSize Size of buf in bytes
+	 * 
+	 * @return The number of commands in the command line
+	 */
+	size_t buildCommand(char *buf, size_t bufSize) const;
+
+	/**
+	 * @brief Method to parse the output from the modem
+	 * 
+	 * @param type one of 13 different enumerated AT command response types.
+	 * 
+	 * @param buf a pointer to the character array containing the AT command response.
+	 * 
+	 * @param len length of the AT command response buf.
+	 * 
+	 * This is called from responseCallback, which is the callback to Cellular.command.
+	 */
+	virtual int parse(int type, const char *buf, int len);
+
+	/**
+	 * @brief Fields that can be sent in a batch. ATI0 and AT+CGED are sent separately.
+	 */
+	static const int BATCH_FIELDS = 0x00ff;
+
+protected:
+	/**
+	 * @brief Stores a response in result
+	 */
+	void storeValue(int field, const char *value, size_t valueLen);
+
+	CellularHelperDiagnostics &result;	//!< Where the responses are stored
+	int fields;							//!< FIELD_ bits of the commands sent
+	int fieldsReceived = 0;				//!< FIELD_ bits of the responses received
+};
+
+/**
+ * @brief Cached values that don't change while the modem is powered on (used internally)
+ * 
+ * An empty string means the value has not been retrieved from the modem yet.
+ */
+class CellularHelperIdentityCache {
+public:
+	String manufacturer;		//!< AT+CGMI
+	String model;				//!< AT+CGMM
+	String orderingCode;		//!< ATI0
+	String firmwareVersion;		//!< AT+CGMR
+	String imei;				//!< AT+CGSN
+	String iccid;				//!< AT+CCID
+};
+
 /**
  * @brief Class for calling the u-blox SARA modem directly. 
  * 
@@ -718,21 +1696,31 @@ class CellularHelperClass {
 public:
 	/**
 	 * @brief Returns a string, typically "u-blox"
+	 * 
+	 * The manufacturer, model, ordering code, firmware version, IMEI, and ICCID are retrieved
+	 * from the modem the first time they are requested and cached after that. See 
+	 * clearIdentityCache().
 	 */
 	String getManufacturer() const;
 
 	/**
 	 * @brief Returns a string like "SARA-G350", "SARA-U260" or "SARA-U270"
+	 * 
+	 * This value is cached. See getManufacturer().
 	 */
 	String getModel() const;
 
 	/**
 	 * @brief Returns a string like "SARA-U260-00S-00".
+	 * 
+	 * This value is cached. See getManufacturer().
 	 */
 	String getOrderingCode() const;
 
 	/**
 	 * @brief Returns a string like "23.20"
+	 * 
+	 * This value is cached. See getManufacturer().
 	 */
 	String getFirmwareVersion() const;
 
@@ -744,11 +1732,15 @@ public:
 	 * 
 	 * For countries that require the cellular devices to be registered, the IMEI is typically
 	 * the number that is required.
+	 * 
+	 * This value is cached. See getManufacturer().
 	 */
 	String getIMEI() const;
 
 	/**
-	 * @brief Returns the IMSI for the modem
+	 * @brief Returns the IMSI of the SIM card (AT+CIMI)
+	 * 
+	 * This value is not cached.
 	 */
 	String getIMSI() const;
 
@@ -757,6 +1749,8 @@ public:
 	 * 
 	 * Both IMEI and ICCID are commonly used identifiers. The IMEI is assigned to the modem itself.
 	 * The ICCID is assigned to the SIM card.
+	 * 
+	 * This value is cached. See getManufacturer().
 	 */
 	String getICCID() const;
 
@@ -770,9 +1764,21 @@ public:
 
 	/**
 	 * @brief Returns true if the device is a u-blox SARA-R4 model (LTE-Cat M1)
+	 * 
+	 * This uses the cached model from getModel() so only the first call requires a command 
+	 * to the modem.
 	 */
 	bool isSARA_R4() const;
 
+	/**
+	 * @brief Clears the cached manufacturer, model, ordering code, firmware version, IMEI, and ICCID
+	 * 
+	 * Call this after powering the modem off and back on (Cellular.off() and Cellular.on()), since
+	 * the SIM card could have been changed. The values are retrieved from the modem again on the 
+	 * next request.
+	 */
+	void clearIdentityCache();
+
 	/**
 	 * @brief Returns the operator name string, something like "AT&T" or "T-Mobile" in the United States (2G/3G only)
 	 * 
@@ -947,6 +1953,65 @@ public:
 	 */
 	CellularHelperLocationResponse getLocation(unsigned long timeoutMs = DEFAULT_TIMEOUT) const;
 
+	/**
+	 * @brief Gets the names of all operators known to the modem (AT+COPN) and stores them in index
+	 * 
+	 * @param index The index to add the operators to. It is not cleared first.
+	 * 
+	 * @param timeoutMs The timeout in milliseconds. The command takes about 2 minutes.
+	 * 
+	 * This blocks until the command completes. You can then look up names with 
+	 * index.getOperatorName() without running the command again.
+	 */
+	void getOperatorIndex(CellularHelperOperatorIndex &index, unsigned long timeoutMs = 180000) const;
+
+	/**
+	 * @brief Gets several values from the modem at once
+	 * 
+	 * @param fields The values to get, a bit mask of CellularHelperDiagnostics::FIELD_ constants,
+	 * for example `CellularHelperDiagnostics::FIELD_ALL`.
+	 * 
+	 * @param result Filled in with the values. Use result.isValid() to check which ones were returned.
+	 * 
+	 * Instead of one command per value, this sends the commands in one command line, like
+	 * `AT+CGMI;+CGMM;+CGMR;+CGSN;+CCID;+CSQ;+CESQ;+UDOPN=9`, which takes less time. If the modem 
+	 * returns an error, for example because AT+CESQ is not supported, each of the missing values is 
+	 * requested separately. ATI0 and AT+CGED are always sent separately. Values that are cached
+	 * (see clearIdentityCache()) are not requested again, and values that are retrieved are cached.
+	 */
+	void getDiagnostics(int fields, CellularHelperDiagnostics &result) const;
+
+#if CELLULARHELPER_ENABLE_URC
+	/**
+	 * @brief Starts a CellLocate request that completes when the +UULOC URC arrives (AT+ULOC)
+	 * 
+	 * @param resp The response object to fill in. It must remain valid until you call stopLocation(),
+	 * so it's typically a global variable or class member.
+	 * 
+	 * @param timeoutMs timeout in milliseconds. Should be at least 10 seconds.
+	 * 
+	 * @return true if the request was started or false on error, including when a request is
+	 * already started.
+	 * 
+	 * Unlike getLocation(), this returns as soon as the request is sent. A handler is registered 
+	 * for the +UULOC unsolicited result code, and resp is filled in once when it arrives, without 
+	 * sending empty commands to the modem to poll for it. Check resp.isValid() from loop(), and 
+	 * call stopLocation() when done or if timeoutMs has elapsed without a result.
+	 * 
+	 * Only one location request can be outstanding at a time, because there is one +UULOC handler. 
+	 * Calling this again before stopLocation() returns false, even if the first request has a result.
+	 * Has the same compatibility as getLocation() and requires Device OS 1.0.0 or later.
+	 */
+	bool startLocation(CellularHelperLocationResponse &resp, unsigned long timeoutMs = DEFAULT_TIMEOUT) const;
+
+	/**
+	 * @brief Stops handling +UULOC URCs for a request started with startLocation()
+	 *
+	 * After this returns, resp is no longer used and another request can be started.
+	 */
+	void stopLocation() const;
+#endif /* CELLULARHELPER_ENABLE_URC */
+
 	/**
 	 * @brief Gets the AT+CREG (registration info including CI and LAC) as an alternative to AT+CGED 
 	 * 
@@ -965,9 +2030,86 @@ public:
 	 * | Any            | Gen 3  | Any       | No    |
 	 * | Any            | Any    | >= 1.2.1  | No    |
 	 * 
+	 * This turns on +CREG reporting to get the LAC and CI, and turns it off again. While the 
+	 * CellularHelperRegistrationMonitor is running, the reporting mode is left alone, as the monitor
+	 * needs it, and the monitor's current values are returned instead without sending a command.
 	 */
 	void getCREG(CellularHelperCREGResponse &resp) const;
 
+#if CELLULARHELPER_ENABLE_URC
+	/**
+	 * @brief Sets the running registration monitor, or NULL. Used internally by CellularHelperRegistrationMonitorClass.
+	 */
+	void setRegistrationMonitor(CellularHelperRegistrationMonitorClass *monitor) { registrationMonitor = monitor; };
+#endif /* CELLULARHELPER_ENABLE_URC */
+
+	/**
+	 * @brief Enables collecting latency and result statistics for each command
+	 * 
+	 * @param stats The object to store the statistics in, or NULL (the default) to stop collecting
+	 * them. It must remain valid while set.
+	 */
+	void setCommandStats(CellularHelperCommandStats *stats) { commandStats = stats; };
+
+	/**
+	 * @brief Gets the object set with setCommandStats(), or NULL if not set
+	 */
+	CellularHelperCommandStats *getCommandStats() const { return commandStats; };
+
+	/**
+	 * @brief Adds the results of getRSSIQual(), getExtendedQual(), getEnvironment(), and getCREG() to a queue
+	 * 
+	 * This lets a thread that calls these methods (such as the CellularHelperAsync worker thread) pass 
+	 * the results to the application thread without locking. Each result is pushed by the calling 
+	 * thread after Cellular.command() returns and the response has been post-processed, not from 
+	 * the parse callbacks. The queue only supports one producer thread, so only call these methods 
+	 * from one thread while it's set.
+	 * 
+	 * @param queue The queue, or NULL (the default) to stop adding results.
+	 */
+	void setResultQueue(CellularHelperResultQueue *queue) { resultQueue = queue; };
+
+	/**
+	 * @brief Gets the queue set with setResultQueue(), or NULL if not set
+	 */
+	CellularHelperResultQueue *getResultQueue() const { return resultQueue; };
+
+	/**
+	 * @brief Sends a command to the modem. Used internally instead of Cellular.command().
+	 * 
+	 * This is the same as Cellular.command() except that if setCommandStats() was used, the
+	 * latency, result, and number of response bytes are recorded under name.
+	 * 
+	 * @param name The command name used for statistics, such as "CSQ". Must be a string constant.
+	 * 
+	 * @param cb The Cellular.command callback.
+	 * 
+	 * @param param The parameter passed to cb.
+	 * 
+	 * @param timeout Timeout in milliseconds.
+	 * 
+	 * @param format The command, a printf-style format string. The formatted command must fit in
+	 * COMMAND_BUF_SIZE bytes, including the null terminator.
+	 * 
+	 * @return The result code from Cellular.command(), such as RESP_OK. If the formatted command does
+	 * not fit, it is not sent and RESP_ERROR is returned.
+	 */
+	int command(const char *name, int (*cb)(int type, const char* buf, int len, void *param), void *param, system_tick_t timeout, const char *format, ...) const
+		__attribute__((format(printf, 6, 7)));
+
+	/**
+	 * @brief Sends a command to the modem without a callback. Used internally instead of Cellular.command().
+	 * 
+	 * See the other overload for details.
+	 */
+	int command(const char *name, system_tick_t timeout, const char *format, ...) const
+		__attribute__((format(printf, 4, 5)));
+
+	/**
+	 * @brief Size of the buffer for a formatted command in command()
+	 */
+	static const size_t COMMAND_BUF_SIZE = 128;
+
 	/**
 	 * @brief Append a buffer (pointer and length) to a String object
 	 * 
@@ -985,6 +2127,68 @@ public:
 	 */
 	static void appendBufferToString(String &str, const char *buf, int len, bool noEOL = true);
 
+	/**
+	 * @brief Append a buffer (pointer and length) to a caller-supplied buffer
+	 *
+	 * This is the same as appendBufferToString() but does not allocate memory.
+	 *
+	 * @param dst The buffer to append to. It is always null terminated if dstSize is not 0.
+	 *
+	 * @param dstSize The size of dst in bytes, including the null terminator. Data that does not
+	 * fit is discarded.
+	 *
+	 * @param dstLen The number of characters already in dst.
+	 *
+	 * @param buf The buffer to copy from. Does not need to be null terminated.
+	 *
+	 * @param len The number of bytes to copy.
+	 *
+	 * @param noEOL (default: true) If true, don't copy CR and LF characters to the output.
+	 *
+	 * @return The new number of characters in dst, not including the null terminator.
+	 */
+	static size_t appendBufferToBuffer(char *dst, size_t dstSize, size_t dstLen, const char *buf, int len, bool noEOL = true);
+
+	/**
+	 * @brief Gets the number of bytes at the start of buf that appendBufferToString() copies as one run
+	 *
+	 * @param buf The buffer to scan.
+	 *
+	 * @param len The number of bytes in buf.
+	 *
+	 * @param noEOL If true, the run ends at CR, LF, or null. If false, it only ends at null.
+	 *
+	 * @return The length of the run, which is len if there is no byte that ends it.
+	 */
+	static size_t findRunLength(const char *buf, size_t len, bool noEOL);
+
+	/**
+	 * @brief Size of the stack buffer appendBufferToString() uses to copy runs to the String
+	 */
+	static const size_t APPEND_CHUNK_SIZE = 64;
+
+	/**
+	 * @brief Finds the value part of a + response in a buffer from a Cellular.command callback
+	 * 
+	 * Used internally to find the `+CMD: ` part of a response in place, without copying the
+	 * buffer. It must be at the start of buf or follow a LF.
+	 * 
+	 * @param buf The buffer to search. Does not need to be null terminated.
+	 * 
+	 * @param len The number of bytes in buf.
+	 * 
+	 * @param command The command to look for, not including the AT+ part, for example "CSQ".
+	 * Does not need to be null terminated.
+	 * 
+	 * @param commandLen The length of command.
+	 * 
+	 * @param valueLen Filled in with the length of the value, up to but not including the
+	 * next CR, LF, or the end of the buffer.
+	 * 
+	 * @return A pointer into buf at the start of the value, or NULL if not found.
+	 */
+	static const char *findPlusResponse(const char *buf, int len, const char *command, size_t commandLen, size_t &valueLen);
+
 	/**
 	 * @brief Default timeout in milliseconds. Passed to Cellular.command().
 	 * 
@@ -1057,7 +2261,90 @@ public:
 	 */
 	static int rssiToBars(int rssi);
 
+protected:
+#if CELLULARHELPER_ENABLE_URC
+	/**
+	 * @brief URC handler for +UULOC, param is the CellularHelperLocationResponse
+	 */
+	static int locationUrcCallback(int type, const char* buf, int len, void *param);
+#endif
+
+	/**
+	 * @brief Returns the cached value, or sends cmd to the modem and caches the result
+	 * 
+	 * @param cache The cached value from identityCache
+	 * 
+	 * @param name The command name for statistics, such as "CGMI"
+	 * 
+	 * @param cmd The full AT command to send, including the CRLF
+	 */
+	String getIdentityString(String &cache, const char *name, const char *cmd) const;
 
+	/**
+	 * @brief Sends the commands for fields in one command line and stores the results (used by getDiagnostics)
+	 * 
+	 * @param fields CellularHelperDiagnostics::FIELD_ bits, only those in CellularHelperBatchResponse::BATCH_FIELDS
+	 * 
+	 * @param result The results are stored here
+	 * 
+	 * @return The result code from Cellular.command, such as RESP_OK.
+	 */
+	int sendBatch(int fields, CellularHelperDiagnostics &result) const;
+
+	/**
+	 * @brief Sends a formatted command, recording statistics if enabled (used by command())
+	 */
+	int sendCommand(const char *name, int (*cb)(int type, const char* buf, int len, void *param), void *param, system_tick_t timeout, const char *cmd) const;
+
+	/**
+	 * @brief The param for commandCallback, which wraps the callback passed to command()
+	 */
+	struct CommandContext {
+		int (*cb)(int type, const char* buf, int len, void *param);	//!< Callback passed to command(), may be NULL
+		void *param;		//!< param passed to command()
+		size_t bytes;		//!< Number of response bytes
+	};
+
+	/**
+	 * @brief Cellular.command callback that counts the response bytes, then calls the original callback
+	 */
+	static int commandCallback(int type, const char* buf, int len, void *param);
+
+	/**
+	 * @brief Statistics object from setCommandStats(), or NULL
+	 */
+	CellularHelperCommandStats *commandStats = NULL;
+
+	/**
+	 * @brief Queue from setResultQueue(), or NULL
+	 */
+	CellularHelperResultQueue *resultQueue = NULL;
+
+#if CELLULARHELPER_ENABLE_URC
+	/**
+	 * @brief The registration monitor while it's running, or NULL
+	 */
+	CellularHelperRegistrationMonitorClass *registrationMonitor = NULL;
+
+	/**
+	 * @brief true from startLocation() until stopLocation(), while the +UULOC handler is registered
+	 */
+	mutable std::atomic<bool> locationStarted{false};
+#endif /* CELLULARHELPER_ENABLE_URC */
+
+	/**
+	 * @brief Cached values, filled in on first use
+	 * 
+	 * This is mutable because caching does not change the observable state of the object,
+	 * and the query methods are const.
+	 */
+	mutable CellularHelperIdentityCache identityCache;
+
+	/**
+	 * @brief Guards identityCache, which can be filled in from more than one thread (for example,
+	 * the CellularHelperAsync thread and the application thread)
+	 */
+	mutable RecursiveMutex identityLock;
 };
 
 extern CellularHelperClass CellularHelper;
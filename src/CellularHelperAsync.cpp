@@ -0,0 +1,233 @@
+#include "Particle.h"
+
+#include "CellularHelperAsync.h"
+
+#if Wiring_Cellular
+
+CellularHelperAsyncClass CellularHelperAsync;
+
+CellularHelperAsyncRequest::CellularHelperAsyncRequest() : state(STATE_IDLE), callback(NULL), callbackContext(NULL) {
+}
+
+CellularHelperAsyncRequest::~CellularHelperAsyncRequest() {
+}
+
+void CellularHelperAsyncRequest::setCallback(CompletionCallback callback, void *context) {
+	this->callback = callback;
+	this->callbackContext = context;
+}
+
+void CellularHelperAsyncStringRequest::run() {
+	if (method) {
+		result = (CellularHelper.*method)();
+	}
+}
+
+void CellularHelperAsyncOperatorNameRequest::run() {
+	result = CellularHelper.getOperatorName(operatorNameType);
+}
+
+void CellularHelperAsyncRSSIQualRequest::run() {
+	result = CellularHelper.getRSSIQual();
+}
+
+void CellularHelperAsyncExtendedQualRequest::run() {
+	result = CellularHelper.getExtendedQual();
+}
+
+void CellularHelperAsyncSelectOperatorRequest::run() {
+	result = CellularHelper.selectOperator(mccMnc);
+}
+
+void CellularHelperAsyncEnvironmentRequest::run() {
+	if (resp) {
+		resp->clear();
+		CellularHelper.getEnvironment(mode, *resp);
+	}
+}
+
+void CellularHelperAsyncLocationRequest::run() {
+	result = CellularHelper.getLocation(timeoutMs);
+}
+
+void CellularHelperAsyncCREGRequest::run() {
+	result = CellularHelperCREGResponse();
+	CellularHelper.getCREG(result);
+}
+
+
+CellularHelperAsyncClass::CellularHelperAsyncClass() {
+}
+
+CellularHelperAsyncClass::~CellularHelperAsyncClass() {
+}
+
+bool CellularHelperAsyncClass::setup(size_t queueSize, size_t stackSize) {
+	if (thread) {
+		// Already set up
+		return true;
+	}
+
+	// On failure, the queues are destroyed so enqueue() fails instead of queueing requests
+	// that nothing will run
+	if (os_queue_create(&requestQueue, sizeof(CellularHelperAsyncRequest *), queueSize, 0) != 0) {
+		Log.info("could not create request queue");
+		requestQueue = NULL;
+		return false;
+	}
+	if (os_queue_create(&completionQueue, sizeof(CellularHelperAsyncRequest *), queueSize, 0) != 0) {
+		Log.info("could not create completion queue");
+		completionQueue = NULL;
+		destroyQueues();
+		return false;
+	}
+
+	// The Thread object can be allocated even when the OS thread could not be created (for example,
+	// not enough memory for the stack), so check that too
+	thread = new Thread("cellhelper", threadFunctionStatic, (void *)this, OS_THREAD_PRIORITY_DEFAULT, stackSize);
+	if (!thread || !thread->is_valid()) {
+		Log.info("could not create thread");
+		delete thread;
+		thread = NULL;
+		destroyQueues();
+		return false;
+	}
+	return true;
+}
+
+void CellularHelperAsyncClass::destroyQueues() {
+	if (requestQueue) {
+		os_queue_destroy(requestQueue, 0);
+		requestQueue = NULL;
+	}
+	if (completionQueue) {
+		os_queue_destroy(completionQueue, 0);
+		completionQueue = NULL;
+	}
+}
+
+void CellularHelperAsyncClass::loop() {
+	CellularHelperAsyncRequest *request;
+
+	if (!completionQueue) {
+		return;
+	}
+
+	while(os_queue_take(completionQueue, &request, 0, 0) == 0) {
+		// Done before the callback, so the callback can queue the request again
+		request->state.store(CellularHelperAsyncRequest::STATE_DONE, std::memory_order_release);
+		if (request->callback) {
+			request->callback(*request, request->callbackContext);
+		}
+	}
+}
+
+bool CellularHelperAsyncClass::enqueue(CellularHelperAsyncRequest &request) {
+	if (!requestQueue || request.isPending()) {
+		return false;
+	}
+
+	CellularHelperAsyncRequest *pRequest = &request;
+
+	request.state = CellularHelperAsyncRequest::STATE_QUEUED;
+	if (os_queue_put(requestQueue, &pRequest, 0, 0) != 0) {
+		// Queue full
+		request.state = CellularHelperAsyncRequest::STATE_IDLE;
+		return false;
+	}
+	return true;
+}
+
+bool CellularHelperAsyncClass::getManufacturer(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getManufacturer);
+}
+
+bool CellularHelperAsyncClass::getModel(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getModel);
+}
+
+bool CellularHelperAsyncClass::getOrderingCode(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getOrderingCode);
+}
+
+bool CellularHelperAsyncClass::getFirmwareVersion(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getFirmwareVersion);
+}
+
+bool CellularHelperAsyncClass::getIMEI(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getIMEI);
+}
+
+bool CellularHelperAsyncClass::getIMSI(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getIMSI);
+}
+
+bool CellularHelperAsyncClass::getICCID(CellularHelperAsyncStringRequest &request) {
+	return enqueueString(request, &CellularHelperClass::getICCID);
+}
+
+bool CellularHelperAsyncClass::getOperatorName(CellularHelperAsyncOperatorNameRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::getRSSIQual(CellularHelperAsyncRSSIQualRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::getExtendedQual(CellularHelperAsyncExtendedQualRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::selectOperator(CellularHelperAsyncSelectOperatorRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::getEnvironment(CellularHelperAsyncEnvironmentRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::getLocation(CellularHelperAsyncLocationRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::getCREG(CellularHelperAsyncCREGRequest &request) {
+	return enqueue(request);
+}
+
+bool CellularHelperAsyncClass::enqueueString(CellularHelperAsyncStringRequest &request, String (CellularHelperClass::*method)() const) {
+	if (request.isPending()) {
+		return false;
+	}
+	request.method = method;
+	return enqueue(request);
+}
+
+void CellularHelperAsyncClass::threadFunction() {
+	while(true) {
+		CellularHelperAsyncRequest *request;
+
+		if (os_queue_take(requestQueue, &request, CONCURRENT_WAIT_FOREVER, 0) == 0) {
+			request->state = CellularHelperAsyncRequest::STATE_RUNNING;
+			request->run();
+
+			if (request->callback) {
+				// The request stays pending until loop() takes it from the completion queue and
+				// sets it to done, so it can't be queued again before its callback is called. If
+				// the completion queue is full, this waits for loop() to make room. If it fails,
+				// the request is still marked done so isDone() works, but there is no callback.
+				if (os_queue_put(completionQueue, &request, CONCURRENT_WAIT_FOREVER, 0) == 0) {
+					continue;
+				}
+				Log.info("could not queue completion");
+			}
+			request->state.store(CellularHelperAsyncRequest::STATE_DONE, std::memory_order_release);
+		}
+	}
+}
+
+// [static]
+void CellularHelperAsyncClass::threadFunctionStatic(void *param) {
+	((CellularHelperAsyncClass *)param)->threadFunction();
+}
+
+#endif /* Wiring_Cellular */
@@ -0,0 +1,481 @@
+#ifndef __CELLULARHELPERASYNC_H
+#define __CELLULARHELPERASYNC_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#include <atomic>
+
+#if Wiring_Cellular
+
+/**
+ * @brief Base class for asynchronous requests
+ *
+ * Each of the CellularHelperClass query methods has an asynchronous request class that
+ * derives from this. You allocate the request object (typically as a global or class member,
+ * since it must remain valid until the request completes), pass it to one of the
+ * CellularHelperAsync methods, and then either poll isDone() or get a completion callback.
+ *
+ * The request is executed on a worker thread, so your application thread does not block while
+ * the modem is busy. The request object is not copied, and no memory is allocated to queue it.
+ */
+class CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief State of the request
+	 */
+	enum State {
+		STATE_IDLE,			//!< Not queued yet
+		STATE_QUEUED,		//!< Waiting for the worker thread
+		STATE_RUNNING,		//!< The worker thread is executing the command
+		STATE_DONE			//!< Completed, results are available
+	};
+
+	/**
+	 * @brief Completion callback function
+	 *
+	 * @param request The request that completed. You can static_cast this to the type of request you queued.
+	 *
+	 * @param context The context pointer passed to setCallback().
+	 */
+	typedef void (*CompletionCallback)(CellularHelperAsyncRequest &request, void *context);
+
+	/**
+	 * @brief Constructor
+	 */
+	CellularHelperAsyncRequest();
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~CellularHelperAsyncRequest();
+
+	/**
+	 * @brief Sets a function to call when the request completes
+	 *
+	 * @param callback The function to call, or NULL to only use isDone().
+	 *
+	 * @param context Passed to the callback.
+	 *
+	 * The callback is called from CellularHelperAsync.loop(), so it runs on the same thread as
+	 * your loop() and can safely access your application data. When a callback is set, the
+	 * request stays pending until loop() calls it, and isDone() is already true in the callback,
+	 * so the callback can queue the request again.
+	 */
+	void setCallback(CompletionCallback callback, void *context = NULL);
+
+	/**
+	 * @brief Returns true if the request has completed and the results are available
+	 */
+	bool isDone() const { return state.load(std::memory_order_acquire) == STATE_DONE; };
+
+	/**
+	 * @brief Returns true if the request is queued or running
+	 *
+	 * A request object must not be reused while it is pending.
+	 */
+	bool isPending() const {
+		State current = state.load(std::memory_order_acquire);
+		return current == STATE_QUEUED || current == STATE_RUNNING;
+	};
+
+	/**
+	 * @brief Gets the current state
+	 */
+	State getState() const { return state.load(std::memory_order_acquire); };
+
+	/**
+	 * @brief Executes the request (used internally)
+	 *
+	 * This is called on the worker thread and calls the blocking CellularHelper method.
+	 */
+	virtual void run() = 0;
+
+	/**
+	 * @brief Current state
+	 *
+	 * Set by the worker thread, or by loop() when there is a callback. STATE_DONE is stored with
+	 * release ordering after the results, so the results are complete when isDone() is true.
+	 */
+	std::atomic<State> state;
+
+	/**
+	 * @brief Completion callback function, or NULL
+	 */
+	CompletionCallback callback;
+
+	/**
+	 * @brief Context passed to the completion callback
+	 */
+	void *callbackContext;
+};
+
+/**
+ * @brief Asynchronous request for queries that return a String
+ *
+ * Used for getManufacturer(), getModel(), getOrderingCode(), getFirmwareVersion(), getIMEI(),
+ * getIMSI(), and getICCID().
+ */
+class CellularHelperAsyncStringRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief The result is stored here
+	 */
+	String result;
+
+	/**
+	 * @brief The CellularHelperClass method to call (used internally)
+	 */
+	String (CellularHelperClass::*method)() const = NULL;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for getOperatorName()
+ */
+class CellularHelperAsyncOperatorNameRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief The operator name type, one of the CellularHelperClass::OPERATOR_NAME_ constants
+	 */
+	int operatorNameType = CellularHelperClass::OPERATOR_NAME_LONG_EONS;
+
+	/**
+	 * @brief The result is stored here
+	 */
+	String result;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for getRSSIQual()
+ */
+class CellularHelperAsyncRSSIQualRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief The result is stored here
+	 */
+	CellularHelperRSSIQualResponse result;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for getExtendedQual()
+ */
+class CellularHelperAsyncExtendedQualRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief The result is stored here
+	 */
+	CellularHelperExtendedQualResponse result;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for selectOperator()
+ */
+class CellularHelperAsyncSelectOperatorRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief The MCC/MNC numeric string, or NULL for automatic mode. This pointer is stored,
+	 * not copied, so it must remain valid until the request completes.
+	 */
+	const char *mccMnc = NULL;
+
+	/**
+	 * @brief The result is stored here: true on success or false on error
+	 */
+	bool result = false;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for getEnvironment()
+ */
+class CellularHelperAsyncEnvironmentRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief ENVIRONMENT_SERVING_CELL or ENVIRONMENT_SERVING_CELL_AND_NEIGHBORS
+	 */
+	int mode = CellularHelperClass::ENVIRONMENT_SERVING_CELL;
+
+	/**
+	 * @brief The response object to fill in, typically a CellularHelperEnvironmentResponseStatic<>.
+	 * It must remain valid until the request completes.
+	 */
+	CellularHelperEnvironmentResponse *resp = NULL;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for getLocation()
+ */
+class CellularHelperAsyncLocationRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief Timeout in milliseconds
+	 */
+	unsigned long timeoutMs = CellularHelperClass::DEFAULT_TIMEOUT;
+
+	/**
+	 * @brief The result is stored here
+	 */
+	CellularHelperLocationResponse result;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Asynchronous request for getCREG()
+ */
+class CellularHelperAsyncCREGRequest : public CellularHelperAsyncRequest {
+public:
+	/**
+	 * @brief The result is stored here
+	 */
+	CellularHelperCREGResponse result;
+
+	/**
+	 * @brief Executes the request (used internally)
+	 */
+	virtual void run();
+};
+
+/**
+ * @brief Runs CellularHelper queries on a worker thread so they don't block the application
+ *
+ * Normally you use the global `CellularHelperAsync` object. Call setup() from setup() and
+ * loop() from loop(). For example:
+ *
+ * ```
+ * CellularHelperAsyncRSSIQualRequest rssiReq;
+ *
+ * void rssiCallback(CellularHelperAsyncRequest &request, void *context) {
+ *     Log.info("rssi=%d", rssiReq.result.rssi);
+ * }
+ *
+ * void setup() {
+ *     CellularHelperAsync.setup();
+ *     rssiReq.setCallback(rssiCallback);
+ * }
+ *
+ * void loop() {
+ *     CellularHelperAsync.loop();
+ *
+ *     if (!rssiReq.isPending() && millis() - lastCheck >= 10000) {
+ *         lastCheck = millis();
+ *         CellularHelperAsync.getRSSIQual(rssiReq);
+ *     }
+ * }
+ * ```
+ *
+ * Requests are executed one at a time, in the order they were queued. The worker thread calls the
+ * same CellularHelper methods, and it's safe to call the blocking methods from other threads at the
+ * same time: Cellular.command() serializes access to the modem, and the identity cache used by
+ * getManufacturer(), getModel(), getICCID(), etc. is guarded by a lock, so an identity command is
+ * only sent once and the cache is never read while another thread is filling it in or clearing it.
+ * The exception is a queue set with CellularHelper.setResultQueue(), which only supports one
+ * producer thread; while it's set, only make the requests that push results from one thread.
+ */
+class CellularHelperAsyncClass {
+public:
+	/**
+	 * @brief Constructor
+	 */
+	CellularHelperAsyncClass();
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~CellularHelperAsyncClass();
+
+	/**
+	 * @brief Creates the worker thread and queues. Call from setup().
+	 *
+	 * @param queueSize Maximum number of requests that can be pending at once.
+	 *
+	 * @param stackSize Stack size for the worker thread in bytes.
+	 *
+	 * @return true on success or false if the thread or queues could not be created.
+	 */
+	bool setup(size_t queueSize = DEFAULT_QUEUE_SIZE, size_t stackSize = DEFAULT_STACK_SIZE);
+
+	/**
+	 * @brief Calls completion callbacks for requests that have completed. Call from loop().
+	 *
+	 * This is only necessary if you use completion callbacks. If you only poll isDone(),
+	 * you don't need to call this.
+	 */
+	void loop();
+
+	/**
+	 * @brief Queues a request to run on the worker thread
+	 *
+	 * @param request The request to queue. It must remain valid until it completes.
+	 *
+	 * @return true if queued or false if setup() was not called, the request is already pending,
+	 * or the queue is full.
+	 *
+	 * The methods like getRSSIQual() call this. You'd only call it directly for a custom subclass of
+	 * CellularHelperAsyncRequest.
+	 */
+	bool enqueue(CellularHelperAsyncRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getManufacturer()
+	 */
+	bool getManufacturer(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getModel()
+	 */
+	bool getModel(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getOrderingCode()
+	 */
+	bool getOrderingCode(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getFirmwareVersion()
+	 */
+	bool getFirmwareVersion(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getIMEI()
+	 */
+	bool getIMEI(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getIMSI()
+	 */
+	bool getIMSI(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getICCID()
+	 */
+	bool getICCID(CellularHelperAsyncStringRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getOperatorName()
+	 *
+	 * Set request.operatorNameType before calling if you don't want the default.
+	 */
+	bool getOperatorName(CellularHelperAsyncOperatorNameRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getRSSIQual()
+	 */
+	bool getRSSIQual(CellularHelperAsyncRSSIQualRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getExtendedQual()
+	 */
+	bool getExtendedQual(CellularHelperAsyncExtendedQualRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.selectOperator()
+	 *
+	 * Set request.mccMnc before calling. This may take 60 seconds or more to complete.
+	 */
+	bool selectOperator(CellularHelperAsyncSelectOperatorRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getEnvironment()
+	 *
+	 * Set request.mode and request.resp before calling.
+	 */
+	bool getEnvironment(CellularHelperAsyncEnvironmentRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getLocation()
+	 *
+	 * Set request.timeoutMs before calling if you don't want the default.
+	 */
+	bool getLocation(CellularHelperAsyncLocationRequest &request);
+
+	/**
+	 * @brief Asynchronous version of CellularHelper.getCREG()
+	 */
+	bool getCREG(CellularHelperAsyncCREGRequest &request);
+
+	/**
+	 * @brief Default maximum number of pending requests
+	 */
+	static const size_t DEFAULT_QUEUE_SIZE = 8;
+
+	/**
+	 * @brief Default worker thread stack size in bytes
+	 */
+	static const size_t DEFAULT_STACK_SIZE = 3072;
+
+protected:
+	/**
+	 * @brief Queues a string request for one of the identity methods
+	 */
+	bool enqueueString(CellularHelperAsyncStringRequest &request, String (CellularHelperClass::*method)() const);
+
+	/**
+	 * @brief Destroys the queues, if they were created, and sets them to NULL
+	 */
+	void destroyQueues();
+
+	/**
+	 * @brief Worker thread function
+	 */
+	void threadFunction();
+
+	/**
+	 * @brief Static worker thread function, param is this object
+	 */
+	static void threadFunctionStatic(void *param);
+
+	/**
+	 * @brief Worker thread
+	 */
+	Thread *thread = NULL;
+
+	/**
+	 * @brief Queue of CellularHelperAsyncRequest pointers waiting to run
+	 */
+	os_queue_t requestQueue = NULL;
+
+	/**
+	 * @brief Queue of CellularHelperAsyncRequest pointers that have completed, for loop()
+	 */
+	os_queue_t completionQueue = NULL;
+};
+
+extern CellularHelperAsyncClass CellularHelperAsync;
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERASYNC_H */
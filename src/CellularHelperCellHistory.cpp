@@ -0,0 +1,276 @@
+#include "Particle.h"
+
+#include "CellularHelperCellHistory.h"
+
+#if Wiring_Cellular
+
+String CellularHelperCellHistoryEntry::toString() const {
+	return String::format("mcc=%d mnc=%d lac=%x ci=%x seen=%u first=%lu last=%lu level=%d/%.1f/%d",
+		cell.getMCC(), cell.getMNC(), cell.getLAC(), cell.getCI(), (unsigned int)seenCount,
+		(unsigned long)firstSeenMs, (unsigned long)lastSeenMs,
+		levelCount ? levelMin : 0, getMeanLevel(), levelCount ? levelMax : 0);
+}
+
+CellularHelperCellHistory::CellularHelperCellHistory(CellularHelperCellHistoryEntry *entries, size_t maxEntries, uint16_t *index, size_t indexSize) :
+	entries(entries), maxEntries(maxEntries), index(index), indexSize(indexSize) {
+
+	// Use the largest power of 2 that fits, and always leave at least one empty slot so probing stops
+	while(this->indexSize & (this->indexSize - 1)) {
+		this->indexSize &= this->indexSize - 1;
+	}
+	if (this->indexSize > (size_t)NONE + 1) {
+		this->indexSize = (size_t)NONE + 1;
+	}
+	if (this->maxEntries >= this->indexSize) {
+		this->maxEntries = (this->indexSize > 0) ? this->indexSize - 1 : 0;
+	}
+
+	clear();
+}
+
+bool CellularHelperCellHistory::add(const CellularHelperEnvironmentCellData &data, unsigned long timeMs) {
+	if (!data.isValid()) {
+		return false;
+	}
+	return add(CellularHelperPackedCellData(data), timeMs);
+}
+
+bool CellularHelperCellHistory::add(const CellularHelperPackedCellData &cell, unsigned long timeMs) {
+	if (!cell.isValid() || maxEntries == 0) {
+		return false;
+	}
+
+	int mcc = cell.getMCC();
+	int mnc = cell.getMNC();
+	int lac = cell.getLAC();
+	int ci = cell.getCI();
+	uint16_t hash = getHash(mcc, mnc, lac, ci);
+
+	size_t slot = findSlot(hash, mcc, mnc, lac, ci);
+	uint16_t entryIndex = index[slot];
+
+	if (entryIndex != NONE) {
+		unlink(entryIndex);
+	}
+	else {
+		if (numEntries < maxEntries) {
+			entryIndex = (uint16_t) numEntries++;
+		}
+		else {
+			// Replace the least recently seen cell. Removing it from the index can move other
+			// slots back, so the slot for the new key has to be found again.
+			entryIndex = lruTail;
+			unlink(entryIndex);
+			removeFromIndex(entryIndex);
+			numEvicted++;
+
+			slot = findSlot(hash, mcc, mnc, lac, ci);
+		}
+		index[slot] = entryIndex;
+
+		CellularHelperCellHistoryEntry &entry = entries[entryIndex];
+		entry = CellularHelperCellHistoryEntry();
+		entry.hash = hash;
+		entry.firstSeenMs = (uint32_t) timeMs;
+	}
+
+	CellularHelperCellHistoryEntry &entry = entries[entryIndex];
+	entry.cell = cell;
+	entry.lastSeenMs = (uint32_t) timeMs;
+	if (entry.seenCount < 0xffff) {
+		entry.seenCount++;
+	}
+
+	// Same range of known values as CellularHelperEnvironmentCellData::getRSSI()
+	int level = cell.getLevel();
+	if (level <= 96 && entry.levelCount < 0xffff) {
+		if (entry.levelCount == 0 || level < entry.levelMin) {
+			entry.levelMin = (uint8_t) level;
+		}
+		if (entry.levelCount == 0 || level > entry.levelMax) {
+			entry.levelMax = (uint8_t) level;
+		}
+		entry.levelSum += (uint32_t) level;
+		entry.levelCount++;
+	}
+
+	linkFront(entryIndex);
+	return true;
+}
+
+size_t CellularHelperCellHistory::addEnvironment(const CellularHelperEnvironmentResponse &resp, unsigned long timeMs) {
+	size_t numAdded = 0;
+
+	if (add(resp.service, timeMs)) {
+		numAdded++;
+	}
+
+	size_t numNeighbors = resp.getNumNeighbors();
+	CellularHelperEnvironmentCellData neighbor;
+	for(size_t ii = 0; ii < numNeighbors; ii++) {
+		if (resp.getNeighbor(ii, neighbor) && add(neighbor, timeMs)) {
+			numAdded++;
+		}
+	}
+	return numAdded;
+}
+
+const CellularHelperCellHistoryEntry *CellularHelperCellHistory::find(int mcc, int mnc, int lac, int ci) const {
+	if (maxEntries == 0) {
+		return NULL;
+	}
+
+	uint16_t entryIndex = index[findSlot(getHash(mcc, mnc, lac, ci), mcc, mnc, lac, ci)];
+	return (entryIndex != NONE) ? &entries[entryIndex] : NULL;
+}
+
+size_t CellularHelperCellHistory::removeOlderThan(unsigned long maxAgeMs, unsigned long nowMs) {
+	size_t numRemoved = 0;
+
+	// The LRU list is in order of lastSeenMs, so stop at the first cell that is recent enough
+	while(lruTail != NONE && (uint32_t)nowMs - entries[lruTail].lastSeenMs > (uint32_t)maxAgeMs) {
+		remove(lruTail);
+		numRemoved++;
+	}
+	return numRemoved;
+}
+
+void CellularHelperCellHistory::clear() {
+	for(size_t ii = 0; ii < indexSize; ii++) {
+		index[ii] = NONE;
+	}
+	numEntries = 0;
+	lruHead = lruTail = NONE;
+	numEvicted = 0;
+}
+
+const CellularHelperCellHistoryEntry *CellularHelperCellHistory::getLessRecent(const CellularHelperCellHistoryEntry *entry) const {
+	if (!entry || entry->lruNext == NONE) {
+		return NULL;
+	}
+	return &entries[entry->lruNext];
+}
+
+// [static]
+uint16_t CellularHelperCellHistory::getHash(int mcc, int mnc, int lac, int ci) {
+	uint32_t hash = ((uint32_t)mcc * 1000 + (uint32_t)mnc) ^ ((uint32_t)lac << 12) ^ ((uint32_t)ci * 0x9e3779b1UL);
+
+	// Mix the high bits into the low bits, which select the slot
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bUL;
+	hash ^= hash >> 13;
+	return (uint16_t) hash;
+}
+
+// [static]
+bool CellularHelperCellHistory::isMatch(const CellularHelperCellHistoryEntry &entry, int mcc, int mnc, int lac, int ci) {
+	return entry.cell.getCI() == ci && entry.cell.getLAC() == lac && entry.cell.getMNC() == mnc && entry.cell.getMCC() == mcc;
+}
+
+size_t CellularHelperCellHistory::findSlot(uint16_t hash, int mcc, int mnc, int lac, int ci) const {
+	size_t mask = indexSize - 1;
+
+	// Linear probing. There is always an empty slot, as maxEntries < indexSize.
+	size_t slot = hash & mask;
+	while(index[slot] != NONE) {
+		const CellularHelperCellHistoryEntry &entry = entries[index[slot]];
+		if (entry.hash == hash && isMatch(entry, mcc, mnc, lac, ci)) {
+			break;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void CellularHelperCellHistory::removeFromIndex(uint16_t entryIndex) {
+	size_t mask = indexSize - 1;
+
+	size_t hole = entries[entryIndex].hash & mask;
+	while(index[hole] != entryIndex) {
+		hole = (hole + 1) & mask;
+	}
+
+	// Backward shift: move each following entry into the hole unless that would put it before
+	// its home slot, so lookups never stop early at an empty slot
+	size_t slot = hole;
+	while(true) {
+		slot = (slot + 1) & mask;
+		if (index[slot] == NONE) {
+			break;
+		}
+		size_t home = entries[index[slot]].hash & mask;
+		if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+			index[hole] = index[slot];
+			hole = slot;
+		}
+	}
+	index[hole] = NONE;
+}
+
+void CellularHelperCellHistory::unlink(uint16_t entryIndex) {
+	CellularHelperCellHistoryEntry &entry = entries[entryIndex];
+
+	if (entry.lruPrev != NONE) {
+		entries[entry.lruPrev].lruNext = entry.lruNext;
+	}
+	else {
+		lruHead = entry.lruNext;
+	}
+
+	if (entry.lruNext != NONE) {
+		entries[entry.lruNext].lruPrev = entry.lruPrev;
+	}
+	else {
+		lruTail = entry.lruPrev;
+	}
+	entry.lruPrev = entry.lruNext = NONE;
+}
+
+void CellularHelperCellHistory::linkFront(uint16_t entryIndex) {
+	CellularHelperCellHistoryEntry &entry = entries[entryIndex];
+
+	entry.lruPrev = NONE;
+	entry.lruNext = lruHead;
+	if (lruHead != NONE) {
+		entries[lruHead].lruPrev = entryIndex;
+	}
+	else {
+		lruTail = entryIndex;
+	}
+	lruHead = entryIndex;
+}
+
+void CellularHelperCellHistory::remove(uint16_t entryIndex) {
+	unlink(entryIndex);
+	removeFromIndex(entryIndex);
+
+	// Keep the entries contiguous by moving the last one into the free entry
+	uint16_t lastIndex = (uint16_t)(numEntries - 1);
+	if (entryIndex != lastIndex) {
+		CellularHelperCellHistoryEntry &last = entries[lastIndex];
+		entries[entryIndex] = last;
+
+		size_t mask = indexSize - 1;
+		size_t slot = last.hash & mask;
+		while(index[slot] != lastIndex) {
+			slot = (slot + 1) & mask;
+		}
+		index[slot] = entryIndex;
+
+		if (last.lruPrev != NONE) {
+			entries[last.lruPrev].lruNext = entryIndex;
+		}
+		else {
+			lruHead = entryIndex;
+		}
+		if (last.lruNext != NONE) {
+			entries[last.lruNext].lruPrev = entryIndex;
+		}
+		else {
+			lruTail = entryIndex;
+		}
+	}
+	numEntries--;
+}
+
+#endif /* Wiring_Cellular */
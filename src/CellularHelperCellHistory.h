@@ -0,0 +1,265 @@
+#ifndef __CELLULARHELPERCELLHISTORY_H
+#define __CELLULARHELPERCELLHISTORY_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#if Wiring_Cellular
+
+/**
+ * @brief One cell in the history, with the most recent scan data and statistics over all scans
+ *
+ * This is 40 bytes. The level is rxlev (2G and LTE) or rscpLev (3G) as in CellularHelperPackedCellData;
+ * only values 0 - 96 are included in the statistics.
+ */
+struct CellularHelperCellHistoryEntry {
+	CellularHelperPackedCellData cell;	//!< Data from the most recent scan that included the cell
+	uint32_t firstSeenMs;				//!< Time the cell was first added, as passed to add()
+	uint32_t lastSeenMs;				//!< Time the cell was most recently added
+	uint32_t levelSum;					//!< Sum of the known levels, for the mean
+	uint16_t seenCount;					//!< Number of times the cell was added (saturates at 65535)
+	uint16_t levelCount;				//!< Number of known levels in levelSum
+	uint8_t levelMin;					//!< Minimum known level, only valid if levelCount is non-zero
+	uint8_t levelMax;					//!< Maximum known level, only valid if levelCount is non-zero
+	uint16_t hash;						//!< Hash of the key, used internally
+	uint16_t lruPrev;					//!< Index of the next more recently seen entry, used internally
+	uint16_t lruNext;					//!< Index of the next less recently seen entry, used internally
+
+	/**
+	 * @brief Gets the mean of the known levels, or 0 if there are none
+	 */
+	float getMeanLevel() const { return levelCount ? (float)levelSum / (float)levelCount : 0.0; };
+
+	/**
+	 * @brief Converts this object into a readable string
+	 *
+	 * The string will be of the format `mcc=310 mnc=260 lac=ab22 ci=a78a seen=3 first=1000 last=61000 level=20/24.3/28`,
+	 * where level is the minimum, mean, and maximum.
+	 */
+	String toString() const;
+};
+
+/**
+ * @brief Fixed-capacity history of the cells seen in getEnvironment() scans
+ *
+ * Cells are keyed by (mcc, mnc, lac, ci). Adding a cell that is already in the history updates its data,
+ * last seen time, and level statistics, so repeated scans, including the service cell from a quick AT+CGED,
+ * are merged with the neighbors from a slow AT+COPS=5 scan. When the history is full, the least recently
+ * seen cell is replaced.
+ *
+ * The index is an open addressing hash table of entry numbers, so add() and find() do not search
+ * every entry. No memory is allocated after construction.
+ *
+ * You may want to use CellularHelperCellHistoryStatic<> instead of separately allocating the arrays.
+ */
+class CellularHelperCellHistory {
+public:
+	/**
+	 * @brief Constructor that takes external arrays
+	 *
+	 * @param entries Pointer to array of CellularHelperCellHistoryEntry
+	 *
+	 * @param maxEntries Number of items in entries. Must be less than indexSize.
+	 *
+	 * @param index Pointer to array of uint16_t used as the hash table
+	 *
+	 * @param indexSize Number of items in index. Must be a power of 2, and should be at least twice maxEntries.
+	 */
+	CellularHelperCellHistory(CellularHelperCellHistoryEntry *entries, size_t maxEntries, uint16_t *index, size_t indexSize);
+
+	/**
+	 * @brief Adds or updates a cell
+	 *
+	 * @param data The cell data, typically the service cell or a neighbor from getEnvironment().
+	 *
+	 * @param timeMs The time of the scan in milliseconds, typically millis().
+	 *
+	 * @return true if the cell was added or updated, false if it is not valid.
+	 */
+	bool add(const CellularHelperEnvironmentCellData &data, unsigned long timeMs);
+
+	/**
+	 * @brief Adds or updates a cell from packed data
+	 */
+	bool add(const CellularHelperPackedCellData &cell, unsigned long timeMs);
+
+	/**
+	 * @brief Adds or updates the service cell and all of the neighbors from a scan
+	 *
+	 * @return The number of cells added or updated.
+	 */
+	size_t addEnvironment(const CellularHelperEnvironmentResponse &resp, unsigned long timeMs);
+
+	/**
+	 * @brief Finds a cell
+	 *
+	 * @return The entry, or NULL if the cell is not in the history. This does not change which cell is
+	 * least recently seen.
+	 */
+	const CellularHelperCellHistoryEntry *find(int mcc, int mnc, int lac, int ci) const;
+
+	/**
+	 * @brief Removes cells that have not been seen recently
+	 *
+	 * @param maxAgeMs Cells last seen more than this many milliseconds before nowMs are removed.
+	 *
+	 * @param nowMs The current time, typically millis().
+	 *
+	 * @return The number of cells removed.
+	 */
+	size_t removeOlderThan(unsigned long maxAgeMs, unsigned long nowMs);
+
+	/**
+	 * @brief Removes all cells
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of cells in the history
+	 */
+	size_t getNumEntries() const { return numEntries; };
+
+	/**
+	 * @brief Gets an entry by index, 0 <= index < getNumEntries()
+	 *
+	 * Entries are not in any particular order, and removing a cell can change the index of another.
+	 */
+	const CellularHelperCellHistoryEntry &getEntry(size_t index) const { return entries[index]; };
+
+	/**
+	 * @brief Gets the most recently seen cell, or NULL if the history is empty
+	 */
+	const CellularHelperCellHistoryEntry *getMostRecent() const { return (lruHead != NONE) ? &entries[lruHead] : NULL; };
+
+	/**
+	 * @brief Gets the next less recently seen cell after entry, or NULL if entry is the least recently seen
+	 */
+	const CellularHelperCellHistoryEntry *getLessRecent(const CellularHelperCellHistoryEntry *entry) const;
+
+	/**
+	 * @brief Gets the number of cells replaced because the history was full
+	 */
+	uint32_t getNumEvicted() const { return numEvicted; };
+
+	/**
+	 * @brief Value of an empty index slot or of lruPrev and lruNext at the end of the list
+	 */
+	static const uint16_t NONE = 0xffff;
+
+	/**
+	 * @brief Gets the index size to use for a number of entries (the next power of 2 that is at least twice as large)
+	 */
+	static constexpr size_t getIndexSize(size_t maxEntries, size_t size = 1) {
+		return (size >= maxEntries * 2) ? size : getIndexSize(maxEntries, size * 2);
+	}
+
+protected:
+	/**
+	 * @brief Gets the hash of a key
+	 */
+	static uint16_t getHash(int mcc, int mnc, int lac, int ci);
+
+	/**
+	 * @brief Returns true if the entry has the key
+	 */
+	static bool isMatch(const CellularHelperCellHistoryEntry &entry, int mcc, int mnc, int lac, int ci);
+
+	/**
+	 * @brief Gets the index slot that has the key, or the empty slot where it would be added
+	 */
+	size_t findSlot(uint16_t hash, int mcc, int mnc, int lac, int ci) const;
+
+	/**
+	 * @brief Removes an entry from the index, moving later entries back so there are no gaps in the probe sequence
+	 */
+	void removeFromIndex(uint16_t entryIndex);
+
+	/**
+	 * @brief Removes an entry from the LRU list
+	 */
+	void unlink(uint16_t entryIndex);
+
+	/**
+	 * @brief Adds an entry to the front (most recently seen) of the LRU list
+	 */
+	void linkFront(uint16_t entryIndex);
+
+	/**
+	 * @brief Removes an entry, moving the last entry into its place
+	 */
+	void remove(uint16_t entryIndex);
+
+	/**
+	 * @brief Array of entries, the first numEntries are used
+	 */
+	CellularHelperCellHistoryEntry *entries;
+
+	/**
+	 * @brief Number of items in entries
+	 */
+	size_t maxEntries;
+
+	/**
+	 * @brief Hash table of entry indexes, NONE for empty slots
+	 */
+	uint16_t *index;
+
+	/**
+	 * @brief Number of items in index, a power of 2
+	 */
+	size_t indexSize;
+
+	/**
+	 * @brief Number of entries used
+	 */
+	size_t numEntries = 0;
+
+	/**
+	 * @brief Most recently seen entry
+	 */
+	uint16_t lruHead = NONE;
+
+	/**
+	 * @brief Least recently seen entry, which is replaced when the history is full
+	 */
+	uint16_t lruTail = NONE;
+
+	/**
+	 * @brief Number of cells replaced because the history was full
+	 */
+	uint32_t numEvicted = 0;
+};
+
+/**
+ * @brief Cell history with statically allocated arrays
+ *
+ * @param MAX_ENTRIES templated parameter for the number of cells to keep. Each one is 40 bytes plus 4 to 8 bytes
+ * of index.
+ */
+template <size_t MAX_ENTRIES>
+class CellularHelperCellHistoryStatic : public CellularHelperCellHistory {
+public:
+	explicit CellularHelperCellHistoryStatic() : CellularHelperCellHistory(staticEntries, MAX_ENTRIES, staticIndex, INDEX_SIZE) {
+	}
+
+protected:
+	/**
+	 * @brief Number of items in staticIndex
+	 */
+	static const size_t INDEX_SIZE = CellularHelperCellHistory::getIndexSize(MAX_ENTRIES);
+
+	/**
+	 * @brief Array of entries
+	 */
+	CellularHelperCellHistoryEntry staticEntries[MAX_ENTRIES];
+
+	/**
+	 * @brief Hash table
+	 */
+	uint16_t staticIndex[INDEX_SIZE];
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERCELLHISTORY_H */
@@ -0,0 +1,178 @@
+#include "Particle.h"
+
+#include "CellularHelperCellLocationDB.h"
+
+#if Wiring_Cellular
+
+// The table is little endian, as are the devices, and may not be aligned, so values are read with memcpy
+template <class T>
+static T readValue(const uint8_t *p) {
+	T value;
+	memcpy(&value, p, sizeof(T));
+	return value;
+}
+
+String CellularHelperCellLocation::toString() const {
+	if (valid) {
+		return String::format("lat=%f lon=%f uncertainty=%d cells=%u", lat, lon, uncertainty, (unsigned int)numCells);
+	}
+	else {
+		return "valid=false";
+	}
+}
+
+CellularHelperCellLocationDB::CellularHelperCellLocationDB(const uint8_t *data, size_t dataSize) {
+	if (!data || dataSize < HEADER_SIZE) {
+		return;
+	}
+
+	uint32_t magic = readValue<uint32_t>(&data[0]);
+	uint16_t version = readValue<uint16_t>(&data[4]);
+	uint16_t valueSize = readValue<uint16_t>(&data[6]);
+	uint32_t count = readValue<uint32_t>(&data[8]);
+
+	if (magic != MAGIC || version != VERSION || valueSize != VALUE_SIZE ||
+		count > (dataSize - HEADER_SIZE) / (KEY_SIZE + VALUE_SIZE)) {
+		return;
+	}
+
+	keys = &data[HEADER_SIZE];
+	values = &keys[count * KEY_SIZE];
+	numCells = count;
+}
+
+bool CellularHelperCellLocationDB::find(int mcc, int mnc, int lac, int ci, CellularHelperCellLocation &location) const {
+	location = CellularHelperCellLocation();
+
+	uint64_t key;
+	if (!getKey(mcc, mnc, lac, ci, key)) {
+		return false;
+	}
+
+	size_t index = findIndex(key);
+	if (index >= numCells) {
+		return false;
+	}
+
+	int32_t latE7, lonE7;
+	uint16_t range;
+	getValueAt(index, latE7, lonE7, range);
+
+	location.valid = true;
+	location.lat = (float)latE7 / 10000000.0f;
+	location.lon = (float)lonE7 / 10000000.0f;
+	location.uncertainty = range;
+	location.numCells = 1;
+	return true;
+}
+
+bool CellularHelperCellLocationDB::find(const CellularHelperEnvironmentCellData &data, CellularHelperCellLocation &location) const {
+	if (!data.isValid()) {
+		location = CellularHelperCellLocation();
+		return false;
+	}
+	return find(data.mcc, data.mnc, data.lac, data.ci, location);
+}
+
+bool CellularHelperCellLocationDB::find(int mcc, int mnc, const CellularHelperCREGResponse &resp, CellularHelperCellLocation &location) const {
+	if (!resp.valid) {
+		location = CellularHelperCellLocation();
+		return false;
+	}
+	return find(mcc, mnc, resp.lac, resp.ci, location);
+}
+
+bool CellularHelperCellLocationDB::find(const CellularHelperEnvironmentResponse &resp, CellularHelperCellLocation &location) const {
+	if (find(resp.service, location)) {
+		return true;
+	}
+
+	// Weighted mean of the neighbors, in 0.0000001 degrees so the sum doesn't lose precision as a float would
+	int64_t latSum = 0;
+	int64_t lonSum = 0;
+	int64_t weightSum = 0;
+	int maxRange = 0;
+	size_t numFound = 0;
+
+	size_t numNeighbors = resp.getNumNeighbors();
+	CellularHelperEnvironmentCellData neighbor;
+	for(size_t ii = 0; ii < numNeighbors; ii++) {
+		uint64_t key;
+		if (!resp.getNeighbor(ii, neighbor) || !neighbor.isValid() ||
+			!getKey(neighbor.mcc, neighbor.mnc, neighbor.lac, neighbor.ci, key)) {
+			continue;
+		}
+
+		size_t index = findIndex(key);
+		if (index >= numCells) {
+			continue;
+		}
+
+		int32_t latE7, lonE7;
+		uint16_t range;
+		getValueAt(index, latE7, lonE7, range);
+
+		int64_t weight = 65536 / ((range != 0) ? range : 1);
+		latSum += (int64_t)latE7 * weight;
+		lonSum += (int64_t)lonE7 * weight;
+		weightSum += weight;
+		if (range > maxRange) {
+			maxRange = range;
+		}
+		numFound++;
+	}
+
+	if (numFound == 0) {
+		return false;
+	}
+
+	location.valid = true;
+	location.lat = (float)(latSum / weightSum) / 10000000.0f;
+	location.lon = (float)(lonSum / weightSum) / 10000000.0f;
+	location.uncertainty = maxRange;
+	location.numCells = numFound;
+	return true;
+}
+
+// [static]
+bool CellularHelperCellLocationDB::getKey(int mcc, int mnc, int lac, int ci, uint64_t &key) {
+	if (mcc < 0 || mcc > 999 || mnc < 0 || mnc > 999 || lac < 0 || lac > 0xffff || ci < 0 || ci > 0xfffffff) {
+		return false;
+	}
+	key = ((uint64_t)mcc << 54) | ((uint64_t)mnc << 44) | ((uint64_t)lac << 28) | (uint64_t)ci;
+	return true;
+}
+
+size_t CellularHelperCellLocationDB::findIndex(uint64_t key) const {
+	size_t low = 0;
+	size_t high = numCells;
+
+	while(low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (getKeyAt(mid) < key) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	if (low < numCells && getKeyAt(low) == key) {
+		return low;
+	}
+	return numCells;
+}
+
+uint64_t CellularHelperCellLocationDB::getKeyAt(size_t index) const {
+	return readValue<uint64_t>(&keys[index * KEY_SIZE]);
+}
+
+void CellularHelperCellLocationDB::getValueAt(size_t index, int32_t &latE7, int32_t &lonE7, uint16_t &range) const {
+	const uint8_t *value = &values[index * VALUE_SIZE];
+
+	latE7 = readValue<int32_t>(&value[0]);
+	lonE7 = readValue<int32_t>(&value[4]);
+	range = readValue<uint16_t>(&value[8]);
+}
+
+#endif /* Wiring_Cellular */
@@ -0,0 +1,208 @@
+#ifndef __CELLULARHELPERCELLLOCATIONDB_H
+#define __CELLULARHELPERCELLLOCATIONDB_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#if Wiring_Cellular
+
+/**
+ * @brief Location of a cell, or of a device estimated from several cells, from CellularHelperCellLocationDB
+ */
+class CellularHelperCellLocation {
+public:
+	/**
+	 * @brief Set to true if the values have been set
+	 */
+	bool valid = false;
+
+	/**
+	 * @brief Estimated latitude, in degrees (-90 to +90)
+	 */
+	float lat = 0.0;
+
+	/**
+	 * @brief Estimated longitude, in degrees (-180 to +180)
+	 */
+	float lon = 0.0;
+
+	/**
+	 * @brief Range of the cell in meters, or the largest range of the cells used (0 - 65535)
+	 */
+	int uncertainty = 0;
+
+	/**
+	 * @brief Number of cells the location was calculated from
+	 */
+	size_t numCells = 0;
+
+	/**
+	 * @brief Returns true if a valid location was found
+	 */
+	bool isValid() const { return valid; };
+
+	/**
+	 * @brief Converts this object into a readable string
+	 *
+	 * The string will be of the format `lat=42.360168 lon=-71.058899 uncertainty=1000 cells=1`.
+	 */
+	String toString() const;
+};
+
+/**
+ * @brief Offline lookup of cell locations from a table of known cells
+ *
+ * CellularHelper.getLocation() uses CellLocate (AT+ULOC), which needs a network connection and can
+ * take up to 2 minutes. If you have a table of the cells in the area your devices are used, this looks
+ * up the service cell (or the neighbors) without using the modem at all.
+ *
+ * The table is generated on a computer by tools/generate-cell-db.js from an OpenCellID format CSV file.
+ * It writes a binary file and, optionally, a .cpp file with the table as a const array, which is stored
+ * in flash. This class only reads the table through the pointer you pass to the constructor, so the
+ * table can also be in external flash that is mapped into the address space, or a file that is mmap'ed
+ * when running the same code on a computer.
+ *
+ * Format (version 1), all values little endian:
+ *
+ * - 16 byte header:
+ *   - 4 bytes: magic (`CHCL`)
+ *   - uint16_t: version (1)
+ *   - uint16_t: size of each value in bytes (12)
+ *   - uint32_t: number of cells
+ *   - uint32_t: reserved (0)
+ * - For each cell, sorted in ascending order with no duplicates, uint64_t key:
+ *   - bits 54 - 63: mcc (0 - 999)
+ *   - bits 44 - 53: mnc (0 - 999)
+ *   - bits 28 - 43: lac or tac (0 - 65535)
+ *   - bits 0 - 27: ci (0 - 268435455)
+ * - For each cell, in the same order as the keys:
+ *   - int32_t: latitude in units of 0.0000001 degrees
+ *   - int32_t: longitude in units of 0.0000001 degrees
+ *   - uint16_t: range in meters
+ *   - uint16_t: number of samples the location was calculated from (saturates at 65535)
+ *
+ * The keys are stored separately from the values so a binary search only reads the keys. Each cell
+ * is 20 bytes.
+ */
+class CellularHelperCellLocationDB {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param data The table from tools/generate-cell-db.js. It is not copied, so it must remain valid
+	 * while this object is used. It does not need to be aligned.
+	 *
+	 * @param dataSize The size of data in bytes.
+	 *
+	 * If the table is not valid, isValid() returns false and all lookups fail.
+	 */
+	CellularHelperCellLocationDB(const uint8_t *data, size_t dataSize);
+
+	/**
+	 * @brief Returns true if the table passed to the constructor is valid
+	 */
+	bool isValid() const { return keys != NULL; };
+
+	/**
+	 * @brief Gets the number of cells in the table
+	 */
+	size_t getNumCells() const { return numCells; };
+
+	/**
+	 * @brief Looks up a cell
+	 *
+	 * @param mcc Mobile Country Code
+	 *
+	 * @param mnc Mobile Network Code
+	 *
+	 * @param lac Location Area Code (2G and 3G) or Tracking Area Code (LTE)
+	 *
+	 * @param ci Cell Identifier
+	 *
+	 * @param location Filled in with the location of the cell.
+	 *
+	 * @return true if the cell is in the table.
+	 */
+	bool find(int mcc, int mnc, int lac, int ci, CellularHelperCellLocation &location) const;
+
+	/**
+	 * @brief Looks up a cell, for example envResp.service
+	 */
+	bool find(const CellularHelperEnvironmentCellData &data, CellularHelperCellLocation &location) const;
+
+	/**
+	 * @brief Looks up the cell from a +CREG or +CEREG response
+	 *
+	 * @param mcc Mobile Country Code, which is not part of the response. For example, from the service
+	 * cell or CellularHelper.getOperatorName().
+	 *
+	 * @param mnc Mobile Network Code
+	 *
+	 * @param resp The response from CellularHelper.getCREG() or CellularHelperRegistrationMonitor.
+	 */
+	bool find(int mcc, int mnc, const CellularHelperCREGResponse &resp, CellularHelperCellLocation &location) const;
+
+	/**
+	 * @brief Looks up the location from a scan
+	 *
+	 * @param resp The response from CellularHelper.getEnvironment() or AT+COPS=5.
+	 *
+	 * @param location Filled in with the location of the service cell if it's in the table. Otherwise,
+	 * the mean of the locations of the neighbors in the table, weighted so cells with a smaller range
+	 * count more.
+	 *
+	 * @return true if the service cell or at least one neighbor is in the table.
+	 */
+	bool find(const CellularHelperEnvironmentResponse &resp, CellularHelperCellLocation &location) const;
+
+	/**
+	 * @brief Gets the key for a cell
+	 *
+	 * @param key Filled in with the key.
+	 *
+	 * @return true if the values are in range, false if the cell can't be in the table.
+	 */
+	static bool getKey(int mcc, int mnc, int lac, int ci, uint64_t &key);
+
+	static const uint32_t MAGIC = 0x4c434843;	//!< "CHCL" as a little endian uint32_t
+	static const uint16_t VERSION = 1;			//!< Table format version
+	static const size_t HEADER_SIZE = 16;		//!< Size of the header in bytes
+	static const size_t KEY_SIZE = 8;			//!< Size of each key in bytes
+	static const size_t VALUE_SIZE = 12;		//!< Size of each value in bytes
+
+protected:
+	/**
+	 * @brief Gets the index of a key in the table, or numCells if it's not there
+	 */
+	size_t findIndex(uint64_t key) const;
+
+	/**
+	 * @brief Gets the key at index
+	 */
+	uint64_t getKeyAt(size_t index) const;
+
+	/**
+	 * @brief Gets the value at index
+	 */
+	void getValueAt(size_t index, int32_t &latE7, int32_t &lonE7, uint16_t &range) const;
+
+	/**
+	 * @brief Pointer to the first key, or NULL if the table is not valid
+	 */
+	const uint8_t *keys = NULL;
+
+	/**
+	 * @brief Pointer to the first value
+	 */
+	const uint8_t *values = NULL;
+
+	/**
+	 * @brief Number of cells in the table
+	 */
+	size_t numCells = 0;
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERCELLLOCATIONDB_H */
@@ -0,0 +1,190 @@
+#include "Particle.h"
+
+#include "CellularHelperCommandStats.h"
+
+#if Wiring_Cellular
+
+uint32_t CellularHelperCommandStatsEntry::getPercentileMs(int percent) const {
+	uint32_t count = 0;
+	for(size_t ii = 0; ii < NUM_BUCKETS; ii++) {
+		count += histogram[ii];
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	// Nearest rank, as in CellularHelperSignalSampler
+	uint32_t rank = (count * (uint32_t)percent + 99) / 100;
+	uint32_t cumulative = 0;
+	for(size_t ii = 0; ii < NUM_BUCKETS - 1; ii++) {
+		cumulative += histogram[ii];
+		if (cumulative >= rank) {
+			uint32_t bucketMaxMs = getBucketMaxMs(ii);
+			return (bucketMaxMs < maxMs) ? bucketMaxMs : maxMs;
+		}
+	}
+	return maxMs;
+}
+
+String CellularHelperCommandStatsEntry::toString() const {
+	uint32_t count = getCount();
+
+	return String::format("%s n=%lu ok=%lu err=%lu to=%lu bytes=%lu mean=%lu max=%lu p50=%lu p90=%lu",
+		name, (unsigned long)count, (unsigned long)okCount, (unsigned long)errorCount, (unsigned long)timeoutCount,
+		(unsigned long)bytes, (unsigned long)(count ? totalMs / count : 0), (unsigned long)maxMs,
+		(unsigned long)getPercentileMs(50), (unsigned long)getPercentileMs(90));
+}
+
+// [static]
+size_t CellularHelperCommandStatsEntry::getBucket(uint32_t ms) {
+	size_t bucket = 0;
+	while(ms != 0 && bucket < NUM_BUCKETS - 1) {
+		ms >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+// [static]
+uint32_t CellularHelperCommandStatsEntry::getBucketMaxMs(size_t bucket) {
+	return (bucket == 0) ? 0 : ((uint32_t)1 << bucket) - 1;
+}
+
+
+CellularHelperCommandStats::CellularHelperCommandStats(CellularHelperCommandStatsEntry *entries, size_t maxEntries) :
+	entries(entries), maxEntries(maxEntries) {
+}
+
+void CellularHelperCommandStats::record(const char *name, int resp, uint32_t elapsedMs, size_t bytes) {
+	// The async worker thread can send commands at the same time as the application thread
+	SINGLE_THREADED_BLOCK() {
+		CellularHelperCommandStatsEntry *entry = (CellularHelperCommandStatsEntry *) findEntry(name);
+		if (!entry) {
+			if (numEntries < maxEntries) {
+				entry = &entries[numEntries++];
+				memset(entry, 0, sizeof(CellularHelperCommandStatsEntry));
+				entry->name = name;
+			}
+			else {
+				numDropped++;
+			}
+		}
+
+		if (entry) {
+			switch(resp) {
+			case RESP_OK:
+				entry->okCount++;
+				break;
+
+			case RESP_ERROR:
+				entry->errorCount++;
+				break;
+
+			case WAIT:
+				entry->timeoutCount++;
+				break;
+
+			default:
+				entry->otherCount++;
+				break;
+			}
+
+			entry->bytes += bytes;
+			entry->totalMs += elapsedMs;
+			if (elapsedMs > entry->maxMs) {
+				entry->maxMs = elapsedMs;
+			}
+
+			uint16_t &bucketCount = entry->histogram[CellularHelperCommandStatsEntry::getBucket(elapsedMs)];
+			if (bucketCount < 0xffff) {
+				bucketCount++;
+			}
+		}
+	}
+}
+
+void CellularHelperCommandStats::clear() {
+	SINGLE_THREADED_BLOCK() {
+		numEntries = 0;
+		numDropped = 0;
+	}
+}
+
+const CellularHelperCommandStatsEntry *CellularHelperCommandStats::findEntry(const char *name) const {
+	// Also called from record(), which is already in a single threaded block
+	SINGLE_THREADED_BLOCK() {
+		for(size_t ii = 0; ii < numEntries; ii++) {
+			// Names are usually the same string constant, so compare the pointer first
+			if (entries[ii].name == name || strcmp(entries[ii].name, name) == 0) {
+				return &entries[ii];
+			}
+		}
+	}
+	return NULL;
+}
+
+bool CellularHelperCommandStats::copyEntry(const char *name, CellularHelperCommandStatsEntry &entry) const {
+	SINGLE_THREADED_BLOCK() {
+		const CellularHelperCommandStatsEntry *found = findEntry(name);
+		if (found) {
+			entry = *found;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool CellularHelperCommandStats::copyEntry(size_t index, CellularHelperCommandStatsEntry &entry) const {
+	SINGLE_THREADED_BLOCK() {
+		if (index < numEntries) {
+			entry = entries[index];
+			return true;
+		}
+	}
+	return false;
+}
+
+void CellularHelperCommandStats::logStats() const {
+	// Only copies are made in the single threaded blocks. Formatting allocates and logging takes the
+	// log lock, either of which could deadlock with thread switching disabled.
+	CellularHelperCommandStatsEntry entry;
+	for(size_t ii = 0; copyEntry(ii, entry); ii++) {
+		// The entry name could contain a %, so it's not used as the format string
+		Log.info("%s", entry.toString().c_str());
+	}
+
+	uint32_t dropped = 0;
+	SINGLE_THREADED_BLOCK() {
+		dropped = numDropped;
+	}
+	if (dropped) {
+		Log.info("%lu commands not recorded (no free entries)", (unsigned long)dropped);
+	}
+}
+
+size_t CellularHelperCommandStats::dump(char *buf, size_t bufSize) const {
+	if (bufSize == 0) {
+		return 0;
+	}
+	buf[0] = 0;
+
+	size_t offset = 0;
+	size_t ii;
+	CellularHelperCommandStatsEntry entry;
+	for(ii = 0; copyEntry(ii, entry); ii++) {
+		uint32_t count = entry.getCount();
+
+		int len = snprintf(&buf[offset], bufSize - offset, "%s%s,%lu,%lu,%lu,%lu,%lu,%lu", (ii == 0) ? "" : ";",
+			entry.name, (unsigned long)count, (unsigned long)entry.okCount, (unsigned long)entry.errorCount,
+			(unsigned long)entry.timeoutCount, (unsigned long)(count ? entry.totalMs / count : 0), (unsigned long)entry.maxMs);
+		if (len < 0 || (size_t)len >= bufSize - offset) {
+			// Remove the partial entry
+			buf[offset] = 0;
+			break;
+		}
+		offset += (size_t)len;
+	}
+	return ii;
+}
+
+#endif /* Wiring_Cellular */
@@ -0,0 +1,221 @@
+#ifndef __CELLULARHELPERCOMMANDSTATS_H
+#define __CELLULARHELPERCOMMANDSTATS_H
+
+#include "Particle.h"
+
+#if Wiring_Cellular
+
+/**
+ * @brief Counters and a latency histogram for one command, such as CSQ
+ *
+ * The histogram has log2 buckets of milliseconds. Bucket 0 is 0 ms, bucket 1 is 1 ms, bucket 2 is
+ * 2 - 3 ms, bucket 3 is 4 - 7 ms, and so on. The last bucket includes everything above 2^(NUM_BUCKETS - 2) ms.
+ */
+struct CellularHelperCommandStatsEntry {
+	/**
+	 * @brief Number of histogram buckets. The last one is about 4 minutes and longer.
+	 */
+	static const size_t NUM_BUCKETS = 20;
+
+	const char *name;			//!< Command name, such as "CSQ". Points to a string constant.
+	uint32_t okCount;			//!< Number of RESP_OK results
+	uint32_t errorCount;		//!< Number of RESP_ERROR results
+	uint32_t timeoutCount;		//!< Number of timeouts (WAIT returned by Cellular.command)
+	uint32_t otherCount;		//!< Number of other results, such as RESP_ABORTED
+	uint32_t bytes;				//!< Number of response bytes passed to the callback
+	uint32_t totalMs;			//!< Sum of the latencies in milliseconds, for the mean
+	uint32_t maxMs;				//!< Maximum latency in milliseconds
+	uint16_t histogram[NUM_BUCKETS]; //!< Number of commands in each latency bucket (saturates at 65535)
+
+	/**
+	 * @brief Gets the total number of times the command was sent
+	 */
+	uint32_t getCount() const { return okCount + errorCount + timeoutCount + otherCount; };
+
+	/**
+	 * @brief Gets an upper bound on a latency percentile from the histogram
+	 *
+	 * @param percent The percentile, 1 - 100. For example, 50 for the median.
+	 *
+	 * @return The upper limit in milliseconds of the bucket containing the percentile, or 0 if there are
+	 * no samples. For the last bucket, maxMs is returned.
+	 */
+	uint32_t getPercentileMs(int percent) const;
+
+	/**
+	 * @brief Converts this object into a readable string
+	 *
+	 * The string will be of the format `CSQ n=12 ok=11 err=1 to=0 bytes=360 mean=35 max=80 p50=63 p90=127`.
+	 */
+	String toString() const;
+
+	/**
+	 * @brief Gets the histogram bucket for a latency
+	 */
+	static size_t getBucket(uint32_t ms);
+
+	/**
+	 * @brief Gets the largest latency in milliseconds in a bucket
+	 */
+	static uint32_t getBucketMaxMs(size_t bucket);
+};
+
+/**
+ * @brief Collects latency and result statistics for each command the library sends to the modem
+ *
+ * Pass one of these to CellularHelper.setCommandStats() to enable it. When it's not set, the
+ * statistics are not collected and it costs nothing.
+ *
+ * You may want to use CellularHelperCommandStatsStatic<> instead of separately allocating the
+ * array of entries.
+ */
+class CellularHelperCommandStats {
+public:
+	/**
+	 * @brief Constructor that takes an external array of entries
+	 *
+	 * @param entries Pointer to array of CellularHelperCommandStatsEntry
+	 *
+	 * @param maxEntries Number of items in entries. One is used for each different command name.
+	 */
+	CellularHelperCommandStats(CellularHelperCommandStatsEntry *entries, size_t maxEntries);
+
+	/**
+	 * @brief Records the result of one command (called from CellularHelper.command())
+	 *
+	 * @param name The command name, such as "CSQ". This must be a string constant, as only the
+	 * pointer is saved.
+	 *
+	 * @param resp The result code from Cellular.command().
+	 *
+	 * @param elapsedMs How long the command took in milliseconds.
+	 *
+	 * @param bytes The number of response bytes passed to the callback.
+	 */
+	void record(const char *name, int resp, uint32_t elapsedMs, size_t bytes);
+
+	/**
+	 * @brief Removes all entries
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of different commands that have been recorded
+	 */
+	size_t getNumEntries() const { return numEntries; };
+
+	/**
+	 * @brief Gets an entry by index, 0 <= index < getNumEntries()
+	 *
+	 * The entry is not locked. If commands are sent from another thread (such as the
+	 * CellularHelperAsync worker), it can change while you read it; use copyEntry() instead.
+	 */
+	const CellularHelperCommandStatsEntry &getEntry(size_t index) const { return entries[index]; };
+
+	/**
+	 * @brief Gets the entry for a command name
+	 *
+	 * @param name The command name, such as "CSQ".
+	 *
+	 * @return The entry, or NULL if the command has not been recorded.
+	 *
+	 * The search is locked, but the entry returned is not. If commands are sent from another thread
+	 * (such as the CellularHelperAsync worker), it can change while you read it, and clear() can
+	 * reuse it for a different command; use copyEntry() instead.
+	 */
+	const CellularHelperCommandStatsEntry *findEntry(const char *name) const;
+
+	/**
+	 * @brief Copies the entry for a command name, so it can be read while commands are being recorded
+	 *
+	 * @param name The command name, such as "CSQ".
+	 *
+	 * @param entry Filled in with a copy of the entry.
+	 *
+	 * @return true if the command has been recorded, false if not (entry is not changed).
+	 */
+	bool copyEntry(const char *name, CellularHelperCommandStatsEntry &entry) const;
+
+	/**
+	 * @brief Copies an entry by index, so it can be read while commands are being recorded
+	 *
+	 * @param index The index, 0 <= index < getNumEntries().
+	 *
+	 * @param entry Filled in with a copy of the entry.
+	 *
+	 * @return true if the entry was copied, false if index is not less than the number of entries.
+	 */
+	bool copyEntry(size_t index, CellularHelperCommandStatsEntry &entry) const;
+
+	/**
+	 * @brief Gets the number of commands not recorded because entries was full
+	 */
+	uint32_t getNumDropped() const { return numDropped; };
+
+	/**
+	 * @brief Writes all entries to the log, one line each, using Log.info
+	 *
+	 * Each entry is copied while locked and logged after, as logging allocates memory and takes
+	 * the log lock, which must not be done with thread switching disabled.
+	 */
+	void logStats() const;
+
+	/**
+	 * @brief Writes a compact summary of all entries to a buffer, for publishing
+	 *
+	 * Entries are separated by `;` and are of the format `CSQ,12,11,1,0,35,80` (name, count, ok,
+	 * error, timeout, mean ms, max ms). Entries that don't fit are left out. Each entry is copied
+	 * while locked, so this can be called while commands are being recorded.
+	 *
+	 * @param buf Buffer to write to. It is always null terminated if bufSize is not 0.
+	 *
+	 * @param bufSize Size of buf in bytes.
+	 *
+	 * @return The number of entries written.
+	 */
+	size_t dump(char *buf, size_t bufSize) const;
+
+protected:
+	/**
+	 * @brief Array of entries, in the order the commands were first recorded
+	 */
+	CellularHelperCommandStatsEntry *entries;
+
+	/**
+	 * @brief Number of items in entries
+	 */
+	size_t maxEntries;
+
+	/**
+	 * @brief Number of entries used
+	 */
+	size_t numEntries = 0;
+
+	/**
+	 * @brief Number of commands not recorded because entries was full
+	 */
+	uint32_t numDropped = 0;
+};
+
+/**
+ * @brief Command statistics with a statically allocated array of entries
+ *
+ * @param MAX_ENTRIES templated parameter for the number of different commands. Each one is 72 bytes.
+ * The library uses about 20 different commands.
+ */
+template <size_t MAX_ENTRIES>
+class CellularHelperCommandStatsStatic : public CellularHelperCommandStats {
+public:
+	explicit CellularHelperCommandStatsStatic() : CellularHelperCommandStats(staticEntries, MAX_ENTRIES) {
+	}
+
+protected:
+	/**
+	 * @brief Array of entries
+	 */
+	CellularHelperCommandStatsEntry staticEntries[MAX_ENTRIES];
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERCOMMANDSTATS_H */
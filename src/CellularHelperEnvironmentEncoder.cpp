@@ -0,0 +1,338 @@
+#include "Particle.h"
+
+#include "CellularHelperEnvironmentEncoder.h"
+
+#if Wiring_Cellular
+
+static uint32_t zigzagEncode(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzagDecode(uint32_t value) {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// The starting point for delta encoding
+static void clearPrevious(CellularHelperEnvironmentCellData &prev) {
+	prev.mcc = prev.mnc = prev.lac = prev.ci = 0;
+}
+
+// [static]
+size_t CellularHelperEnvironmentEncoder::encode(const CellularHelperEnvironmentResponse &resp, uint8_t *buf, size_t bufSize) {
+	// Neighbors are only included if valid. Count them first as the count comes before the cells.
+	size_t numValid = 0;
+	size_t numParsed = (resp.curDataIndex > 0) ? (size_t)resp.curDataIndex : 0;
+	if (numParsed > resp.numNeighbors) {
+		numParsed = resp.numNeighbors;
+	}
+
+	CellularHelperEnvironmentCellData cell;
+	for(size_t ii = 0; ii < numParsed; ii++) {
+		if (resp.getNeighbor(ii, cell)) {
+			numValid++;
+		}
+	}
+
+	size_t offset = 0;
+	if (!putByte(VERSION, buf, bufSize, offset) || !putVarint(1 + numValid, buf, bufSize, offset)) {
+		return 0;
+	}
+
+	CellularHelperEnvironmentCellData prev;
+	clearPrevious(prev);
+
+	if (!encodeCell(resp.service, prev, buf, bufSize, offset)) {
+		return 0;
+	}
+
+	for(size_t ii = 0; ii < numParsed; ii++) {
+		if (resp.getNeighbor(ii, cell)) {
+			if (!encodeCell(cell, prev, buf, bufSize, offset)) {
+				return 0;
+			}
+		}
+	}
+
+	return offset;
+}
+
+// [static]
+bool CellularHelperEnvironmentEncoder::decode(const uint8_t *buf, size_t len, CellularHelperEnvironmentResponse &resp) {
+	size_t offset = 0;
+	uint32_t numCells;
+
+	if (len < 1 || buf[offset++] != VERSION) {
+		return false;
+	}
+	if (!getVarint(buf, len, offset, numCells) || numCells == 0) {
+		return false;
+	}
+
+	CellularHelperEnvironmentCellData prev;
+	clearPrevious(prev);
+
+	if (!decodeCell(buf, len, offset, prev, resp.service)) {
+		return false;
+	}
+
+	resp.curDataIndex = 0;
+
+	CellularHelperEnvironmentCellData cell;
+	for(uint32_t ii = 1; ii < numCells; ii++) {
+		if (!decodeCell(buf, len, offset, prev, cell)) {
+			return false;
+		}
+
+		// Still decode extra neighbors so prev stays correct, but don't store them
+		if ((size_t)resp.curDataIndex < resp.numNeighbors) {
+			if (resp.neighbors) {
+				resp.neighbors[resp.curDataIndex++] = cell;
+			}
+			else
+			if (resp.packedNeighbors) {
+				resp.packedNeighbors[resp.curDataIndex++].pack(cell);
+			}
+		}
+	}
+
+	// Mark the end of the neighbors, as getNumNeighbors() stops at the first invalid one
+	if (resp.neighbors && (size_t)resp.curDataIndex < resp.numNeighbors) {
+		resp.neighbors[resp.curDataIndex] = CellularHelperEnvironmentCellData();
+	}
+	else
+	if (resp.packedNeighbors && (size_t)resp.curDataIndex < resp.numNeighbors) {
+		resp.packedNeighbors[resp.curDataIndex] = CellularHelperPackedCellData();
+	}
+
+	resp.resp = RESP_OK;
+	return true;
+}
+
+// [static]
+size_t CellularHelperEnvironmentEncoder::toBase64(const uint8_t *src, size_t srcLen, char *dst, size_t dstSize) {
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	size_t dstLen = ((srcLen + 2) / 3) * 4;
+	if (dstLen + 1 > dstSize) {
+		return 0;
+	}
+
+	char *out = dst;
+	for(size_t ii = 0; ii < srcLen; ii += 3) {
+		uint32_t group = (uint32_t)src[ii] << 16;
+		if (ii + 1 < srcLen) {
+			group |= (uint32_t)src[ii + 1] << 8;
+		}
+		if (ii + 2 < srcLen) {
+			group |= src[ii + 2];
+		}
+
+		*out++ = alphabet[(group >> 18) & 0x3f];
+		*out++ = alphabet[(group >> 12) & 0x3f];
+		*out++ = (ii + 1 < srcLen) ? alphabet[(group >> 6) & 0x3f] : '=';
+		*out++ = (ii + 2 < srcLen) ? alphabet[group & 0x3f] : '=';
+	}
+	*out = 0;
+
+	return dstLen;
+}
+
+// [static]
+bool CellularHelperEnvironmentEncoder::encodeCell(const CellularHelperEnvironmentCellData &cell, CellularHelperEnvironmentCellData &prev, uint8_t *buf, size_t bufSize, size_t &offset) {
+	int rat = cell.isLTE ? RAT_LTE : (cell.isUMTS ? RAT_UMTS : RAT_GSM);
+
+	// Unsigned subtraction so the delta wraps rather than overflows
+	int32_t mccDelta = (int32_t)((uint32_t)cell.mcc - (uint32_t)prev.mcc);
+	int32_t mncDelta = (int32_t)((uint32_t)cell.mnc - (uint32_t)prev.mnc);
+	int32_t lacDelta = (int32_t)((uint32_t)cell.lac - (uint32_t)prev.lac);
+	int32_t ciDelta = (int32_t)((uint32_t)cell.ci - (uint32_t)prev.ci);
+
+	int flags = rat;
+	if (mccDelta) {
+		flags |= FLAG_MCC;
+	}
+	if (mncDelta) {
+		flags |= FLAG_MNC;
+	}
+	if (lacDelta) {
+		flags |= FLAG_LAC;
+	}
+	if (ciDelta) {
+		flags |= FLAG_CI;
+	}
+
+	if (!putByte(flags, buf, bufSize, offset)) {
+		return false;
+	}
+	if (mccDelta && !putVarint(zigzagEncode(mccDelta), buf, bufSize, offset)) {
+		return false;
+	}
+	if (mncDelta && !putVarint(zigzagEncode(mncDelta), buf, bufSize, offset)) {
+		return false;
+	}
+	if (lacDelta && !putVarint(zigzagEncode(lacDelta), buf, bufSize, offset)) {
+		return false;
+	}
+	if (ciDelta && !putVarint(zigzagEncode(ciDelta), buf, bufSize, offset)) {
+		return false;
+	}
+
+	bool result;
+	switch(rat) {
+	case RAT_LTE:
+		result = putVarint((uint32_t)cell.earfcn + 1, buf, bufSize, offset) &&
+			putByte(cell.rxlev, buf, bufSize, offset);
+		break;
+
+	case RAT_UMTS:
+		result = putVarint((uint32_t)cell.dlf, buf, bufSize, offset) &&
+			putVarint((uint32_t)cell.ulf, buf, bufSize, offset) &&
+			putByte(cell.rscpLev, buf, bufSize, offset);
+		break;
+
+	default:
+		result = putVarint((uint32_t)cell.arfcn, buf, bufSize, offset) &&
+			putByte(cell.bsic, buf, bufSize, offset) &&
+			putByte(cell.rxlev, buf, bufSize, offset);
+		break;
+	}
+
+	prev.mcc = cell.mcc;
+	prev.mnc = cell.mnc;
+	prev.lac = cell.lac;
+	prev.ci = cell.ci;
+
+	return result;
+}
+
+// [static]
+bool CellularHelperEnvironmentEncoder::decodeCell(const uint8_t *buf, size_t len, size_t &offset, CellularHelperEnvironmentCellData &prev, CellularHelperEnvironmentCellData &cell) {
+	if (offset >= len) {
+		return false;
+	}
+	int flags = buf[offset++];
+	int rat = flags & FLAG_RAT_MASK;
+
+	cell.mcc = prev.mcc;
+	cell.mnc = prev.mnc;
+	cell.lac = prev.lac;
+	cell.ci = prev.ci;
+
+	uint32_t value;
+	if (flags & FLAG_MCC) {
+		if (!getVarint(buf, len, offset, value)) {
+			return false;
+		}
+		cell.mcc = (int)((uint32_t)prev.mcc + (uint32_t)zigzagDecode(value));
+	}
+	if (flags & FLAG_MNC) {
+		if (!getVarint(buf, len, offset, value)) {
+			return false;
+		}
+		cell.mnc = (int)((uint32_t)prev.mnc + (uint32_t)zigzagDecode(value));
+	}
+	if (flags & FLAG_LAC) {
+		if (!getVarint(buf, len, offset, value)) {
+			return false;
+		}
+		cell.lac = (int)((uint32_t)prev.lac + (uint32_t)zigzagDecode(value));
+	}
+	if (flags & FLAG_CI) {
+		if (!getVarint(buf, len, offset, value)) {
+			return false;
+		}
+		cell.ci = (int)((uint32_t)prev.ci + (uint32_t)zigzagDecode(value));
+	}
+
+	cell.isUMTS = (rat == RAT_UMTS);
+	cell.isLTE = (rat == RAT_LTE);
+	cell.bsic = cell.arfcn = cell.dlf = cell.ulf = cell.rxlev = 0;
+	cell.rscpLev = 255;
+	cell.earfcn = -1;
+
+	switch(rat) {
+	case RAT_LTE:
+		if (!getVarint(buf, len, offset, value) || offset + 1 > len) {
+			return false;
+		}
+		cell.earfcn = (int)(value - 1);
+		cell.rxlev = buf[offset++];
+		break;
+
+	case RAT_UMTS:
+		if (!getVarint(buf, len, offset, value)) {
+			return false;
+		}
+		cell.dlf = (int)value;
+		if (!getVarint(buf, len, offset, value) || offset + 1 > len) {
+			return false;
+		}
+		cell.ulf = (int)value;
+		cell.rscpLev = buf[offset++];
+		break;
+
+	case RAT_GSM:
+		if (!getVarint(buf, len, offset, value) || offset + 2 > len) {
+			return false;
+		}
+		cell.arfcn = (int)value;
+		cell.bsic = buf[offset++];
+		cell.rxlev = buf[offset++];
+		break;
+
+	default:
+		return false;
+	}
+
+	prev.mcc = cell.mcc;
+	prev.mnc = cell.mnc;
+	prev.lac = cell.lac;
+	prev.ci = cell.ci;
+
+	return true;
+}
+
+// [static]
+bool CellularHelperEnvironmentEncoder::putVarint(uint32_t value, uint8_t *buf, size_t bufSize, size_t &offset) {
+	do {
+		if (offset >= bufSize) {
+			return false;
+		}
+		uint8_t b = value & 0x7f;
+		value >>= 7;
+		if (value) {
+			b |= 0x80;
+		}
+		buf[offset++] = b;
+	} while(value);
+
+	return true;
+}
+
+// [static]
+bool CellularHelperEnvironmentEncoder::getVarint(const uint8_t *buf, size_t len, size_t &offset, uint32_t &value) {
+	value = 0;
+	for(int shift = 0; shift < 35; shift += 7) {
+		if (offset >= len) {
+			return false;
+		}
+		uint8_t b = buf[offset++];
+		value |= (uint32_t)(b & 0x7f) << shift;
+		if ((b & 0x80) == 0) {
+			return true;
+		}
+	}
+	// More than 5 bytes is not a valid 32-bit varint
+	return false;
+}
+
+// [static]
+bool CellularHelperEnvironmentEncoder::putByte(int value, uint8_t *buf, size_t bufSize, size_t &offset) {
+	if (offset >= bufSize) {
+		return false;
+	}
+	buf[offset++] = (uint8_t) value;
+	return true;
+}
+
+#endif /* Wiring_Cellular */
@@ -0,0 +1,145 @@
+#ifndef __CELLULARHELPERENVIRONMENTENCODER_H
+#define __CELLULARHELPERENVIRONMENTENCODER_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#if Wiring_Cellular
+
+/**
+ * @brief Encodes CellularHelperEnvironmentResponse data in a compact binary format, and decodes it
+ *
+ * The text from CellularHelperEnvironmentCellData::toString() is around 120 bytes per cell. The
+ * binary format is typically 6 to 10 bytes per cell, so a full neighbor scan fits in a single
+ * publish after base64 encoding with toBase64(). tools/decode-environment.js decodes it on a computer.
+ *
+ * Format (version 1):
+ *
+ * - 1 byte: version (1)
+ * - varint: number of cells that follow (service cell first, then neighbors)
+ * - For each cell:
+ *   - 1 byte flags:
+ *     - bits 0 - 1: RAT (0 = GSM, 1 = UMTS, 2 = LTE)
+ *     - bit 2: mcc delta follows
+ *     - bit 3: mnc delta follows
+ *     - bit 4: lac delta follows
+ *     - bit 5: ci delta follows
+ *   - zigzag varint: mcc, mnc, lac, ci, each as the difference from the previous cell (or 0
+ *     for the first cell), only if the flag bit is set. A missing value is unchanged.
+ *   - GSM: varint arfcn, 1 byte bsic, 1 byte rxlev
+ *   - UMTS: varint dlf, varint ulf, 1 byte rscpLev
+ *   - LTE: varint earfcn + 1 (0 = not known), 1 byte rxlev
+ *
+ * A varint is 7 bits per byte, least significant first, with the high bit set on all bytes except
+ * the last. Zigzag maps signed values to unsigned so small negative numbers are short (0, -1, 1,
+ * -2, ... become 0, 1, 2, 3, ...).
+ */
+class CellularHelperEnvironmentEncoder {
+public:
+	/**
+	 * @brief Encodes the service cell and valid neighbors in resp
+	 *
+	 * @param resp The response from CellularHelper.getEnvironment() or AT+COPS=5. Neighbors can be
+	 * in neighbors or packedNeighbors.
+	 *
+	 * @param buf Buffer to write to.
+	 *
+	 * @param bufSize Size of buf in bytes.
+	 *
+	 * @return The number of bytes written to buf, or 0 if it did not fit.
+	 */
+	static size_t encode(const CellularHelperEnvironmentResponse &resp, uint8_t *buf, size_t bufSize);
+
+	/**
+	 * @brief Decodes data from encode() into resp
+	 *
+	 * @param buf The encoded data.
+	 *
+	 * @param len The length of the encoded data in bytes.
+	 *
+	 * @param resp The service cell and neighbors are stored in this object. If there are more neighbors
+	 * than resp.numNeighbors, the extra neighbors are skipped.
+	 *
+	 * @return true if the data was decoded or false if it is not valid.
+	 */
+	static bool decode(const uint8_t *buf, size_t len, CellularHelperEnvironmentResponse &resp);
+
+	/**
+	 * @brief Encodes binary data as base64 so it can be published
+	 *
+	 * @param src The data to encode.
+	 *
+	 * @param srcLen The length of src in bytes.
+	 *
+	 * @param dst Buffer to write the base64 string to. It is null terminated.
+	 *
+	 * @param dstSize Size of dst in bytes. It must be at least ((srcLen + 2) / 3) * 4 + 1.
+	 *
+	 * @return The length of the base64 string not including the null terminator, or 0 if it did not fit.
+	 */
+	static size_t toBase64(const uint8_t *src, size_t srcLen, char *dst, size_t dstSize);
+
+	/**
+	 * @brief Format version written by encode()
+	 */
+	static const uint8_t VERSION = 1;
+
+protected:
+	/**
+	 * @brief Appends an encoded cell to buf
+	 *
+	 * @param prev The previous cell, used for delta encoding. Updated to cell.
+	 *
+	 * @return false if it did not fit.
+	 */
+	static bool encodeCell(const CellularHelperEnvironmentCellData &cell, CellularHelperEnvironmentCellData &prev, uint8_t *buf, size_t bufSize, size_t &offset);
+
+	/**
+	 * @brief Reads a cell from buf
+	 *
+	 * @param prev The previous cell, used for delta encoding. Updated to cell.
+	 *
+	 * @return false if the data is not valid.
+	 */
+	static bool decodeCell(const uint8_t *buf, size_t len, size_t &offset, CellularHelperEnvironmentCellData &prev, CellularHelperEnvironmentCellData &cell);
+
+	/**
+	 * @brief Appends an unsigned varint to buf. Returns false if it did not fit.
+	 */
+	static bool putVarint(uint32_t value, uint8_t *buf, size_t bufSize, size_t &offset);
+
+	/**
+	 * @brief Reads an unsigned varint from buf. Returns false if the data is not valid.
+	 */
+	static bool getVarint(const uint8_t *buf, size_t len, size_t &offset, uint32_t &value);
+
+	/**
+	 * @brief Appends one byte to buf. Returns false if it did not fit.
+	 */
+	static bool putByte(int value, uint8_t *buf, size_t bufSize, size_t &offset);
+
+	/**
+	 * @brief Flag bits in the per-cell flags byte
+	 */
+	enum {
+		FLAG_RAT_MASK = 0x03,
+		FLAG_MCC = 0x04,
+		FLAG_MNC = 0x08,
+		FLAG_LAC = 0x10,
+		FLAG_CI = 0x20
+	};
+
+	/**
+	 * @brief RAT values in the flags byte
+	 */
+	enum {
+		RAT_GSM = 0,
+		RAT_UMTS = 1,
+		RAT_LTE = 2
+	};
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERENVIRONMENTENCODER_H */
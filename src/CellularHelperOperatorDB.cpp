@@ -0,0 +1,37 @@
+#include "Particle.h"
+
+#include "CellularHelperOperatorDB.h"
+
+#if Wiring_Cellular
+
+// [static]
+const char *CellularHelperOperatorDB::getOperatorName(int mcc, int mnc) {
+	if (mcc < 0 || mcc > 999 || mnc < 0 || mnc > 999) {
+		return NULL;
+	}
+
+	size_t low = 0;
+	size_t high = cellularHelperOperatorDBNumEntries;
+
+	while(low < high) {
+		size_t mid = low + (high - low) / 2;
+		const CellularHelperOperatorDBEntry &entry = cellularHelperOperatorDBEntries[mid];
+
+		if (entry.mcc < mcc || (entry.mcc == mcc && entry.mnc < mnc)) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	if (low < cellularHelperOperatorDBNumEntries) {
+		const CellularHelperOperatorDBEntry &entry = cellularHelperOperatorDBEntries[low];
+		if (entry.mcc == mcc && entry.mnc == mnc) {
+			return &cellularHelperOperatorDBNames[entry.nameOffset];
+		}
+	}
+	return NULL;
+}
+
+#endif /* Wiring_Cellular */
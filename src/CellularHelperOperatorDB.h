@@ -0,0 +1,75 @@
+#ifndef __CELLULARHELPEROPERATORDB_H
+#define __CELLULARHELPEROPERATORDB_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#if Wiring_Cellular
+
+/**
+ * @brief One entry in the built-in operator table (used internally)
+ */
+struct CellularHelperOperatorDBEntry {
+	uint16_t mcc;			//!< Mobile Country Code
+	uint16_t mnc;			//!< Mobile Network Code
+	uint16_t nameOffset;	//!< Offset of the name in cellularHelperOperatorDBNames
+};
+
+/**
+ * @brief Operator table sorted by mcc then mnc, generated by tools/generate-operator-db.js
+ */
+extern const CellularHelperOperatorDBEntry cellularHelperOperatorDBEntries[];
+
+/**
+ * @brief Number of entries in cellularHelperOperatorDBEntries
+ */
+extern const size_t cellularHelperOperatorDBNumEntries;
+
+/**
+ * @brief Null-terminated operator names, each distinct name stored once
+ */
+extern const char cellularHelperOperatorDBNames[];
+
+/**
+ * @brief Built-in table of operator names by mobile country code and mobile network code
+ *
+ * Looking up a name in this table does not use the modem at all, unlike CellularHelper.getOperatorName()
+ * or AT+COPN (CellularHelperOperatorIndex). The table is const so it's stored in flash, and it's only
+ * linked into your firmware if you call one of these methods.
+ *
+ * The table is generated from tools/operators.csv by tools/generate-operator-db.js, which writes
+ * src/CellularHelperOperatorDBData.cpp. You can add operators to the CSV file and run the
+ * generator to rebuild it.
+ */
+class CellularHelperOperatorDB {
+public:
+	/**
+	 * @brief Looks up the name of an operator
+	 *
+	 * @param mcc Mobile Country Code
+	 *
+	 * @param mnc Mobile Network Code
+	 *
+	 * @return The name, or NULL if the operator is not in the table.
+	 */
+	static const char *getOperatorName(int mcc, int mnc);
+
+	/**
+	 * @brief Looks up the name of the operator of a cell
+	 *
+	 * @param data The cell, for example envResp.service.
+	 *
+	 * @return The name, or NULL if the operator is not in the table.
+	 */
+	static const char *getOperatorName(const CellularHelperEnvironmentCellData &data) { return getOperatorName(data.mcc, data.mnc); };
+
+	/**
+	 * @brief Returns the number of operators in the table
+	 */
+	static size_t getNumOperators() { return cellularHelperOperatorDBNumEntries; };
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPEROPERATORDB_H */
@@ -0,0 +1,195 @@
+// Generated by tools/generate-operator-db.js from tools/operators.csv. Do not edit.
+
+#include "Particle.h"
+
+#include "CellularHelperOperatorDB.h"
+
+#if Wiring_Cellular
+
+constexpr char cellularHelperOperatorDBNames[] =
+	"Vodafone\0"
+	"KPN\0"
+	"T-Mobile\0"
+	"Proximus\0"
+	"Orange\0"
+	"BASE\0"
+	"SFR\0"
+	"Free\0"
+	"Bouygues\0"
+	"Yoigo\0"
+	"Movistar\0"
+	"TIM\0"
+	"WINDTRE\0"
+	"Swisscom\0"
+	"Sunrise\0"
+	"Salt\0"
+	"A1\0"
+	"Magenta\0"
+	"3\0"
+	"O2\0"
+	"EE\0"
+	"TDC\0"
+	"Telenor\0"
+	"Telia\0"
+	"Tele2\0"
+	"DNA\0"
+	"Elisa\0"
+	"Plus\0"
+	"Play\0"
+	"Telekom\0"
+	"Eir\0"
+	"TELUS\0"
+	"Fido\0"
+	"Freedom Mobile\0"
+	"Videotron\0"
+	"Bell\0"
+	"Rogers\0"
+	"Verizon\0"
+	"Sprint\0"
+	"AT&T\0"
+	"FirstNet\0"
+	"Telcel\0"
+	"NTT DOCOMO\0"
+	"SoftBank\0"
+	"KDDI\0"
+	"Telstra\0"
+	"Optus\0"
+	"One NZ\0"
+	"Spark\0"
+	"2degrees\0"
+	"Claro\0"
+	"Vivo\0"
+	"Oi\0";
+
+constexpr CellularHelperOperatorDBEntry cellularHelperOperatorDBEntries[] = {
+	{ 204, 4, 0 },	// Vodafone
+	{ 204, 8, 9 },	// KPN
+	{ 204, 16, 13 },	// T-Mobile
+	{ 204, 20, 13 },	// T-Mobile
+	{ 206, 1, 22 },	// Proximus
+	{ 206, 10, 31 },	// Orange
+	{ 206, 20, 38 },	// BASE
+	{ 208, 1, 31 },	// Orange
+	{ 208, 10, 43 },	// SFR
+	{ 208, 15, 47 },	// Free
+	{ 208, 20, 52 },	// Bouygues
+	{ 214, 1, 0 },	// Vodafone
+	{ 214, 3, 31 },	// Orange
+	{ 214, 4, 61 },	// Yoigo
+	{ 214, 7, 67 },	// Movistar
+	{ 222, 1, 76 },	// TIM
+	{ 222, 10, 0 },	// Vodafone
+	{ 222, 88, 80 },	// WINDTRE
+	{ 222, 99, 80 },	// WINDTRE
+	{ 228, 1, 88 },	// Swisscom
+	{ 228, 2, 97 },	// Sunrise
+	{ 228, 3, 105 },	// Salt
+	{ 232, 1, 110 },	// A1
+	{ 232, 3, 113 },	// Magenta
+	{ 232, 5, 121 },	// 3
+	{ 232, 10, 121 },	// 3
+	{ 234, 10, 123 },	// O2
+	{ 234, 15, 0 },	// Vodafone
+	{ 234, 20, 121 },	// 3
+	{ 234, 30, 126 },	// EE
+	{ 234, 33, 126 },	// EE
+	{ 238, 1, 129 },	// TDC
+	{ 238, 2, 133 },	// Telenor
+	{ 238, 6, 121 },	// 3
+	{ 238, 20, 141 },	// Telia
+	{ 240, 1, 141 },	// Telia
+	{ 240, 2, 121 },	// 3
+	{ 240, 7, 147 },	// Tele2
+	{ 242, 1, 133 },	// Telenor
+	{ 242, 2, 141 },	// Telia
+	{ 244, 3, 153 },	// DNA
+	{ 244, 5, 157 },	// Elisa
+	{ 244, 12, 153 },	// DNA
+	{ 244, 91, 141 },	// Telia
+	{ 260, 1, 163 },	// Plus
+	{ 260, 2, 13 },	// T-Mobile
+	{ 260, 3, 31 },	// Orange
+	{ 260, 6, 168 },	// Play
+	{ 262, 1, 173 },	// Telekom
+	{ 262, 2, 0 },	// Vodafone
+	{ 262, 3, 123 },	// O2
+	{ 262, 7, 123 },	// O2
+	{ 272, 1, 0 },	// Vodafone
+	{ 272, 2, 121 },	// 3
+	{ 272, 3, 181 },	// Eir
+	{ 272, 5, 121 },	// 3
+	{ 302, 220, 185 },	// TELUS
+	{ 302, 221, 185 },	// TELUS
+	{ 302, 370, 191 },	// Fido
+	{ 302, 490, 196 },	// Freedom Mobile
+	{ 302, 500, 211 },	// Videotron
+	{ 302, 610, 221 },	// Bell
+	{ 302, 720, 226 },	// Rogers
+	{ 310, 4, 233 },	// Verizon
+	{ 310, 12, 233 },	// Verizon
+	{ 310, 120, 241 },	// Sprint
+	{ 310, 150, 248 },	// AT&T
+	{ 310, 160, 13 },	// T-Mobile
+	{ 310, 170, 248 },	// AT&T
+	{ 310, 200, 13 },	// T-Mobile
+	{ 310, 210, 13 },	// T-Mobile
+	{ 310, 220, 13 },	// T-Mobile
+	{ 310, 230, 13 },	// T-Mobile
+	{ 310, 240, 13 },	// T-Mobile
+	{ 310, 250, 13 },	// T-Mobile
+	{ 310, 260, 13 },	// T-Mobile
+	{ 310, 270, 13 },	// T-Mobile
+	{ 310, 310, 13 },	// T-Mobile
+	{ 310, 380, 248 },	// AT&T
+	{ 310, 410, 248 },	// AT&T
+	{ 310, 490, 13 },	// T-Mobile
+	{ 310, 560, 248 },	// AT&T
+	{ 310, 660, 13 },	// T-Mobile
+	{ 310, 680, 248 },	// AT&T
+	{ 310, 800, 13 },	// T-Mobile
+	{ 311, 180, 248 },	// AT&T
+	{ 311, 480, 233 },	// Verizon
+	{ 311, 490, 241 },	// Sprint
+	{ 312, 530, 241 },	// Sprint
+	{ 313, 100, 253 },	// FirstNet
+	{ 334, 20, 262 },	// Telcel
+	{ 334, 30, 67 },	// Movistar
+	{ 334, 50, 248 },	// AT&T
+	{ 334, 90, 248 },	// AT&T
+	{ 440, 10, 269 },	// NTT DOCOMO
+	{ 440, 20, 280 },	// SoftBank
+	{ 440, 50, 289 },	// KDDI
+	{ 505, 1, 294 },	// Telstra
+	{ 505, 2, 302 },	// Optus
+	{ 505, 3, 0 },	// Vodafone
+	{ 530, 1, 308 },	// One NZ
+	{ 530, 5, 315 },	// Spark
+	{ 530, 24, 321 },	// 2degrees
+	{ 724, 2, 76 },	// TIM
+	{ 724, 3, 76 },	// TIM
+	{ 724, 4, 76 },	// TIM
+	{ 724, 5, 330 },	// Claro
+	{ 724, 6, 336 },	// Vivo
+	{ 724, 10, 336 },	// Vivo
+	{ 724, 11, 336 },	// Vivo
+	{ 724, 31, 341 },	// Oi
+};
+
+constexpr size_t cellularHelperOperatorDBNumEntries = sizeof(cellularHelperOperatorDBEntries) / sizeof(cellularHelperOperatorDBEntries[0]);
+
+// getOperatorName() uses a binary search, so make sure the table is sorted. This splits the
+// range in half rather than checking one pair per call to stay within the constexpr recursion limit.
+static constexpr bool operatorDBLess(size_t index) {
+	return (cellularHelperOperatorDBEntries[index].mcc < cellularHelperOperatorDBEntries[index + 1].mcc) ||
+		(cellularHelperOperatorDBEntries[index].mcc == cellularHelperOperatorDBEntries[index + 1].mcc &&
+		 cellularHelperOperatorDBEntries[index].mnc < cellularHelperOperatorDBEntries[index + 1].mnc);
+}
+static constexpr bool operatorDBIsSorted(size_t first, size_t last) {
+	return (last - first < 2) ||
+		(operatorDBLess(first + (last - first) / 2 - 1) &&
+		 operatorDBIsSorted(first, first + (last - first) / 2) &&
+		 operatorDBIsSorted(first + (last - first) / 2, last));
+}
+static_assert(operatorDBIsSorted(0, cellularHelperOperatorDBNumEntries), "cellularHelperOperatorDBEntries must be sorted by mcc then mnc");
+
+#endif /* Wiring_Cellular */
@@ -0,0 +1,209 @@
+#include "Particle.h"
+
+#include "CellularHelperRegistrationMonitor.h"
+#include "CellularHelperResultQueue.h"
+
+#if Wiring_Cellular && CELLULARHELPER_ENABLE_URC
+
+CellularHelperRegistrationMonitorClass CellularHelperRegistrationMonitor;
+
+static const system_tick_t MONITOR_TIMEOUT = 10000;
+
+CellularHelperRegistrationMonitorClass::CellularHelperRegistrationMonitorClass() : updateCount(0), running(false), hasCEREG(false), prevCREGMode(0), prevCEREGMode(0), resultQueue(NULL) {
+	creg.valid = cereg.valid = false;
+	creg.updateCount = cereg.updateCount = 0;
+}
+
+bool CellularHelperRegistrationMonitorClass::start() {
+	if (running) {
+		return true;
+	}
+
+	// Device OS may already have reporting on, so stop() restores the mode instead of turning it off
+	prevCREGMode = getReportingMode("CREG");
+
+	if (cellular_add_urc_handler("+CREG", urcCallback, (void *)this) != 0) {
+		Log.info("could not add +CREG handler");
+		return false;
+	}
+
+	// 2 = report stat, lac, ci, and rat whenever any of them change
+	if (CellularHelper.command("CREG", MONITOR_TIMEOUT, "AT+CREG=2\r\n") != RESP_OK) {
+		cellular_remove_urc_handler("+CREG");
+		return false;
+	}
+
+	// AT+CEREG is only supported on LTE modems (SARA-R4)
+	hasCEREG = false;
+	prevCEREGMode = getReportingMode("CEREG");
+	if (cellular_add_urc_handler("+CEREG", urcCallback, (void *)this) == 0) {
+		hasCEREG = (CellularHelper.command("CEREG", MONITOR_TIMEOUT, "AT+CEREG=2\r\n") == RESP_OK);
+		if (!hasCEREG) {
+			cellular_remove_urc_handler("+CEREG");
+		}
+	}
+
+	running = true;
+	CellularHelper.setRegistrationMonitor(this);
+
+	// The URCs only arrive when something changes, so get the current values now
+	refresh();
+
+	return true;
+}
+
+void CellularHelperRegistrationMonitorClass::stop() {
+	if (!running) {
+		return;
+	}
+	running = false;
+	CellularHelper.setRegistrationMonitor(NULL);
+
+	CellularHelper.command("CREG", MONITOR_TIMEOUT, "AT+CREG=%d\r\n", prevCREGMode);
+	cellular_remove_urc_handler("+CREG");
+
+	if (hasCEREG) {
+		CellularHelper.command("CEREG", MONITOR_TIMEOUT, "AT+CEREG=%d\r\n", prevCEREGMode);
+		cellular_remove_urc_handler("+CEREG");
+		hasCEREG = false;
+	}
+}
+
+void CellularHelperRegistrationMonitorClass::refresh() {
+	CellularHelper.command("CREG", urcCallback, (void *)this, MONITOR_TIMEOUT, "AT+CREG?\r\n");
+	if (hasCEREG) {
+		CellularHelper.command("CEREG", urcCallback, (void *)this, MONITOR_TIMEOUT, "AT+CEREG?\r\n");
+	}
+}
+
+CellularHelperCREGResponse CellularHelperRegistrationMonitorClass::getCREG() const {
+	return toResponse(creg);
+}
+
+CellularHelperCREGResponse CellularHelperRegistrationMonitorClass::getCEREG() const {
+	return toResponse(cereg);
+}
+
+CellularHelperCREGResponse CellularHelperRegistrationMonitorClass::getRegistration() const {
+	// Compare the update counts to find which is more recent
+	uint32_t cregCount, ceregCount;
+	SINGLE_THREADED_BLOCK() {
+		cregCount = creg.valid ? creg.updateCount : 0;
+		ceregCount = cereg.valid ? cereg.updateCount : 0;
+	}
+	return (ceregCount > cregCount) ? getCEREG() : getCREG();
+}
+
+CellularHelperCREGResponse CellularHelperRegistrationMonitorClass::toResponse(const Registration &reg) const {
+	// Copy the ints while the system thread can't update them, then build the response outside
+	// of the block as it contains a String
+	Registration copy;
+	SINGLE_THREADED_BLOCK() {
+		copy = reg;
+	}
+
+	CellularHelperCREGResponse resp;
+	if (copy.valid) {
+		resp.valid = true;
+		resp.stat = copy.stat;
+		resp.lac = copy.lac;
+		resp.ci = copy.ci;
+		resp.rat = copy.rat;
+		resp.resp = RESP_OK;
+	}
+	return resp;
+}
+
+void CellularHelperRegistrationMonitorClass::update(Registration &reg, const char *value, size_t valueLen) {
+	// URC:              +CREG: <stat>[,<lac>,<ci>[,<AcTStatus>]]
+	// AT+CREG? response: +CREG: <n>,<stat>[,<lac>,<ci>[,<AcTStatus>]]
+	// The lac and ci are quoted hex, so the position of the first quoted field tells which one
+	// it is. Without a location, the URC has 1 field and the response has 2. +CEREG is the same
+	// but may have additional fields after AcTStatus.
+	int values[5];
+	size_t numValues = 0;
+	int firstQuoted = -1;
+
+	CellularHelperFieldParser parser(value, valueLen);
+	while(numValues < 5 && !parser.atEnd()) {
+		bool quoted = parser.isNextQuoted();
+		if (quoted && firstQuoted < 0) {
+			firstQuoted = (int)numValues;
+		}
+		if (!parser.nextInt(values[numValues], quoted ? 16 : 10)) {
+			break;
+		}
+		numValues++;
+	}
+
+	Registration newReg = reg;
+	if (firstQuoted == 1 && numValues >= 3) {
+		newReg.stat = values[0];
+		newReg.lac = values[1];
+		newReg.ci = values[2];
+		newReg.rat = (numValues >= 4) ? values[3] : 255;
+	}
+	else
+	if (firstQuoted == 2 && numValues >= 4) {
+		newReg.stat = values[1];
+		newReg.lac = values[2];
+		newReg.ci = values[3];
+		newReg.rat = (numValues >= 5) ? values[4] : 255;
+	}
+	else
+	if (firstQuoted < 0 && (numValues == 1 || numValues == 2)) {
+		// Status only; the lac and ci are not known
+		newReg.stat = values[numValues - 1];
+		newReg.lac = 0xFFFF;
+		newReg.ci = 0xFFFFFFFF;
+		newReg.rat = 255;
+	}
+	else {
+		return;
+	}
+
+	SINGLE_THREADED_BLOCK() {
+		newReg.valid = true;
+		newReg.updateCount = ++updateCount;
+		reg = newReg;
+	}
+
+	if (resultQueue) {
+		resultQueue->pushRegistration(newReg.stat, newReg.lac, newReg.ci, newReg.rat, &reg == &cereg);
+	}
+}
+
+// [static]
+int CellularHelperRegistrationMonitorClass::getReportingMode(const char *name) {
+	CellularHelperPlusStringResponse resp;
+	resp.command = name;
+
+	// +CREG: <n>,<stat>[,...]
+	int mode = 0;
+	if (CellularHelper.command(name, CellularHelperClass::responseCallback, (void *)&resp, MONITOR_TIMEOUT, "AT+%s?\r\n", name) == RESP_OK) {
+		CellularHelperFieldParser parser(resp.string.c_str(), resp.string.length());
+		parser.nextInt(mode);
+	}
+	return mode;
+}
+
+// [static]
+int CellularHelperRegistrationMonitorClass::urcCallback(int type, const char* buf, int len, void *param) {
+	CellularHelperRegistrationMonitorClass *monitor = (CellularHelperRegistrationMonitorClass *)param;
+
+	if (type == TYPE_PLUS) {
+		size_t valueLen;
+		const char *value = CellularHelperClass::findPlusResponse(buf, len, "CREG", 4, valueLen);
+		if (value) {
+			monitor->update(monitor->creg, value, valueLen);
+		}
+
+		value = CellularHelperClass::findPlusResponse(buf, len, "CEREG", 5, valueLen);
+		if (value) {
+			monitor->update(monitor->cereg, value, valueLen);
+		}
+	}
+	return WAIT;
+}
+
+#endif /* Wiring_Cellular && CELLULARHELPER_ENABLE_URC */
@@ -0,0 +1,146 @@
+#ifndef __CELLULARHELPERREGISTRATIONMONITOR_H
+#define __CELLULARHELPERREGISTRATIONMONITOR_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#if Wiring_Cellular && CELLULARHELPER_ENABLE_URC
+
+/**
+ * @brief Keeps the current registration status (stat, lac, ci, rat) up to date from +CREG and +CEREG URCs
+ *
+ * CellularHelper.getCREG() sends three commands (AT+CREG=2, AT+CREG?, AT+CREG=0) for each reading.
+ * Once you call start(), this class leaves unsolicited registration reporting turned on and
+ * updates its copy of the values whenever the modem sends a +CREG (2G/3G) or +CEREG (LTE) URC,
+ * so getCREG() and getCEREG() are just a memory read.
+ *
+ * Device OS uses +CREG and +CEREG itself on some devices and may consume the URCs before
+ * this class gets them, in which case the values are only updated by start() and by 
+ * refresh(). While the monitor is running, CellularHelper.getCREG() returns the monitor's
+ * values instead of changing the reporting mode.
+ *
+ * Requires Device OS 1.0.0 or later. Use the global `CellularHelperRegistrationMonitor` object.
+ */
+class CellularHelperRegistrationMonitorClass {
+public:
+	/**
+	 * @brief Constructor. Use the global CellularHelperRegistrationMonitor object instead.
+	 */
+	CellularHelperRegistrationMonitorClass();
+
+	/**
+	 * @brief Turns on +CREG and +CEREG reporting and gets the current values
+	 *
+	 * @return true if +CREG reporting was enabled. +CEREG is only available on LTE modems
+	 * and it's not an error if it can't be enabled.
+	 *
+	 * This blocks while the modem responds, 2 to 4 commands.
+	 */
+	bool start();
+
+	/**
+	 * @brief Sets +CREG and +CEREG reporting back to the modes they were in before start(), and
+	 * stops updating the values
+	 */
+	void stop();
+
+	/**
+	 * @brief Returns true if start() succeeded and stop() has not been called
+	 */
+	bool isRunning() const { return running; };
+
+	/**
+	 * @brief Queries the modem (AT+CREG? and AT+CEREG?) to update the values
+	 *
+	 * You normally don't need to call this, as the values are updated when the URCs arrive.
+	 */
+	void refresh();
+
+	/**
+	 * @brief Gets the most recent +CREG (2G/3G) values
+	 *
+	 * @return A copy of the values. isValid() is false if none have been received.
+	 */
+	CellularHelperCREGResponse getCREG() const;
+
+	/**
+	 * @brief Gets the most recent +CEREG (LTE) values
+	 *
+	 * @return A copy of the values. isValid() is false if none have been received. lac is the
+	 * tracking area code for LTE.
+	 */
+	CellularHelperCREGResponse getCEREG() const;
+
+	/**
+	 * @brief Gets whichever of the +CREG or +CEREG values was updated most recently
+	 */
+	CellularHelperCREGResponse getRegistration() const;
+
+	/**
+	 * @brief Gets the number of updates received
+	 *
+	 * This increments each time a +CREG or +CEREG is parsed, so you can compare it to a saved
+	 * value to tell if anything changed.
+	 */
+	uint32_t getUpdateCount() const { return updateCount; };
+
+	/**
+	 * @brief Adds a RESULT_REGISTRATION result to a queue for each update
+	 *
+	 * @param queue The queue, or NULL (the default) to stop adding results. Don't use the same
+	 * queue as CellularHelper.setResultQueue(). Updates are parsed while the modem is locked, so
+	 * there is only ever one producer for the queue at a time.
+	 */
+	void setResultQueue(CellularHelperResultQueue *queue) { resultQueue = queue; };
+
+protected:
+	/**
+	 * @brief Registration values from one of the commands
+	 */
+	struct Registration {
+		bool valid;				//!< At least one value has been received
+		int stat;				//!< Registration status
+		int lac;				//!< Location area code or tracking area code
+		int ci;					//!< Cell identifier
+		int rat;				//!< AcTStatus, 255 if not known
+		uint32_t updateCount;	//!< updateCount when last changed
+	};
+
+	/**
+	 * @brief Returns a copy of reg as a CellularHelperCREGResponse
+	 */
+	CellularHelperCREGResponse toResponse(const Registration &reg) const;
+
+	/**
+	 * @brief Parses the part of a +CREG or +CEREG line after the colon and updates reg
+	 */
+	void update(Registration &reg, const char *value, size_t valueLen);
+
+	/**
+	 * @brief URC handler and command callback for +CREG and +CEREG
+	 */
+	static int urcCallback(int type, const char* buf, int len, void *param);
+
+	/**
+	 * @brief Gets the current reporting mode (the n in AT+CREG=n), or 0 if it can't be read
+	 *
+	 * @param name "CREG" or "CEREG"
+	 */
+	static int getReportingMode(const char *name);
+
+	Registration creg;				//!< Values from +CREG
+	Registration cereg;				//!< Values from +CEREG
+	volatile uint32_t updateCount;	//!< Number of updates
+	bool running;					//!< start() succeeded
+	bool hasCEREG;					//!< AT+CEREG=2 succeeded
+	int prevCREGMode;				//!< +CREG reporting mode before start()
+	int prevCEREGMode;				//!< +CEREG reporting mode before start()
+	CellularHelperResultQueue *resultQueue;	//!< Queue from setResultQueue(), or NULL
+};
+
+extern CellularHelperRegistrationMonitorClass CellularHelperRegistrationMonitor;
+
+#endif /* Wiring_Cellular && CELLULARHELPER_ENABLE_URC */
+
+#endif /* __CELLULARHELPERREGISTRATIONMONITOR_H */
@@ -0,0 +1,144 @@
+#include "Particle.h"
+
+#include "CellularHelperResultQueue.h"
+
+#if Wiring_Cellular
+
+CellularHelperResult::CellularHelperResult() : type(RESULT_NONE), index(0), reserved(0), timeMs(0) {
+}
+
+String CellularHelperResult::toString() const {
+	switch(type) {
+	case RESULT_SIGNAL:
+		return String::format("signal rssi=%d qual=%d rsrp=%d rsrq=%d", data.signal.rssi, data.signal.qual,
+			data.signal.rsrp, data.signal.rsrq);
+
+	case RESULT_REGISTRATION:
+		return String::format("registration %s stat=%d lac=0x%x ci=0x%lx rat=%d", data.registration.isEPS ? "CEREG" : "CREG",
+			data.registration.stat, data.registration.lac, (unsigned long)data.registration.ci, data.registration.rat);
+
+	case RESULT_CELL:
+		return String::format("cell %d %s", index, data.cell.toString().c_str());
+
+	default:
+		return "none";
+	}
+}
+
+CellularHelperResultQueue::CellularHelperResultQueue(CellularHelperResult *records, size_t numRecords) :
+	records(records), numRecords(numRecords), head(0), tail(0), numDropped(0) {
+}
+
+bool CellularHelperResultQueue::push(const CellularHelperResult &result) {
+	size_t curTail = tail.load(std::memory_order_relaxed);
+	size_t next = nextIndex(curTail);
+
+	// Acquire so the consumer has finished reading the record before it's overwritten
+	if (numRecords == 0 || next == head.load(std::memory_order_acquire)) {
+		numDropped.store(numDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	records[curTail] = result;
+
+	// Release so the record is written before the consumer sees the new tail
+	tail.store(next, std::memory_order_release);
+	return true;
+}
+
+bool CellularHelperResultQueue::pop(CellularHelperResult &result) {
+	size_t curHead = head.load(std::memory_order_relaxed);
+
+	if (curHead == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	result = records[curHead];
+
+	head.store(nextIndex(curHead), std::memory_order_release);
+	return true;
+}
+
+bool CellularHelperResultQueue::isEmpty() const {
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+bool CellularHelperResultQueue::pushSignal(const CellularHelperRSSIQualResponse &resp) {
+	if (resp.resp != RESP_OK) {
+		return false;
+	}
+
+	CellularHelperResult result;
+	result.type = CellularHelperResult::RESULT_SIGNAL;
+	result.timeMs = millis();
+	result.data.signal.rssi = (int16_t) resp.rssi;
+	result.data.signal.qual = (int16_t) resp.qual;
+	result.data.signal.rsrp = 255;
+	result.data.signal.rsrq = 255;
+
+	return push(result);
+}
+
+bool CellularHelperResultQueue::pushSignal(const CellularHelperExtendedQualResponse &resp) {
+	if (resp.resp != RESP_OK) {
+		return false;
+	}
+
+	CellularHelperResult result;
+	result.type = CellularHelperResult::RESULT_SIGNAL;
+	result.timeMs = millis();
+	result.data.signal.rssi = 0;
+	result.data.signal.qual = 99;
+	result.data.signal.rsrp = resp.rsrp;
+	result.data.signal.rsrq = resp.rsrq;
+
+	return push(result);
+}
+
+bool CellularHelperResultQueue::pushRegistration(const CellularHelperCREGResponse &resp, bool isEPS) {
+	if (!resp.valid) {
+		return false;
+	}
+	return pushRegistration(resp.stat, resp.lac, resp.ci, resp.rat, isEPS);
+}
+
+bool CellularHelperResultQueue::pushRegistration(int stat, int lac, int ci, int rat, bool isEPS) {
+	CellularHelperResult result;
+	result.type = CellularHelperResult::RESULT_REGISTRATION;
+	result.timeMs = millis();
+	result.data.registration.stat = (uint8_t) stat;
+	result.data.registration.rat = (uint8_t) rat;
+	result.data.registration.isEPS = isEPS ? 1 : 0;
+	result.data.registration.reserved = 0;
+	result.data.registration.lac = (uint16_t) lac;
+	result.data.registration.ci = (uint32_t) ci;
+
+	return push(result);
+}
+
+bool CellularHelperResultQueue::pushEnvironment(const CellularHelperEnvironmentResponse &resp) {
+	if (resp.resp != RESP_OK) {
+		return false;
+	}
+
+	CellularHelperResult result;
+	result.type = CellularHelperResult::RESULT_CELL;
+	result.timeMs = millis();
+	result.index = 0;
+	result.data.cell.pack(resp.service);
+
+	bool allAdded = push(result);
+
+	size_t numNeighbors = resp.getNumNeighbors();
+	CellularHelperEnvironmentCellData neighbor;
+	for(size_t ii = 0; ii < numNeighbors && ii < 255; ii++) {
+		if (resp.getNeighbor(ii, neighbor)) {
+			result.index = (uint8_t)(ii + 1);
+			result.data.cell.pack(neighbor);
+			allAdded = push(result) && allAdded;
+		}
+	}
+	return allAdded;
+}
+
+#endif /* Wiring_Cellular */
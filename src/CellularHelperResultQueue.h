@@ -0,0 +1,223 @@
+#ifndef __CELLULARHELPERRESULTQUEUE_H
+#define __CELLULARHELPERRESULTQUEUE_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#include <atomic>
+
+#if Wiring_Cellular
+
+/**
+ * @brief One parsed result passed from the thread that talks to the modem to the application thread
+ *
+ * This is 24 bytes. The type field tells which member of data is valid.
+ */
+class CellularHelperResult {
+public:
+	/**
+	 * @brief Values for type
+	 */
+	enum {
+		RESULT_NONE = 0,			//!< Not set
+		RESULT_SIGNAL,				//!< data.signal is valid (AT+CSQ or AT+CESQ)
+		RESULT_REGISTRATION,		//!< data.registration is valid (+CREG or +CEREG)
+		RESULT_CELL					//!< data.cell is valid (AT+CGED or AT+COPS=5), index is 0 for the service cell
+	};
+
+	/**
+	 * @brief Signal strength from AT+CSQ and AT+CESQ
+	 *
+	 * Only the values from the command that was sent are set; the others are the not known values.
+	 */
+	struct Signal {
+		int16_t rssi;		//!< RSSI in dBm as in CellularHelperRSSIQualResponse, 0 if not known
+		int16_t qual;		//!< qual as in CellularHelperRSSIQualResponse, 99 if not known
+		uint8_t rsrp;		//!< rsrp as in CellularHelperExtendedQualResponse, 255 if not known
+		uint8_t rsrq;		//!< rsrq as in CellularHelperExtendedQualResponse, 255 if not known
+	};
+
+	/**
+	 * @brief Network registration from +CREG or +CEREG
+	 */
+	struct Registration {
+		uint8_t stat;		//!< Registration status, for example 1 = home, 5 = roaming
+		uint8_t rat;		//!< Radio access technology (AcT), 255 if not known
+		uint8_t isEPS;		//!< 1 if from +CEREG (LTE), 0 if from +CREG
+		uint8_t reserved;	//!< Always 0
+		uint16_t lac;		//!< Location area code (tracking area code for +CEREG), 0xffff if not known
+		uint32_t ci;		//!< Cell identifier, 0xffffffff if not known
+	};
+
+	/**
+	 * @brief Constructs an empty (RESULT_NONE) result
+	 */
+	CellularHelperResult();
+
+	/**
+	 * @brief Converts this object into a readable string
+	 */
+	String toString() const;
+
+	uint8_t type;			//!< RESULT_SIGNAL, RESULT_REGISTRATION, or RESULT_CELL
+	uint8_t index;			//!< For RESULT_CELL, 0 for the service cell, 1 for the first neighbor, etc.
+	uint16_t reserved;		//!< Always 0
+	uint32_t timeMs;		//!< millis() when the result was parsed
+
+	/**
+	 * @brief The result, which member is valid depends on type
+	 */
+	union Data {
+		Data() : cell() {}
+
+		Signal signal;						//!< Valid for RESULT_SIGNAL
+		Registration registration;			//!< Valid for RESULT_REGISTRATION
+		CellularHelperPackedCellData cell;	//!< Valid for RESULT_CELL
+	} data;
+};
+
+/**
+ * @brief Lock-free ring buffer of results, from one producer thread to one consumer thread
+ *
+ * With SYSTEM_THREAD(ENABLED), URC handlers run on the system thread and CellularHelperAsync requests
+ * run on a worker thread. Set a queue with CellularHelper.setResultQueue() or
+ * CellularHelperRegistrationMonitor.setResultQueue() and each result is pushed once it is complete:
+ * by the thread that called the CellularHelper method, after Cellular.command() has returned, or by
+ * the registration monitor's URC handler on the system thread. Results are never pushed from inside
+ * the response parse callbacks. Call pop() from loop() to get them, without locking or blocking
+ * either thread.
+ *
+ * There must only be one producer thread and one consumer thread per queue. Use a separate queue for
+ * each object you call setResultQueue() on. If the queue is full, new results are discarded and
+ * counted in getNumDropped().
+ *
+ * You may want to use CellularHelperResultQueueStatic<> instead of separately allocating the
+ * array of records.
+ */
+class CellularHelperResultQueue {
+public:
+	/**
+	 * @brief Constructor that takes an external array of records
+	 *
+	 * @param records Pointer to array of CellularHelperResult
+	 *
+	 * @param numRecords Number of items in records. One is always left empty, so the queue holds
+	 * numRecords - 1 results.
+	 */
+	CellularHelperResultQueue(CellularHelperResult *records, size_t numRecords);
+
+	/**
+	 * @brief Adds a result to the queue (producer thread only)
+	 *
+	 * @return true if added, or false if the queue is full.
+	 */
+	bool push(const CellularHelperResult &result);
+
+	/**
+	 * @brief Removes the oldest result from the queue (consumer thread only)
+	 *
+	 * @param result Filled in with the result.
+	 *
+	 * @return true if a result was removed, or false if the queue is empty.
+	 */
+	bool pop(CellularHelperResult &result);
+
+	/**
+	 * @brief Returns true if there are no results in the queue
+	 *
+	 * Another thread may add a result at any time, so this is only a hint on the producer thread.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * @brief Gets the number of results discarded because the queue was full
+	 */
+	uint32_t getNumDropped() const { return numDropped.load(std::memory_order_relaxed); };
+
+	/**
+	 * @brief Adds a RESULT_SIGNAL result from a CellularHelperRSSIQualResponse (producer thread only)
+	 */
+	bool pushSignal(const CellularHelperRSSIQualResponse &resp);
+
+	/**
+	 * @brief Adds a RESULT_SIGNAL result from a CellularHelperExtendedQualResponse (producer thread only)
+	 */
+	bool pushSignal(const CellularHelperExtendedQualResponse &resp);
+
+	/**
+	 * @brief Adds a RESULT_REGISTRATION result (producer thread only)
+	 *
+	 * @param resp The registration. Nothing is added if it is not valid.
+	 *
+	 * @param isEPS true if from +CEREG, false for +CREG
+	 */
+	bool pushRegistration(const CellularHelperCREGResponse &resp, bool isEPS);
+
+	/**
+	 * @brief Adds a RESULT_REGISTRATION result from values (producer thread only)
+	 *
+	 * This does not allocate memory, so it can be used from a URC handler.
+	 */
+	bool pushRegistration(int stat, int lac, int ci, int rat, bool isEPS);
+
+	/**
+	 * @brief Adds a RESULT_CELL result for the service cell and each valid neighbor (producer thread only)
+	 *
+	 * @return true if all of the cells were added.
+	 */
+	bool pushEnvironment(const CellularHelperEnvironmentResponse &resp);
+
+protected:
+	/**
+	 * @brief Returns the index after index, wrapping around at numRecords
+	 */
+	size_t nextIndex(size_t index) const { return (index + 1 < numRecords) ? index + 1 : 0; };
+
+	/**
+	 * @brief Array of records used as a ring buffer
+	 */
+	CellularHelperResult *records;
+
+	/**
+	 * @brief Number of entries in records
+	 */
+	size_t numRecords;
+
+	/**
+	 * @brief Index of the next record to pop. Only written by the consumer.
+	 */
+	std::atomic<size_t> head;
+
+	/**
+	 * @brief Index of the next record to push. Only written by the producer.
+	 */
+	std::atomic<size_t> tail;
+
+	/**
+	 * @brief Number of results discarded because the queue was full. Only written by the producer.
+	 */
+	std::atomic<uint32_t> numDropped;
+};
+
+/**
+ * @brief Result queue with a statically allocated array of records
+ *
+ * @param MAX_RESULTS templated parameter for the number of results the queue holds. Each one is 24 bytes.
+ */
+template <size_t MAX_RESULTS>
+class CellularHelperResultQueueStatic : public CellularHelperResultQueue {
+public:
+	explicit CellularHelperResultQueueStatic() : CellularHelperResultQueue(staticRecords, MAX_RESULTS + 1) {
+	}
+
+protected:
+	/**
+	 * @brief Array of records, one more than MAX_RESULTS as one is always empty
+	 */
+	CellularHelperResult staticRecords[MAX_RESULTS + 1];
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERRESULTQUEUE_H */
@@ -0,0 +1,157 @@
+#include "Particle.h"
+
+#include "CellularHelperSignalSampler.h"
+
+#if Wiring_Cellular
+
+String CellularHelperSignalStats::toString() const {
+	return String::format("count=%u min=%d max=%d mean=%.1f p10=%d p50=%d p90=%d", (unsigned int) count, min, max, mean, p10, p50, p90);
+}
+
+CellularHelperSignalSampler::CellularHelperSignalSampler(CellularHelperSignalSample *samples, size_t maxSamples) :
+	samples(samples), maxSamples(maxSamples) {
+}
+
+bool CellularHelperSignalSampler::sample() {
+	CellularHelperRSSIQualResponse rssiQual = CellularHelper.getRSSIQual();
+	if (rssiQual.resp != RESP_OK) {
+		return false;
+	}
+
+	int rsrp = 255;
+	int rsrq = 255;
+
+	if (CellularHelper.isSARA_R4()) {
+		// AT+CESQ only returns rsrp and rsrq on LTE, so don't spend the round trip on 2G/3G
+		CellularHelperExtendedQualResponse extQual = CellularHelper.getExtendedQual();
+		if (extQual.resp == RESP_OK) {
+			rsrp = extQual.rsrp;
+			rsrq = extQual.rsrq;
+		}
+	}
+
+	addSample(rssiQual.rssi, rsrp, rsrq, millis());
+	return true;
+}
+
+void CellularHelperSignalSampler::addSample(int rssi, int rsrp, int rsrq, unsigned long timeMs) {
+	if (maxSamples == 0) {
+		return;
+	}
+
+	CellularHelperSignalSample &sample = samples[nextIndex];
+
+	if (numSamples == 0) {
+		sample.deltaSec = 0;
+	}
+	else {
+		unsigned long deltaSec = (timeMs - lastTimeMs) / 1000;
+		sample.deltaSec = (deltaSec > 0xffff) ? 0xffff : (uint16_t) deltaSec;
+	}
+	lastTimeMs = timeMs;
+
+	// getRSSIQual() returns 0 for an unknown rssi, getExtendedQual() returns 255
+	sample.rssi = (rssi < 0 && rssi >= -128) ? (int8_t) rssi : UNKNOWN;
+	sample.rsrp = (rsrp >= 0 && rsrp <= 97) ? (int8_t) rsrp : UNKNOWN;
+	sample.rsrq = (rsrq >= 0 && rsrq <= 34) ? (int8_t) rsrq : UNKNOWN;
+	sample.reserved = 0;
+
+	if (++nextIndex >= maxSamples) {
+		nextIndex = 0;
+	}
+	if (numSamples < maxSamples) {
+		numSamples++;
+	}
+}
+
+void CellularHelperSignalSampler::clear() {
+	numSamples = 0;
+	nextIndex = 0;
+	lastTimeMs = 0;
+}
+
+const CellularHelperSignalSample &CellularHelperSignalSampler::getSample(size_t index) const {
+	size_t ii = (nextIndex + maxSamples - 1 - index) % maxSamples;
+	return samples[ii];
+}
+
+// [static]
+int8_t CellularHelperSignalSampler::getField(const CellularHelperSignalSample &sample, Field field) {
+	switch(field) {
+	case FIELD_RSSI:
+		return sample.rssi;
+
+	case FIELD_RSRP:
+		return sample.rsrp;
+
+	case FIELD_RSRQ:
+		return sample.rsrq;
+	}
+	return UNKNOWN;
+}
+
+bool CellularHelperSignalSampler::getStats(Field field, unsigned long windowSec, CellularHelperSignalStats &stats) const {
+	// Values are int8_t so a histogram indexed by (value + 128) replaces sorting for percentiles
+	uint16_t histogram[256];
+	memset(histogram, 0, sizeof(histogram));
+
+	stats = CellularHelperSignalStats();
+
+	long sum = 0;
+	unsigned long ageSec = 0;
+
+	for(size_t ii = 0; ii < numSamples; ii++) {
+		const CellularHelperSignalSample &sample = getSample(ii);
+
+		int8_t value = getField(sample, field);
+		if (value != UNKNOWN) {
+			if (stats.count == 0 || value < stats.min) {
+				stats.min = value;
+			}
+			if (stats.count == 0 || value > stats.max) {
+				stats.max = value;
+			}
+			sum += value;
+			histogram[value + 128]++;
+			stats.count++;
+		}
+
+		// deltaSec is the time from the previous (older) sample to this one
+		ageSec += sample.deltaSec;
+		if (windowSec != 0 && ageSec > windowSec) {
+			break;
+		}
+	}
+
+	if (stats.count == 0) {
+		return false;
+	}
+
+	stats.mean = (float)sum / (float)stats.count;
+
+	// Nearest-rank percentiles: the smallest value with at least (p * count / 100) values at or below it
+	const size_t rank10 = (stats.count * 10 + 99) / 100;
+	const size_t rank50 = (stats.count * 50 + 99) / 100;
+	const size_t rank90 = (stats.count * 90 + 99) / 100;
+
+	size_t cumulative = 0;
+	for(int value = stats.min; value <= stats.max; value++) {
+		size_t prev = cumulative;
+		cumulative += histogram[value + 128];
+
+		if (prev < rank10 && cumulative >= rank10) {
+			stats.p10 = value;
+		}
+		if (prev < rank50 && cumulative >= rank50) {
+			stats.p50 = value;
+		}
+		if (prev < rank90 && cumulative >= rank90) {
+			stats.p90 = value;
+			break;
+		}
+	}
+
+	return true;
+}
+
+#endif /* Wiring_Cellular */
@@ -0,0 +1,212 @@
+#ifndef __CELLULARHELPERSIGNALSAMPLER_H
+#define __CELLULARHELPERSIGNALSAMPLER_H
+
+#include "Particle.h"
+
+#include "CellularHelper.h"
+
+#if Wiring_Cellular
+
+/**
+ * @brief One signal quality sample, packed into 6 bytes
+ *
+ * The values are stored as int8_t to keep the ring buffer small. Unknown values are
+ * CellularHelperSignalSampler::UNKNOWN.
+ */
+struct CellularHelperSignalSample {
+	/**
+	 * @brief Seconds since the previous sample (saturates at 65535)
+	 */
+	uint16_t deltaSec;
+
+	/**
+	 * @brief RSSI in dBm from AT+CSQ (-113 to -51)
+	 */
+	int8_t rssi;
+
+	/**
+	 * @brief RSRP as returned by AT+CESQ (0 - 97). dBm is rsrp - 141. LTE only.
+	 */
+	int8_t rsrp;
+
+	/**
+	 * @brief RSRQ as returned by AT+CESQ (0 - 34). dB is (rsrq - 40) / 2. LTE only.
+	 */
+	int8_t rsrq;
+
+	/**
+	 * @brief Padding, always 0
+	 */
+	uint8_t reserved;
+};
+
+/**
+ * @brief Statistics for one field over a window of samples
+ *
+ * Values are in the same units as the field in CellularHelperSignalSample.
+ */
+class CellularHelperSignalStats {
+public:
+	size_t count = 0;	//!< Number of samples with a known value in the window. Other fields are only valid if non-zero.
+	int min = 0;		//!< Minimum value
+	int max = 0;		//!< Maximum value
+	float mean = 0.0;	//!< Mean value
+	int p10 = 0;		//!< 10th percentile
+	int p50 = 0;		//!< Median
+	int p90 = 0;		//!< 90th percentile
+
+	/**
+	 * @brief Converts this object into a readable string
+	 *
+	 * The string will be of the format `count=12 min=-89 max=-71 mean=-80.5 p10=-87 p50=-81 p90=-73`.
+	 */
+	String toString() const;
+};
+
+/**
+ * @brief Samples signal quality periodically and keeps the samples in a fixed-size ring buffer
+ *
+ * Instead of publishing every sample, you can call sample() on a timer and periodically publish
+ * a summary from getStats(). No memory is allocated after construction; the oldest samples
+ * are overwritten when the buffer is full.
+ *
+ * You may want to use CellularHelperSignalSamplerStatic<> instead of separately allocating the
+ * array of samples.
+ */
+class CellularHelperSignalSampler {
+public:
+	/**
+	 * @brief Fields that can be passed to getStats()
+	 */
+	enum Field {
+		FIELD_RSSI,		//!< rssi from AT+CSQ
+		FIELD_RSRP,		//!< rsrp from AT+CESQ
+		FIELD_RSRQ		//!< rsrq from AT+CESQ
+	};
+
+	/**
+	 * @brief Constructor that takes an external array of samples
+	 *
+	 * @param samples Pointer to array of CellularHelperSignalSample
+	 *
+	 * @param maxSamples Number of items in samples.
+	 */
+	CellularHelperSignalSampler(CellularHelperSignalSample *samples, size_t maxSamples);
+
+	/**
+	 * @brief Queries the modem and adds a sample
+	 *
+	 * Calls CellularHelper.getRSSIQual() and, on SARA-R4 (LTE Cat M1) modems,
+	 * CellularHelper.getExtendedQual(). This blocks while the modem responds.
+	 *
+	 * @return true if a sample was added or false if the modem did not respond.
+	 */
+	bool sample();
+
+	/**
+	 * @brief Adds a sample with values you obtained yourself
+	 *
+	 * @param rssi RSSI in dBm, as in CellularHelperRSSIQualResponse, or 0 if unknown.
+	 *
+	 * @param rsrp RSRP as in CellularHelperExtendedQualResponse, or 255 if unknown.
+	 *
+	 * @param rsrq RSRQ as in CellularHelperExtendedQualResponse, or 255 if unknown.
+	 *
+	 * @param timeMs The time of the sample in milliseconds, typically millis().
+	 */
+	void addSample(int rssi, int rsrp, int rsrq, unsigned long timeMs);
+
+	/**
+	 * @brief Removes all samples
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of samples stored
+	 */
+	size_t getNumSamples() const { return numSamples; };
+
+	/**
+	 * @brief Gets a sample
+	 *
+	 * @param index 0 is the most recent sample, 1 is the one before that, and so on.
+	 *
+	 * @return The sample. index must be less than getNumSamples().
+	 */
+	const CellularHelperSignalSample &getSample(size_t index) const;
+
+	/**
+	 * @brief Calculates statistics for one field over the most recent samples
+	 *
+	 * @param field The field to calculate statistics for, such as FIELD_RSSI.
+	 *
+	 * @param windowSec Only samples taken within this many seconds of the most recent sample are
+	 * included. Pass 0 to include all samples.
+	 *
+	 * @param stats Filled in with the statistics.
+	 *
+	 * @return true if there was at least one known value in the window.
+	 *
+	 * This does not allocate memory. It uses about 512 bytes of stack for a histogram, which is
+	 * used to calculate percentiles without sorting.
+	 */
+	bool getStats(Field field, unsigned long windowSec, CellularHelperSignalStats &stats) const;
+
+	/**
+	 * @brief Value stored in a sample when the value is not known
+	 */
+	static const int8_t UNKNOWN = -128;
+
+protected:
+	/**
+	 * @brief Returns the value of field in sample
+	 */
+	static int8_t getField(const CellularHelperSignalSample &sample, Field field);
+
+	/**
+	 * @brief Array of samples used as a ring buffer
+	 */
+	CellularHelperSignalSample *samples;
+
+	/**
+	 * @brief Number of entries in samples
+	 */
+	size_t maxSamples;
+
+	/**
+	 * @brief Number of samples stored (up to maxSamples)
+	 */
+	size_t numSamples = 0;
+
+	/**
+	 * @brief Index in samples where the next sample will be written
+	 */
+	size_t nextIndex = 0;
+
+	/**
+	 * @brief Time of the most recent sample in milliseconds
+	 */
+	unsigned long lastTimeMs = 0;
+};
+
+/**
+ * @brief Signal sampler with a statically allocated ring buffer
+ *
+ * @param MAX_SAMPLES templated parameter for the number of samples to store. Each one is 6 bytes.
+ */
+template <size_t MAX_SAMPLES>
+class CellularHelperSignalSamplerStatic : public CellularHelperSignalSampler {
+public:
+	explicit CellularHelperSignalSamplerStatic() : CellularHelperSignalSampler(staticSamples, MAX_SAMPLES) {
+	}
+
+protected:
+	/**
+	 * @brief Array of samples
+	 */
+	CellularHelperSignalSample staticSamples[MAX_SAMPLES];
+};
+
+#endif /* Wiring_Cellular */
+
+#endif /* __CELLULARHELPERSIGNALSAMPLER_H */
@@ -0,0 +1,48 @@
+#include "HostMappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool HostMappedFile::open(const char *path) {
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		Log.info("could not open %s", path);
+		return false;
+	}
+
+	struct stat st;
+	bool result = false;
+	if (fstat(fd, &st) == 0) {
+		if (st.st_size == 0) {
+			// mmap fails for a length of 0
+			result = true;
+		}
+		else {
+			void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				data = (const uint8_t *)addr;
+				size = (size_t)st.st_size;
+				result = true;
+			}
+			else {
+				Log.info("could not map %s", path);
+			}
+		}
+	}
+
+	// The mapping stays valid after the file is closed
+	::close(fd);
+	return result;
+}
+
+void HostMappedFile::close() {
+	if (data) {
+		munmap((void *)data, size);
+		data = NULL;
+	}
+	size = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef __HOSTMAPPEDFILE_H
+#define __HOSTMAPPEDFILE_H
+
+#include "Particle.h"
+
+/**
+ * @brief A read-only file mapped into memory with mmap
+ *
+ * This is how a table from tools/generate-cell-db.js is loaded when running the library on a
+ * computer, instead of compiling the .cpp output into flash:
+ *
+ * ```
+ * HostMappedFile file;
+ * if (file.open("cells.bin")) {
+ *     CellularHelperCellLocationDB db(file.getData(), file.getSize());
+ * }
+ * ```
+ */
+class HostMappedFile {
+public:
+	HostMappedFile() {}
+	~HostMappedFile() { close(); }
+
+	HostMappedFile(const HostMappedFile &) = delete;
+	HostMappedFile &operator=(const HostMappedFile &) = delete;
+
+	/**
+	 * @brief Maps a file, closing the one that was open
+	 *
+	 * @param path The path to the file.
+	 *
+	 * @return true if the file was mapped. An empty file can be opened, but getData() is NULL.
+	 */
+	bool open(const char *path);
+
+	/**
+	 * @brief Unmaps the file. Pointers from getData() are no longer valid.
+	 */
+	void close();
+
+	/**
+	 * @brief Gets the contents of the file, or NULL if no file is open
+	 */
+	const uint8_t *getData() const { return data; };
+
+	/**
+	 * @brief Gets the size of the file in bytes
+	 */
+	size_t getSize() const { return size; };
+
+protected:
+	const uint8_t *data = NULL;
+	size_t size = 0;
+};
+
+#endif /* __HOSTMAPPEDFILE_H */
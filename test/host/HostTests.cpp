@@ -0,0 +1,522 @@
+#include "Particle.h"
+#include "CellularHelper.h"
+#include "CellularHelperAsync.h"
+#include "CellularHelperCommandStats.h"
+#include "CellularHelperCellLocationDB.h"
+#include "HostMappedFile.h"
+#include "CellularHelperRegistrationMonitor.h"
+#include "CellularHelperResultQueue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Runs the tests in examples/7-parser-replay and the tests below, which go through the CellularHelper
+// methods and the scripted Cellular.command, on a computer. The exit code is non-zero if anything
+// logged an error.
+
+// From examples/7-parser-replay
+void runReplayTests();
+void runBenchmarks();
+
+#define MODEM_RESPONSE(prefix, chunks, resp) Cellular.addResponse(prefix, chunks, sizeof(chunks) / sizeof(chunks[0]), resp)
+
+const HostModemChunk cgmiChunks[] = {
+	{ TYPE_UNKNOWN, "\r\nu-blox\r\n" }
+};
+
+const HostModemChunk cgmmChunks[] = {
+	{ TYPE_UNKNOWN, "\r\nSARA-U260\r\n" }
+};
+
+const HostModemChunk cimiChunks[] = {
+	{ TYPE_UNKNOWN, "\r\n310260123456789\r\n" }
+};
+
+const HostModemChunk csqChunks[] = {
+	{ TYPE_PLUS, "\r\n+CSQ: 19,99\r\n" }
+};
+
+const HostModemChunk cregChunks[] = {
+	{ TYPE_PLUS, "\r\n+CREG: 2,1,\"FFFE\",\"C45C010\",8\r\n" }
+};
+
+// Reporting off (n=0), then after AT+CREG=2
+const HostModemChunk creg0Chunks[] = {
+	{ TYPE_PLUS, "\r\n+CREG: 0,1\r\n" }
+};
+
+const HostModemChunk creg2Chunks[] = {
+	{ TYPE_PLUS, "\r\n+CREG: 2,1,\"FFFE\",\"C45C010\",8\r\n" }
+};
+
+const HostModemChunk cged5Chunks[] = {
+	{ TYPE_PLUS, "\r\n+CGED: MCC:310, MNC:260, LAC:ab22, CI:a78a, BSIC:23, Arfcn:00596, RxLev:024\r\n" },
+	{ TYPE_UNKNOWN, "\r\nMCC:310, MNC:260, LAC:ab22, CI:a78b, BSIC:1a, Arfcn:00600, RxLev:01c\r\n" }
+};
+
+const HostModemChunk uulocChunks[] = {
+	{ TYPE_PLUS, "\r\n+UULOC: 13/04/2020,15:03:33.000,42.3601700,-71.0589000,0,1472\r\n" },
+	{ TYPE_OK, "\r\nOK\r\n" }
+};
+
+const HostModemChunk noChunks[] = {
+};
+
+// Each test sets up the modem script, calls CellularHelper, and returns a string representation of
+// the result, usually followed by the commands that were sent
+String testGetIdentity() {
+	MODEM_RESPONSE("AT+CGMI", cgmiChunks, RESP_OK);
+	MODEM_RESPONSE("AT+CGMM", cgmmChunks, RESP_OK);
+	CellularHelper.clearIdentityCache();
+
+	String result = CellularHelper.getManufacturer();
+	result += " " + CellularHelper.getModel();
+
+	// These come from the cache
+	result += " " + CellularHelper.getManufacturer();
+	result += " " + CellularHelper.getModel();
+
+	return result + " " + Cellular.getCommands();
+}
+
+String testGetIdentityError() {
+	MODEM_RESPONSE("AT+CGMI", noChunks, RESP_ERROR);
+	CellularHelper.clearIdentityCache();
+
+	// Errors are not cached, so both calls send the command
+	String result = "[" + CellularHelper.getManufacturer() + "]";
+	result += " [" + CellularHelper.getManufacturer() + "]";
+
+	return result + " " + Cellular.getCommands();
+}
+
+String testGetIdentityThreads() {
+	MODEM_RESPONSE("AT+CGMI", cgmiChunks, RESP_OK);
+	CellularHelper.clearIdentityCache();
+
+	// Only one thread sends the command; the others wait for it and use the cached value
+	const size_t NUM_THREADS = 4;
+	String results[NUM_THREADS];
+	std::thread threads[NUM_THREADS];
+	for(size_t ii = 0; ii < NUM_THREADS; ii++) {
+		threads[ii] = std::thread([&results, ii] { results[ii] = CellularHelper.getManufacturer(); });
+	}
+
+	String result;
+	for(size_t ii = 0; ii < NUM_THREADS; ii++) {
+		threads[ii].join();
+		result += results[ii] + " ";
+	}
+	return result + Cellular.getCommands();
+}
+
+String testGetIMSI() {
+	MODEM_RESPONSE("AT+CIMI", cimiChunks, RESP_OK);
+	String imsi = CellularHelper.getIMSI();
+	return imsi + " " + Cellular.getCommands();
+}
+
+String testGetRSSIQual() {
+	MODEM_RESPONSE("AT+CSQ", csqChunks, RESP_OK);
+	CellularHelperRSSIQualResponse resp = CellularHelper.getRSSIQual();
+	return resp.toString() + " " + Cellular.getCommands();
+}
+
+String testGetRSSIQualTimeout() {
+	MODEM_RESPONSE("AT+CSQ", noChunks, WAIT);
+	CellularHelperRSSIQualResponse resp = CellularHelper.getRSSIQual();
+	return String::format("resp=%d %s", resp.resp, resp.toString().c_str());
+}
+
+String testCommandTooLong() {
+	String longName;
+	for(size_t ii = 0; ii < CellularHelperClass::COMMAND_BUF_SIZE; ii++) {
+		longName += 'x';
+	}
+	int tooLong = CellularHelper.command("UDNSRN", 1000, "AT+UDNSRN=0,\"%s\"\r\n", longName.c_str());
+
+	// Exactly fits, with the null terminator
+	String fits = longName.substring(0, CellularHelperClass::COMMAND_BUF_SIZE - 17);
+	int fitsResp = CellularHelper.command("UDNSRN", 1000, "AT+UDNSRN=0,\"%s\"\r\n", fits.c_str());
+
+	String commands = Cellular.getCommands();
+	return String::format("tooLong=%d fits=%d sent=%u", tooLong, fitsResp, commands.length());
+}
+
+String testCommandStatsLocking() {
+	CellularHelperCommandStatsEntry entries[2];
+	CellularHelperCommandStats stats(entries, 2);
+
+	MODEM_RESPONSE("AT+CSQ", csqChunks, RESP_OK);
+	CellularHelper.setCommandStats(&stats);
+	CellularHelper.getRSSIQual();
+	CellularHelper.command("100%s", 1000, "AT\r\n");
+	CellularHelper.setCommandStats(NULL);
+
+	// The % in the name is not used as a format
+	stats.logStats();
+
+	CellularHelperCommandStatsEntry entry;
+	bool found = stats.copyEntry("CSQ", entry);
+	String result = String::format("entries=%u csq=%d,%lu", (unsigned)stats.getNumEntries(), found, found ? (unsigned long)entry.getCount() : 0);
+
+	stats.clear();
+	result += String::format(" cleared=%u found=%d", (unsigned)stats.getNumEntries(), stats.copyEntry("CSQ", entry));
+	return result;
+}
+
+String testCommandStatsThreads() {
+	CellularHelperCommandStatsEntry entries[4];
+	CellularHelperCommandStats stats(entries, 4);
+
+	// Commands are recorded on another thread, as the async worker does, while the stats are read
+	const int NUM_COMMANDS = 2000;
+	std::atomic<bool> done(false);
+	std::thread worker([&stats, &done] {
+		for(int ii = 0; ii < NUM_COMMANDS; ii++) {
+			stats.record((ii % 2) ? "CSQ" : "CREG", RESP_OK, (uint32_t)ii % 100, 15);
+		}
+		done = true;
+	});
+
+	// Each copy must be from between two calls to record(), so the counts agree
+	char buf[256];
+	CellularHelperCommandStatsEntry entry;
+	int numInconsistent = 0;
+	while(!done) {
+		stats.dump(buf, sizeof(buf));
+		if (stats.copyEntry("CSQ", entry) && entry.bytes != entry.getCount() * 15) {
+			numInconsistent++;
+		}
+	}
+	worker.join();
+
+	stats.copyEntry("CSQ", entry);
+	return String::format("csq=%lu inconsistent=%d", (unsigned long)entry.getCount(), numInconsistent);
+}
+
+String testResultQueueThreads() {
+	CellularHelperResultQueueStatic<8> queue;
+
+	// One thread pushes sequenced results, as the async worker does, while this thread pops them
+	const uint32_t NUM_RESULTS = 20000;
+	std::vector<bool> wasPushed(NUM_RESULTS);
+	std::atomic<bool> done(false);
+	std::thread producer([&queue, &wasPushed, &done] {
+		for(uint32_t ii = 0; ii < NUM_RESULTS; ii++) {
+			CellularHelperResult result;
+			result.type = CellularHelperResult::RESULT_REGISTRATION;
+			result.timeMs = ii;
+			result.data.registration.ci = ~ii;
+			wasPushed[ii] = queue.push(result);
+		}
+		done = true;
+	});
+
+	// Every result popped must be newer than the last one and intact
+	std::vector<bool> wasPopped(NUM_RESULTS);
+	uint32_t numPopped = 0;
+	int numBad = 0;
+	int64_t last = -1;
+	CellularHelperResult result;
+	while(true) {
+		bool wasDone = done;
+		if (!queue.pop(result)) {
+			if (wasDone) {
+				break;
+			}
+			continue;
+		}
+		if ((int64_t)result.timeMs <= last || result.timeMs >= NUM_RESULTS || result.data.registration.ci != ~result.timeMs) {
+			numBad++;
+			continue;
+		}
+		last = result.timeMs;
+		wasPopped[result.timeMs] = true;
+		numPopped++;
+	}
+	producer.join();
+
+	// Each result was either popped or counted as dropped, never both
+	int numMissing = 0;
+	for(uint32_t ii = 0; ii < NUM_RESULTS; ii++) {
+		if (wasPushed[ii] != wasPopped[ii]) {
+			numMissing++;
+		}
+	}
+	uint32_t numDropped = queue.getNumDropped();
+	return String::format("bad=%d missing=%d accounted=%d", numBad, numMissing, (numPopped + numDropped) == NUM_RESULTS);
+}
+
+String testGetCREG() {
+	MODEM_RESPONSE("AT+CREG?", cregChunks, RESP_OK);
+
+	CellularHelperCREGResponse resp;
+	CellularHelper.getCREG(resp);
+	return resp.toString() + " " + Cellular.getCommands();
+}
+
+String testMonitorGetCREG() {
+	MODEM_RESPONSE("AT+CREG?", creg0Chunks, RESP_OK);
+	MODEM_RESPONSE("AT+CEREG", noChunks, RESP_ERROR);
+
+	CellularHelperRegistrationMonitorClass monitor;
+	bool started = monitor.start();
+	String result = String::format("started=%d ", started) + monitor.getCREG().toString();
+
+	// While the monitor is running, getCREG() uses its values and doesn't turn off reporting
+	Cellular.urc(TYPE_PLUS, "\r\n+CREG: 5,\"1AF7\",\"817B57F\",2\r\n");
+	CellularHelperCREGResponse resp;
+	CellularHelper.getCREG(resp);
+	result += " getCREG=" + resp.toString();
+
+	monitor.stop();
+	return result + " " + Cellular.getCommands();
+}
+
+String testMonitorRestoreMode() {
+	// Reporting was already on (n=2), so stop() leaves it on
+	MODEM_RESPONSE("AT+CREG?", creg2Chunks, RESP_OK);
+	MODEM_RESPONSE("AT+CEREG", noChunks, RESP_ERROR);
+
+	CellularHelperRegistrationMonitorClass monitor;
+	monitor.start();
+	monitor.stop();
+
+	// Without the monitor, getCREG() turns reporting on and off again
+	CellularHelperCREGResponse resp;
+	CellularHelper.getCREG(resp);
+	return resp.toString() + " " + Cellular.getCommands();
+}
+
+String testGetEnvironment() {
+	MODEM_RESPONSE("AT+CGED=5", cged5Chunks, RESP_OK);
+
+	CellularHelperEnvironmentResponseStatic<4> resp;
+	CellularHelper.getEnvironment(CellularHelper.ENVIRONMENT_SERVING_CELL_AND_NEIGHBORS, resp);
+	return String::format("%s neighbors=%u ", resp.service.toString().c_str(), (unsigned int)resp.getNumNeighbors()) + Cellular.getCommands();
+}
+
+String testGetLocation() {
+	// The +UULOC arrives after the OK, in the response to an empty command
+	MODEM_RESPONSE("", uulocChunks, RESP_OK);
+	MODEM_RESPONSE("AT+ULOC", noChunks, RESP_OK);
+
+	CellularHelperLocationResponse resp = CellularHelper.getLocation(10000);
+	return resp.toString() + " " + Cellular.getCommands();
+}
+
+String testStartLocation() {
+	MODEM_RESPONSE("AT+ULOC", noChunks, RESP_OK);
+
+	CellularHelperLocationResponse resp;
+	bool started = CellularHelper.startLocation(resp, 10000);
+
+	// A second request while the first is outstanding fails without sending anything
+	CellularHelperLocationResponse resp2;
+	bool started2 = CellularHelper.startLocation(resp2, 10000);
+
+	// The URCs arrive on another thread, as they do on the system thread. Only the first is used.
+	std::thread systemThread([] {
+		Cellular.urc(TYPE_PLUS, "\r\n+UULOC: 13/04/2020,15:03:33.000,42.3601700,-71.0589000,0,1472\r\n");
+		Cellular.urc(TYPE_PLUS, "\r\n+UULOC: 13/04/2020,15:04:33.000,1.0,2.0,3,4\r\n");
+	});
+
+	unsigned long start = millis();
+	while(!resp.isValid() && millis() - start < 2000) {
+		delay(1);
+	}
+	String result = String::format("started=%d started2=%d ", started, started2) + resp.toString();
+
+	systemThread.join();
+	CellularHelper.stopLocation();
+
+	bool handled = Cellular.urc(TYPE_PLUS, "\r\n+UULOC: 13/04/2020,15:05:33.000,1.0,2.0,3,4\r\n");
+	result += String::format(" handled=%d ", handled);
+	result += resp.toString();
+
+	// After stopLocation(), another request can be started
+	bool restarted = CellularHelper.startLocation(resp2, 10000);
+	CellularHelper.stopLocation();
+	result += String::format(" restarted=%d ", restarted);
+	return result + Cellular.getCommands();
+}
+
+String testAsyncSetupFailure() {
+	CellularHelperAsyncClass async;
+
+	// A queue size of 0 makes the queue creation fail
+	bool setupResult = async.setup(0);
+
+	CellularHelperAsyncRSSIQualRequest request;
+	bool queued = async.getRSSIQual(request);
+	String result = String::format("setup=%d queued=%d state=%d", setupResult, queued, request.getState());
+
+	// A stack size of 0 makes the thread creation fail after the queues were created
+	setupResult = async.setup(CellularHelperAsyncClass::DEFAULT_QUEUE_SIZE, 0);
+	queued = async.getRSSIQual(request);
+	result += String::format(" threadSetup=%d queued=%d state=%d", setupResult, queued, request.getState());
+	return result;
+}
+
+// Waits for the worker thread, calling CellularHelperAsync.loop() until the request is done
+bool waitAsyncDone(CellularHelperAsyncRequest &request) {
+	unsigned long start = millis();
+	while(!request.isDone()) {
+		if (millis() - start >= 2000) {
+			return false;
+		}
+		CellularHelperAsync.loop();
+		delay(1);
+	}
+	return true;
+}
+
+String testAsyncPoll() {
+	MODEM_RESPONSE("AT+CSQ", csqChunks, RESP_OK);
+	CellularHelperAsync.setup();
+
+	CellularHelperAsyncRSSIQualRequest request;
+	bool queued = CellularHelperAsync.getRSSIQual(request);
+	bool done = waitAsyncDone(request);
+	return String::format("queued=%d done=%d %s ", queued, done, request.result.toString().c_str()) + Cellular.getCommands();
+}
+
+// Queues the request again until it has run 3 times
+void asyncCallback(CellularHelperAsyncRequest &request, void *context) {
+	int *pCount = (int *)context;
+
+	if (++*pCount < 3) {
+		CellularHelperAsync.getRSSIQual(static_cast<CellularHelperAsyncRSSIQualRequest &>(request));
+	}
+}
+
+String testAsyncCallback() {
+	MODEM_RESPONSE("AT+CSQ", csqChunks, RESP_OK);
+	CellularHelperAsync.setup();
+
+	int count = 0;
+	CellularHelperAsyncRSSIQualRequest request;
+	request.setCallback(asyncCallback, &count);
+	CellularHelperAsync.getRSSIQual(request);
+
+	// Without a call to loop(), the request has run but is still pending, so it can't be queued again
+	delay(100);
+	String result = String::format("pending=%d requeue=%d", request.isPending(), CellularHelperAsync.getRSSIQual(request));
+
+	// The callback queues it again, so it's only done after the third time
+	bool done = waitAsyncDone(request);
+	result += String::format(" count=%d done=%d ", count, done);
+	return result + Cellular.getCommands();
+}
+
+struct HostTest {
+	const char *name;
+	String (*fn)();
+	const char *expected;
+};
+
+const HostTest hostTests[] = {
+	{ "Identity", testGetIdentity, "u-blox SARA-U260 u-blox SARA-U260 AT+CGMI|AT+CGMM" },
+	{ "Identity error", testGetIdentityError, "[] [] AT+CGMI|AT+CGMI" },
+	{ "Identity threads", testGetIdentityThreads, "u-blox u-blox u-blox u-blox AT+CGMI" },
+	{ "IMSI", testGetIMSI, "310260123456789 AT+CIMI" },
+	{ "CSQ", testGetRSSIQual, "rssi=-75 qual=99 AT+CSQ" },
+	{ "CSQ timeout", testGetRSSIQualTimeout, "resp=-1 rssi=99 qual=99" },
+	{ "Command too long", testCommandTooLong, "tooLong=-3 fits=-2 sent=125" },
+	{ "Command stats", testCommandStatsLocking, "entries=2 csq=1,1 cleared=0 found=0" },
+	{ "Command stats threads", testCommandStatsThreads, "csq=1000 inconsistent=0" },
+	{ "Result queue threads", testResultQueueThreads, "bad=0 missing=0 accounted=1" },
+	{ "CREG", testGetCREG, "stat=1 lac=0xfffe ci=0xc45c010 rat=8 AT+CREG=2|AT+CREG?|AT+CREG=0" },
+	{ "Location", testGetLocation, "lat=42.360168 lon=-71.058899 alt=0 uncertainty=1472 AT+ULOCCELL=0|AT+ULOC=2,2,0,10,5000|" },
+	{ "Start location", testStartLocation, "started=1 started2=0 lat=42.360168 lon=-71.058899 alt=0 uncertainty=1472 handled=0 lat=42.360168 lon=-71.058899 alt=0 uncertainty=1472 restarted=1 AT+ULOCCELL=0|AT+ULOC=2,2,0,10,5000|AT+ULOCCELL=0|AT+ULOC=2,2,0,10,5000" },
+	{ "Async setup failure", testAsyncSetupFailure, "setup=0 queued=0 state=0 threadSetup=0 queued=0 state=0" },
+	{ "Async poll", testAsyncPoll, "queued=1 done=1 rssi=-75 qual=99 AT+CSQ" },
+	{ "Async callback", testAsyncCallback, "pending=1 requeue=0 count=3 done=1 AT+CSQ|AT+CSQ|AT+CSQ" },
+	{ "Registration monitor", testMonitorGetCREG, "started=1 stat=1 lac=0xffff ci=0xffffffff rat=255 getCREG=stat=5 lac=0x1af7 ci=0x817b57f rat=2 AT+CREG?|AT+CREG=2|AT+CEREG?|AT+CEREG=2|AT+CREG?|AT+CREG=0" },
+	{ "Registration monitor restore", testMonitorRestoreMode, "stat=1 lac=0xfffe ci=0xc45c010 rat=8 AT+CREG?|AT+CREG=2|AT+CEREG?|AT+CEREG=2|AT+CREG?|AT+CREG=2|AT+CREG=2|AT+CREG?|AT+CREG=0" },
+	{ "Environment", testGetEnvironment, "rat=GSM mcc=310, mnc=260, lac=ab22 ci=a78a band=DCS 1800 or 1900 rssi=-85 bsic=23 arfcn=596 rxlev=36 neighbors=1 AT+CGED=5" },
+};
+
+void runHostTests() {
+	int numFailed = 0;
+
+	for(size_t ii = 0; ii < sizeof(hostTests) / sizeof(hostTests[0]); ii++) {
+		const HostTest &test = hostTests[ii];
+
+		Cellular.reset();
+
+		String result = test.fn();
+		if (result.equals(test.expected)) {
+			Log.info("%s passed", test.name);
+		}
+		else {
+			Log.error("%s failed got=%s expected=%s", test.name, result.c_str(), test.expected);
+			numFailed++;
+		}
+	}
+
+	Log.info("host tests complete, %d failed", numFailed);
+}
+
+// Looks up cells in a table generated from tools/cells-sample.csv by tools/generate-cell-db.js,
+// loaded with mmap the way an application on a computer would
+void runCellDBTest(const char *path) {
+	HostMappedFile file;
+	if (!file.open(path)) {
+		Log.error("could not load %s", path);
+		return;
+	}
+
+	CellularHelperCellLocationDB db(file.getData(), file.getSize());
+	String result = String::format("valid=%d cells=%u", db.isValid(), (unsigned int)db.getNumCells());
+
+	CellularHelperCellLocation location;
+	db.find(310, 260, 0xab22, 0xa78a, location);
+	result += " boston: " + location.toString();
+
+	db.find(234, 15, 200, 26011649, location);
+	result += " london: " + location.toString();
+
+	db.find(234, 15, 200, 26011648, location);
+	result += " unknown: " + location.toString();
+
+	const char *expected = "valid=1 cells=7 boston: lat=42.360168 lon=-71.058899 uncertainty=1000 cells=1 london: lat=51.500999 lon=-0.141000 uncertainty=1200 cells=1 unknown: valid=false";
+	if (result.equals(expected)) {
+		Log.info("cell location DB from %s passed", path);
+	}
+	else {
+		Log.error("cell location DB from %s failed got=%s expected=%s", path, result.c_str(), expected);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const char *which = (argc > 1) ? argv[1] : "all";
+	bool all = strcmp(which, "all") == 0;
+	bool found = false;
+
+	if (all || strcmp(which, "replay") == 0) {
+		runReplayTests();
+		found = true;
+	}
+	if (all || strcmp(which, "commands") == 0) {
+		runHostTests();
+		found = true;
+	}
+	if (all || strcmp(which, "benchmarks") == 0) {
+		runBenchmarks();
+		found = true;
+	}
+
+	if (strcmp(which, "celldb") == 0 && argc > 2) {
+		runCellDBTest(argv[2]);
+		found = true;
+	}
+
+	if (!found) {
+		fprintf(stderr, "usage: %s [all|replay|commands|benchmarks|celldb cells.bin]\n", argv[0]);
+		return 2;
+	}
+	return (Log.getErrorCount() == 0) ? 0 : 1;
+}
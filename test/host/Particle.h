@@ -0,0 +1,317 @@
+#ifndef __PARTICLE_HOST_H
+#define __PARTICLE_HOST_H
+
+// Stand-in for the Device OS API so the library can be built and tested on a computer.
+//
+// Only the parts used by the library and examples/7-parser-replay are here. Cellular.command
+// replays scripted modem output through the callback the same way the modem does, so the library
+// source is compiled unchanged. See Host tests in README.md.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define Wiring_Cellular 1
+
+#define SYSTEM_VERSION_v100 0x01000000
+#define SYSTEM_VERSION 0x01050000
+
+typedef uint32_t system_tick_t;
+
+// Cellular.command results and callback types, from the Device OS HAL
+enum {
+	WAIT = -1,
+	RESP_OK = -2,
+	RESP_ERROR = -3,
+	RESP_PROMPT = -4,
+	RESP_ABORTED = -5
+};
+
+enum {
+	TYPE_UNKNOWN = 0x000000,
+	TYPE_OK = 0x110000,
+	TYPE_ERROR = 0x120000,
+	TYPE_RING = 0x210000,
+	TYPE_CONNECT = 0x220000,
+	TYPE_NOCARRIER = 0x230000,
+	TYPE_NODIALTONE = 0x240000,
+	TYPE_BUSY = 0x250000,
+	TYPE_NOANSWER = 0x260000,
+	TYPE_PROMPT = 0x300000,
+	TYPE_PLUS = 0x400000,
+	TYPE_TEXT = 0x500000,
+	TYPE_ABORTED = 0x600000
+};
+
+/**
+ * @brief The subset of the Wiring String class used by the library
+ *
+ * As in Wiring, the characters are in a buffer allocated with realloc, so a non-empty String always
+ * uses the heap. (std::string keeps short strings inside the object, which would hide allocations
+ * from the allocation counts.)
+ */
+class String {
+public:
+	String() {}
+	String(const char *cstr) { concat(cstr); }
+	String(const String &other) { concat(other); }
+	String(String &&other) : buffer(other.buffer), capacity(other.capacity), len(other.len) { other.buffer = NULL; other.capacity = other.len = 0; }
+	explicit String(char c) { concat(c); }
+	explicit String(int value) { concat(std::to_string(value).c_str()); }
+	~String() { free(buffer); }
+
+	String &operator=(const String &other) { if (this != &other) { copy(other.c_str(), other.len); } return *this; }
+	String &operator=(String &&other) { if (this != &other) { free(buffer); buffer = other.buffer; capacity = other.capacity; len = other.len; other.buffer = NULL; other.capacity = other.len = 0; } return *this; }
+	String &operator=(const char *cstr) { copy(cstr, cstr ? strlen(cstr) : 0); return *this; }
+
+	unsigned char reserve(unsigned int size);
+	unsigned int length() const { return len; }
+	const char *c_str() const { return buffer ? buffer : ""; }
+	operator const char *() const { return c_str(); }
+
+	// As in Wiring, concatenating a null character does nothing
+	unsigned char concat(char c) { return c ? append(&c, 1) : 1; }
+	unsigned char concat(const char *cstr) { return cstr ? append(cstr, strlen(cstr)) : 1; }
+	unsigned char concat(const String &other) { return append(other.c_str(), other.len); }
+
+	String &operator+=(char c) { concat(c); return *this; }
+	String &operator+=(const char *cstr) { concat(cstr); return *this; }
+	String &operator+=(const String &other) { concat(other); return *this; }
+
+	friend String operator+(const String &a, const String &b) { String result(a); result.concat(b); return result; }
+	friend String operator+(const String &a, const char *b) { String result(a); result.concat(b); return result; }
+	friend String operator+(const char *a, const String &b) { String result(a); result.concat(b); return result; }
+
+	char charAt(unsigned int index) const { return (index < len) ? buffer[index] : 0; }
+	unsigned char equals(const String &other) const { return len == other.len && strcmp(c_str(), other.c_str()) == 0; }
+	unsigned char equals(const char *cstr) const { return strcmp(c_str(), cstr ? cstr : "") == 0; }
+	unsigned char operator==(const String &other) const { return equals(other); }
+	unsigned char operator==(const char *cstr) const { return equals(cstr); }
+	unsigned char startsWith(const String &prefix) const { return len >= prefix.len && strncmp(c_str(), prefix.c_str(), prefix.len) == 0; }
+	int indexOf(char c, unsigned int fromIndex = 0) const;
+	String substring(unsigned int beginIndex, unsigned int endIndex) const;
+	long toInt() const { return atol(c_str()); }
+
+	static String format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+private:
+	unsigned char append(const char *data, size_t dataLen);
+	void copy(const char *data, size_t dataLen);
+
+	char *buffer = NULL;
+	unsigned int capacity = 0;
+	unsigned int len = 0;
+};
+
+/**
+ * @brief Log output to stdout
+ *
+ * Every error is counted, so a test run fails if anything logged an error.
+ */
+class Logger {
+public:
+	void trace(const char *fmt, ...) const __attribute__((format(printf, 2, 3)));
+	void info(const char *fmt, ...) const __attribute__((format(printf, 2, 3)));
+	void warn(const char *fmt, ...) const __attribute__((format(printf, 2, 3)));
+	void error(const char *fmt, ...) const __attribute__((format(printf, 2, 3)));
+
+	/**
+	 * @brief Number of calls to error() so far
+	 */
+	int getErrorCount() const;
+};
+extern Logger Log;
+
+#define LOG_LEVEL_ALL 1
+#define LOG_LEVEL_TRACE 1
+#define LOG_LEVEL_INFO 30
+#define LOG_LEVEL_WARN 40
+#define LOG_LEVEL_ERROR 50
+
+class SerialLogHandler {
+public:
+	explicit SerialLogHandler(int level = LOG_LEVEL_INFO) {}
+};
+
+class USBSerial {
+public:
+	void begin(int baud = 9600) {}
+	void printlnf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	void println(const char *str) { puts(str); }
+};
+extern USBSerial Serial;
+
+#define SYSTEM_MODE(mode)
+#define SYSTEM_THREAD(state)
+
+class SystemClass {
+public:
+	/**
+	 * @brief Bytes not allocated out of a nominal 128K heap
+	 */
+	uint32_t freeMemory();
+};
+extern SystemClass System;
+
+/**
+ * @brief Heap allocations made since the program started
+ *
+ * Counted by replacements for operator new and delete, and by malloc, calloc, realloc, strdup, and
+ * free, which the host build links with --wrap. This lets tests and benchmarks count allocations,
+ * which Device OS can't do.
+ */
+struct HostAllocationCounts {
+	uint32_t allocations;
+	uint32_t frees;
+	uint64_t bytes;
+};
+
+#define HOST_ALLOCATION_COUNTS 1
+
+HostAllocationCounts hostGetAllocationCounts();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Threads and queues, implemented with the C++ standard library
+typedef void *os_queue_t;
+typedef int os_thread_prio_t;
+typedef void (*os_thread_fn_t)(void *param);
+
+#define OS_THREAD_PRIORITY_DEFAULT 2
+#define CONCURRENT_WAIT_FOREVER ((system_tick_t)-1)
+
+int os_queue_create(os_queue_t *queue, size_t itemSize, size_t length, void *reserved);
+int os_queue_destroy(os_queue_t queue, void *reserved);
+int os_queue_put(os_queue_t queue, const void *item, system_tick_t delay, void *reserved);
+int os_queue_take(os_queue_t queue, void *item, system_tick_t delay, void *reserved);
+
+class Thread {
+public:
+	Thread(const char *name, os_thread_fn_t function, void *param = NULL, os_thread_prio_t priority = OS_THREAD_PRIORITY_DEFAULT, size_t stackSize = 3072);
+	~Thread();
+
+	/**
+	 * @brief Returns true if the thread was created
+	 *
+	 * A stack size of 0 makes the creation fail, so the failure path can be tested.
+	 */
+	bool is_valid() const;
+
+	/**
+	 * @brief Returns true if the thread function has not returned
+	 */
+	bool isRunning() const;
+
+private:
+	struct Impl;
+	Impl *impl;
+};
+
+class Mutex : public std::mutex {
+};
+
+class RecursiveMutex : public std::recursive_mutex {
+};
+
+#define WITH_LOCK(lock) for (std::unique_lock<decltype(lock)> __lock##lock((lock)); __lock##lock; __lock##lock.unlock())
+
+/**
+ * @brief Held for the duration of a SINGLE_THREADED_BLOCK
+ *
+ * On the device, thread switching is disabled. Here, all single threaded blocks share one
+ * recursive mutex, which has the same effect for code that only shares data between threads
+ * inside these blocks.
+ */
+class SingleThreadedSection {
+public:
+	SingleThreadedSection();
+	~SingleThreadedSection();
+};
+
+#define SINGLE_THREADED_BLOCK() for (bool __todo = true; __todo; ) for (SingleThreadedSection __cs; __todo; __todo = false)
+
+// URC handlers
+typedef int (*hal_cellular_urc_callback_t)(int type, const char *buf, int len, void *param);
+
+int cellular_add_urc_handler(const char *prefix, hal_cellular_urc_callback_t cb, void *context);
+int cellular_remove_urc_handler(const char *prefix);
+
+/**
+ * @brief One callback's worth of scripted modem output
+ */
+struct HostModemChunk {
+	int type;
+	const char *data;
+};
+
+/**
+ * @brief Cellular with a scripted modem
+ *
+ * Each response is matched by the start of the command sent (for example, "AT+CSQ"). The chunks are
+ * passed to the Cellular.command callback in order, then the result is returned, which can be WAIT
+ * to simulate a timeout. If more than one response matches, the most recently added one is used.
+ * Commands with no matching response return RESP_OK with no output.
+ *
+ * Every command sent is recorded, so tests can check what the library sent to the modem.
+ */
+class HostCellular {
+public:
+	typedef int (*callback_t)(int type, const char *buf, int len, void *param);
+
+	template<typename T>
+	int command(int (*cb)(int type, const char *buf, int len, T *param), T *param, system_tick_t timeout, const char *format, ...) {
+		va_list ap;
+		va_start(ap, format);
+		int res = vcommand((callback_t)cb, (void *)param, timeout, format, ap);
+		va_end(ap);
+		return res;
+	}
+
+	int command(system_tick_t timeout, const char *format, ...);
+
+	int command(const char *format, ...);
+
+	/**
+	 * @brief Adds a scripted response
+	 *
+	 * @param commandPrefix The start of the command to respond to, such as "AT+CSQ".
+	 *
+	 * @param chunks The callback data. The array and strings are not copied and must remain valid.
+	 *
+	 * @param resp The result to return after the chunks.
+	 */
+	void addResponse(const char *commandPrefix, const HostModemChunk *chunks, size_t numChunks, int resp);
+
+	/**
+	 * @brief Removes the scripted responses and the recorded commands
+	 */
+	void reset();
+
+	/**
+	 * @brief Gets the commands sent since the last reset(), separated by |, without the line endings
+	 */
+	String getCommands() const;
+
+	/**
+	 * @brief Passes a URC to the handler added with cellular_add_urc_handler() for its prefix
+	 *
+	 * @return true if there was a handler.
+	 */
+	bool urc(int type, const char *data);
+
+	int vcommand(callback_t cb, void *param, system_tick_t timeout, const char *format, va_list ap);
+};
+extern HostCellular Cellular;
+
+#endif /* __PARTICLE_HOST_H */
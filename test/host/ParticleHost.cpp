@@ -0,0 +1,528 @@
+#include "Particle.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+#include <malloc.h>
+#include <new>
+
+Logger Log;
+USBSerial Serial;
+SystemClass System;
+HostCellular Cellular;
+
+static std::atomic<int> logErrorCount(0);
+
+static std::atomic<uint32_t> allocationCount(0);
+static std::atomic<uint32_t> freeCount(0);
+static std::atomic<uint64_t> allocatedBytes(0);
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// Nominal heap size for System.freeMemory()
+static const uint32_t HOST_HEAP_SIZE = 128 * 1024;
+
+unsigned char String::reserve(unsigned int size) {
+	if (buffer && capacity >= size) {
+		return 1;
+	}
+	char *newBuffer = (char *)realloc(buffer, size + 1);
+	if (!newBuffer) {
+		return 0;
+	}
+	if (!buffer) {
+		newBuffer[0] = 0;
+	}
+	buffer = newBuffer;
+	capacity = size;
+	return 1;
+}
+
+unsigned char String::append(const char *data, size_t dataLen) {
+	if (dataLen == 0) {
+		return 1;
+	}
+	// data can be inside buffer, as in str += str, and reserve can move the buffer
+	bool inBuffer = (buffer && data >= buffer && data < &buffer[len]);
+	size_t offset = inBuffer ? (size_t)(data - buffer) : 0;
+
+	if (!reserve(len + (unsigned int)dataLen)) {
+		return 0;
+	}
+	if (inBuffer) {
+		data = &buffer[offset];
+	}
+	memmove(&buffer[len], data, dataLen);
+	len += (unsigned int)dataLen;
+	buffer[len] = 0;
+	return 1;
+}
+
+void String::copy(const char *data, size_t dataLen) {
+	len = 0;
+	if (buffer) {
+		buffer[0] = 0;
+	}
+	append(data, dataLen);
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+	if (fromIndex >= len) {
+		return -1;
+	}
+	const char *found = strchr(&buffer[fromIndex], c);
+	return found ? (int)(found - buffer) : -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+	String result;
+	if (endIndex > len) {
+		endIndex = len;
+	}
+	if (beginIndex < endIndex) {
+		result.append(&buffer[beginIndex], endIndex - beginIndex);
+	}
+	return result;
+}
+
+// [static]
+String String::format(const char *fmt, ...) {
+	va_list ap;
+
+	va_start(ap, fmt);
+	int len = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+
+	String result;
+	if (len > 0 && result.reserve((unsigned int)len)) {
+		va_start(ap, fmt);
+		vsnprintf(result.buffer, len + 1, fmt, ap);
+		va_end(ap);
+
+		result.len = (unsigned int)len;
+	}
+	return result;
+}
+
+static void logOutput(const char *level, const char *fmt, va_list ap) {
+	char buf[1024];
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	printf("%010lu [app] %s: %s\n", millis(), level, buf);
+}
+
+void Logger::trace(const char *fmt, ...) const {
+	va_list ap;
+	va_start(ap, fmt);
+	logOutput("TRACE", fmt, ap);
+	va_end(ap);
+}
+
+void Logger::info(const char *fmt, ...) const {
+	va_list ap;
+	va_start(ap, fmt);
+	logOutput("INFO", fmt, ap);
+	va_end(ap);
+}
+
+void Logger::warn(const char *fmt, ...) const {
+	va_list ap;
+	va_start(ap, fmt);
+	logOutput("WARN", fmt, ap);
+	va_end(ap);
+}
+
+void Logger::error(const char *fmt, ...) const {
+	logErrorCount++;
+
+	va_list ap;
+	va_start(ap, fmt);
+	logOutput("ERROR", fmt, ap);
+	va_end(ap);
+}
+
+int Logger::getErrorCount() const {
+	return logErrorCount;
+}
+
+void USBSerial::printlnf(const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+uint32_t SystemClass::freeMemory() {
+	size_t used = mallinfo2().uordblks;
+	return (used < HOST_HEAP_SIZE) ? (uint32_t)(HOST_HEAP_SIZE - used) : 0;
+}
+
+HostAllocationCounts hostGetAllocationCounts() {
+	HostAllocationCounts counts;
+	counts.allocations = allocationCount;
+	counts.frees = freeCount;
+	counts.bytes = allocatedBytes;
+	return counts;
+}
+
+//
+// Allocation hooks
+//
+static void countAllocation(size_t size) {
+	allocationCount++;
+	allocatedBytes += size;
+}
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *str);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+	countAllocation(size);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size) {
+	countAllocation(num * size);
+	return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	// A realloc is counted as a new allocation, as it usually is one on the device
+	countAllocation(size);
+	if (ptr) {
+		freeCount++;
+	}
+	return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *str) {
+	countAllocation(strlen(str) + 1);
+	return __real_strdup(str);
+}
+
+void __wrap_free(void *ptr) {
+	if (ptr) {
+		freeCount++;
+	}
+	__real_free(ptr);
+}
+}
+
+// These call the real malloc and free directly, so an allocation isn't counted twice
+void *operator new(size_t size) {
+	countAllocation(size);
+	void *ptr = __real_malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	countAllocation(size);
+	return __real_malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept {
+	if (ptr) {
+		freeCount++;
+	}
+	__real_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept {
+	operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t size) noexcept {
+	operator delete(ptr);
+}
+
+unsigned long millis() {
+	return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+	return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+//
+// Queues
+//
+struct HostQueue {
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<std::string> items;
+	size_t itemSize;
+	size_t length;
+};
+
+// Waits for the predicate, with the same timeout values as the Device OS queue functions
+template<class Predicate>
+static bool waitFor(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, system_tick_t delay, Predicate pred) {
+	if (delay == CONCURRENT_WAIT_FOREVER) {
+		cond.wait(lock, pred);
+		return true;
+	}
+	return cond.wait_for(lock, std::chrono::milliseconds(delay), pred);
+}
+
+int os_queue_create(os_queue_t *queue, size_t itemSize, size_t length, void *reserved) {
+	if (itemSize == 0 || length == 0) {
+		*queue = NULL;
+		return -1;
+	}
+	HostQueue *q = new HostQueue();
+	q->itemSize = itemSize;
+	q->length = length;
+	*queue = q;
+	return 0;
+}
+
+int os_queue_destroy(os_queue_t queue, void *reserved) {
+	delete (HostQueue *)queue;
+	return 0;
+}
+
+int os_queue_put(os_queue_t queue, const void *item, system_tick_t delay, void *reserved) {
+	HostQueue *q = (HostQueue *)queue;
+
+	std::unique_lock<std::mutex> lock(q->mutex);
+	if (!waitFor(lock, q->changed, delay, [q] { return q->items.size() < q->length; })) {
+		return -1;
+	}
+	q->items.push_back(std::string((const char *)item, q->itemSize));
+	q->changed.notify_all();
+	return 0;
+}
+
+int os_queue_take(os_queue_t queue, void *item, system_tick_t delay, void *reserved) {
+	HostQueue *q = (HostQueue *)queue;
+
+	std::unique_lock<std::mutex> lock(q->mutex);
+	if (!waitFor(lock, q->changed, delay, [q] { return !q->items.empty(); })) {
+		return -1;
+	}
+	memcpy(item, q->items.front().data(), q->itemSize);
+	q->items.pop_front();
+	q->changed.notify_all();
+	return 0;
+}
+
+//
+// Threads
+//
+struct Thread::Impl {
+	std::thread thread;
+	std::atomic<bool> running;
+};
+
+Thread::Thread(const char *name, os_thread_fn_t function, void *param, os_thread_prio_t priority, size_t stackSize) : impl(new Impl()) {
+	Impl *threadImpl = impl;
+
+	if (stackSize == 0) {
+		threadImpl->running = false;
+		return;
+	}
+	threadImpl->running = true;
+	threadImpl->thread = std::thread([threadImpl, function, param] {
+		function(param);
+		threadImpl->running = false;
+	});
+}
+
+Thread::~Thread() {
+	// Device OS threads run forever, so they're detached rather than joined
+	if (impl->thread.joinable()) {
+		impl->thread.detach();
+	}
+	delete impl;
+}
+
+bool Thread::is_valid() const {
+	return impl->thread.joinable();
+}
+
+bool Thread::isRunning() const {
+	return impl->running;
+}
+
+static std::recursive_mutex &singleThreadedMutex() {
+	static std::recursive_mutex mutex;
+	return mutex;
+}
+
+SingleThreadedSection::SingleThreadedSection() {
+	singleThreadedMutex().lock();
+}
+
+SingleThreadedSection::~SingleThreadedSection() {
+	singleThreadedMutex().unlock();
+}
+
+//
+// Scripted modem
+//
+struct HostModemResponse {
+	std::string commandPrefix;
+	const HostModemChunk *chunks;
+	size_t numChunks;
+	int resp;
+};
+
+struct HostUrcHandler {
+	std::string prefix;
+	hal_cellular_urc_callback_t cb;
+	void *context;
+};
+
+// Held while a command or URC is processed, as the modem is on the device
+static std::recursive_mutex &modemMutex() {
+	static std::recursive_mutex mutex;
+	return mutex;
+}
+
+static std::vector<HostModemResponse> modemResponses;
+static std::vector<HostUrcHandler> urcHandlers;
+static std::string sentCommands;
+
+int cellular_add_urc_handler(const char *prefix, hal_cellular_urc_callback_t cb, void *context) {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	for(size_t ii = 0; ii < urcHandlers.size(); ii++) {
+		if (urcHandlers[ii].prefix == prefix) {
+			// Device OS only allows one handler per prefix
+			return -1;
+		}
+	}
+	HostUrcHandler handler = { prefix, cb, context };
+	urcHandlers.push_back(handler);
+	return 0;
+}
+
+int cellular_remove_urc_handler(const char *prefix) {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	for(size_t ii = 0; ii < urcHandlers.size(); ii++) {
+		if (urcHandlers[ii].prefix == prefix) {
+			urcHandlers.erase(urcHandlers.begin() + ii);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+int HostCellular::command(system_tick_t timeout, const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	int res = vcommand(NULL, NULL, timeout, format, ap);
+	va_end(ap);
+	return res;
+}
+
+int HostCellular::command(const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	int res = vcommand(NULL, NULL, 10000, format, ap);
+	va_end(ap);
+	return res;
+}
+
+int HostCellular::vcommand(callback_t cb, void *param, system_tick_t timeout, const char *format, va_list ap) {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	char cmd[1024];
+	vsnprintf(cmd, sizeof(cmd), format, ap);
+
+	std::string sent(cmd);
+	while(!sent.empty() && (sent[sent.size() - 1] == '\r' || sent[sent.size() - 1] == '\n')) {
+		sent.erase(sent.size() - 1);
+	}
+	if (!sentCommands.empty()) {
+		sentCommands += '|';
+	}
+	sentCommands += sent;
+
+	for(size_t ii = modemResponses.size(); ii-- > 0; ) {
+		const HostModemResponse &response = modemResponses[ii];
+		if (sent.compare(0, response.commandPrefix.size(), response.commandPrefix) != 0) {
+			continue;
+		}
+
+		if (cb) {
+			for(size_t jj = 0; jj < response.numChunks; jj++) {
+				const HostModemChunk &chunk = response.chunks[jj];
+
+				int res = cb(chunk.type, chunk.data, (int)strlen(chunk.data), param);
+				if (res != WAIT) {
+					return res;
+				}
+			}
+		}
+		return response.resp;
+	}
+	return RESP_OK;
+}
+
+void HostCellular::addResponse(const char *commandPrefix, const HostModemChunk *chunks, size_t numChunks, int resp) {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	HostModemResponse response = { commandPrefix, chunks, numChunks, resp };
+	modemResponses.push_back(response);
+}
+
+void HostCellular::reset() {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	modemResponses.clear();
+	sentCommands.clear();
+}
+
+String HostCellular::getCommands() const {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	return String(sentCommands.c_str());
+}
+
+bool HostCellular::urc(int type, const char *data) {
+	std::lock_guard<std::recursive_mutex> lock(modemMutex());
+
+	// The prefix is matched after the leading CR LF, as the modem driver does
+	const char *start = data;
+	while(*start == '\r' || *start == '\n') {
+		start++;
+	}
+
+	for(size_t ii = 0; ii < urcHandlers.size(); ii++) {
+		const HostUrcHandler &handler = urcHandlers[ii];
+		size_t prefixLen = handler.prefix.size();
+		if (strncmp(start, handler.prefix.c_str(), prefixLen) == 0 && start[prefixLen] == ':') {
+			handler.cb(type, data, (int)strlen(data), handler.context);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,9 @@
+#include "FuzzModem.h"
+
+// The combined command sent by CellularHelper.getDiagnostics()
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperDiagnostics diag;
+	CellularHelperBatchResponse resp(diag, CellularHelperDiagnostics::FIELD_ALL);
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	return 0;
+}
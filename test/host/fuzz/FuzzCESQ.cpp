@@ -0,0 +1,11 @@
+#include "FuzzModem.h"
+
+// AT+CESQ
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperExtendedQualResponse resp;
+	resp.command = "CESQ";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.postProcess();
+	resp.toString();
+	return 0;
+}
@@ -0,0 +1,11 @@
+#include "FuzzModem.h"
+
+// AT+CREG?
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperCREGResponse resp;
+	resp.command = "CREG";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.postProcess();
+	resp.toString();
+	return 0;
+}
@@ -0,0 +1,12 @@
+#include "FuzzModem.h"
+
+// AT+CSQ
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperRSSIQualResponse resp;
+	resp.command = "CSQ";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.postProcess();
+	CellularHelperClass::rssiToBars(resp.rssi);
+	resp.toString();
+	return 0;
+}
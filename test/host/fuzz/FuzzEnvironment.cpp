@@ -0,0 +1,14 @@
+#include "FuzzModem.h"
+
+// AT+CGED=5 and AT+CGED=3
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperEnvironmentResponseStatic<4> resp;
+	resp.command = "CGED";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.service.toString();
+	resp.service.getLTEDownlinkFrequency();
+	for(size_t ii = 0; ii < resp.getNumNeighbors(); ii++) {
+		resp.neighbors[ii].toString();
+	}
+	return 0;
+}
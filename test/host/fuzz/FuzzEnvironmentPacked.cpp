@@ -0,0 +1,15 @@
+#include "FuzzModem.h"
+
+// AT+COPS=5, with the neighbors packed
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperEnvironmentResponsePackedStatic<4> resp;
+	resp.command = "COPS";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+
+	CellularHelperEnvironmentCellData cell;
+	for(size_t ii = 0; ii < resp.getNumNeighbors(); ii++) {
+		resp.getNeighbor(ii, cell);
+		cell.toString();
+	}
+	return 0;
+}
@@ -0,0 +1,11 @@
+#include "FuzzModem.h"
+
+// AT+ULOC and the +UULOC URC
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperLocationResponse resp;
+	resp.command = "UULOC";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.postProcess();
+	resp.toString();
+	return 0;
+}
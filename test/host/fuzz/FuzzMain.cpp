@@ -0,0 +1,89 @@
+#include "FuzzModem.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Runs LLVMFuzzerTestOneInput on each file, and each file in each directory, on the command
+// line. This is used instead of libFuzzer when the compiler doesn't support it, to check that
+// the corpus still runs cleanly (under the sanitizers with -DCELLULARHELPER_SANITIZE=ON).
+
+static unsigned long numInputs = 0;
+
+static bool runFile(const std::string &path) {
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp) {
+		Log.error("could not open %s", path.c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	uint8_t buf[512];
+	size_t count;
+	while((count = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		data.insert(data.end(), buf, buf + count);
+	}
+	fclose(fp);
+
+	// Copied so the input is exactly its size on the heap, as libFuzzer does
+	uint8_t *input = (uint8_t *) malloc(data.size() ? data.size() : 1);
+	if (!data.empty()) {
+		memcpy(input, &data[0], data.size());
+	}
+	LLVMFuzzerTestOneInput(input, data.size());
+	free(input);
+
+	numInputs++;
+	return true;
+}
+
+static bool runPath(const std::string &path) {
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) {
+		Log.error("%s not found", path.c_str());
+		return false;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		return runFile(path);
+	}
+
+	DIR *dir = opendir(path.c_str());
+	if (!dir) {
+		Log.error("could not open %s", path.c_str());
+		return false;
+	}
+
+	std::vector<std::string> names;
+	struct dirent *ent;
+	while((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] != '.') {
+			names.push_back(ent->d_name);
+		}
+	}
+	closedir(dir);
+
+	bool result = true;
+	for(size_t ii = 0; ii < names.size(); ii++) {
+		if (!runFile(path + "/" + names[ii])) {
+			result = false;
+		}
+	}
+	return result;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		printf("usage: %s corpus_dir_or_file...\n", argv[0]);
+		return 2;
+	}
+
+	for(int ii = 1; ii < argc; ii++) {
+		runPath(argv[ii]);
+	}
+
+	if (numInputs == 0) {
+		Log.error("no inputs");
+	}
+	Log.info("%s: %lu inputs", argv[0], numInputs);
+
+	return (Log.getErrorCount() == 0) ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include "FuzzModem.h"
+
+// Gets the Cellular.command callback type for a line, from the first characters after the CR LF
+static int getLineType(const char *line, size_t len) {
+	size_t ii = 0;
+	while(ii < len && (line[ii] == '\r' || line[ii] == '\n')) {
+		ii++;
+	}
+
+	const char *start = &line[ii];
+	size_t remaining = len - ii;
+
+	if (remaining >= 1 && start[0] == '+') {
+		return TYPE_PLUS;
+	}
+	else
+	if (remaining >= 2 && strncmp(start, "OK", 2) == 0) {
+		return TYPE_OK;
+	}
+	else
+	if (remaining >= 5 && strncmp(start, "ERROR", 5) == 0) {
+		return TYPE_ERROR;
+	}
+	return TYPE_UNKNOWN;
+}
+
+int fuzzModemOutput(const uint8_t *data, size_t size, int (*callback)(int type, const char *buf, int len, void *param), void *param) {
+	int res = RESP_OK;
+
+	size_t offset = 0;
+	while(offset < size) {
+		// A line is the leading CR LF characters, the text, then the trailing CR LF
+		size_t end = offset;
+		while(end < size && (data[end] == '\r' || data[end] == '\n')) {
+			end++;
+		}
+		while(end < size && data[end] != '\r' && data[end] != '\n') {
+			end++;
+		}
+		if (end < size && data[end] == '\r') {
+			end++;
+		}
+		if (end < size && data[end] == '\n') {
+			end++;
+		}
+
+		size_t len = end - offset;
+		char *line = (char *) malloc(len);
+		memcpy(line, &data[offset], len);
+
+		res = callback(getLineType(line, len), line, (int)len, param);
+		free(line);
+
+		if (res != WAIT) {
+			break;
+		}
+		offset = end;
+	}
+	return res;
+}
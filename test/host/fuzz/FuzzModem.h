@@ -0,0 +1,36 @@
+#ifndef __FUZZMODEM_H
+#define __FUZZMODEM_H
+
+// Shared code for the fuzz targets in this directory. Each target is a libFuzzer entry point
+// (LLVMFuzzerTestOneInput) for one parser. The input is modem output, as in the files in corpus,
+// which fuzzModemOutput() splits into lines and passes to the Cellular.command callback.
+//
+// Built with -DCELLULARHELPER_LIBFUZZER=ON (clang), each target is a libFuzzer binary. Otherwise
+// FuzzMain.cpp runs each target over its corpus, which is what ctest does.
+
+#include "Particle.h"
+#include "CellularHelper.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/**
+ * @brief Passes modem output to a Cellular.command callback one line at a time, as the modem does
+ *
+ * @param data The modem output. It does not need to be null terminated.
+ *
+ * @param size The number of bytes in data.
+ *
+ * @param callback The callback, such as CellularHelperClass::responseCallback.
+ *
+ * @param param The parameter passed to the callback, usually the response object.
+ *
+ * Each line, including its leading and trailing CR LF, is copied to its own heap buffer of exactly
+ * the line length, so AddressSanitizer catches a parser that reads past the end. Lines that start
+ * with + are TYPE_PLUS, OK is TYPE_OK, ERROR is TYPE_ERROR, and everything else is TYPE_UNKNOWN.
+ * Stops early if the callback returns something other than WAIT, as Cellular.command does.
+ *
+ * @return The last value returned by the callback, or RESP_OK if there were no lines.
+ */
+int fuzzModemOutput(const uint8_t *data, size_t size, int (*callback)(int type, const char *buf, int len, void *param), void *param);
+
+#endif /* __FUZZMODEM_H */
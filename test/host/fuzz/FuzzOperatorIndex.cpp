@@ -0,0 +1,9 @@
+#include "FuzzModem.h"
+
+// AT+COPN
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperOperatorIndexStatic<4, 32> resp;
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.getOperatorName(310, 410);
+	return 0;
+}
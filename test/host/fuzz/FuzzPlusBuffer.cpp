@@ -0,0 +1,9 @@
+#include "FuzzModem.h"
+
+// +responses saved to a fixed size buffer
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperPlusBufferResponseStatic<8> resp;
+	resp.setCommand("CSQ");
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	return 0;
+}
@@ -0,0 +1,10 @@
+#include "FuzzModem.h"
+
+// AT+UDOPN and other commands with a +response
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperPlusStringResponse resp;
+	resp.command = "UDOPN";
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	resp.getDoubleQuotedPart();
+	return 0;
+}
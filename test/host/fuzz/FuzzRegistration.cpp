@@ -0,0 +1,21 @@
+#include "FuzzModem.h"
+#include "CellularHelperRegistrationMonitor.h"
+
+#if CELLULARHELPER_ENABLE_URC
+// Exposes the URC handler so it can be fuzzed without the modem
+class FuzzRegistrationMonitor : public CellularHelperRegistrationMonitorClass {
+public:
+	using CellularHelperRegistrationMonitorClass::urcCallback;
+};
+#endif
+
+// The +CREG and +CEREG URCs, as handled by CellularHelperRegistrationMonitor
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+#if CELLULARHELPER_ENABLE_URC
+	FuzzRegistrationMonitor monitor;
+	fuzzModemOutput(data, size, FuzzRegistrationMonitor::urcCallback, (void *)&monitor);
+	monitor.getRegistration();
+	monitor.getCREG();
+#endif
+	return 0;
+}
@@ -0,0 +1,8 @@
+#include "FuzzModem.h"
+
+// AT+CGMI and other commands with a plain text response
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	CellularHelperStringResponse resp;
+	fuzzModemOutput(data, size, CellularHelperClass::responseCallback, (void *)&resp);
+	return 0;
+}
@@ -0,0 +1,133 @@
+#!/usr/bin/env node
+// Decodes the binary environment data from CellularHelperEnvironmentEncoder
+//
+// Usage:
+//   node decode-environment.js <base64>
+//   echo <base64> | node decode-environment.js
+//
+// Outputs a JSON array of cells. The first is the service cell; the rest are neighbors.
+// See CellularHelperEnvironmentEncoder.h for a description of the format.
+
+const VERSION = 1;
+
+const RAT_GSM = 0;
+const RAT_UMTS = 1;
+const RAT_LTE = 2;
+
+const FLAG_RAT_MASK = 0x03;
+const FLAG_MCC = 0x04;
+const FLAG_MNC = 0x08;
+const FLAG_LAC = 0x10;
+const FLAG_CI = 0x20;
+
+function decodeEnvironment(buf) {
+    let offset = 0;
+
+    function getByte() {
+        if (offset >= buf.length) {
+            throw new Error('data truncated at offset ' + offset);
+        }
+        return buf[offset++];
+    }
+
+    function getVarint() {
+        // Uses multiplication instead of shifts so values over 2^31 stay positive
+        let value = 0;
+        for (let mult = 1; mult < 0x800000000; mult *= 128) {
+            const b = getByte();
+            value += (b & 0x7f) * mult;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw new Error('invalid varint at offset ' + offset);
+    }
+
+    function getZigzag() {
+        const value = getVarint();
+        return (value % 2) ? -(value + 1) / 2 : value / 2;
+    }
+
+    // Values are 32-bit on the device, so deltas wrap
+    function addDelta(prev, delta) {
+        return ((prev + delta) | 0);
+    }
+
+    const version = getByte();
+    if (version != VERSION) {
+        throw new Error('unsupported version ' + version);
+    }
+
+    const numCells = getVarint();
+
+    let prev = { mcc: 0, mnc: 0, lac: 0, ci: 0 };
+    let cells = [];
+
+    for (let ii = 0; ii < numCells; ii++) {
+        const flags = getByte();
+        const rat = flags & FLAG_RAT_MASK;
+
+        let cell = {};
+        cell.mcc = (flags & FLAG_MCC) ? addDelta(prev.mcc, getZigzag()) : prev.mcc;
+        cell.mnc = (flags & FLAG_MNC) ? addDelta(prev.mnc, getZigzag()) : prev.mnc;
+        cell.lac = (flags & FLAG_LAC) ? addDelta(prev.lac, getZigzag()) : prev.lac;
+        cell.ci = (flags & FLAG_CI) ? addDelta(prev.ci, getZigzag()) : prev.ci;
+        prev = Object.assign({}, cell);
+
+        switch (rat) {
+            case RAT_GSM:
+                cell.rat = 'GSM';
+                cell.arfcn = getVarint();
+                cell.bsic = getByte();
+                cell.rxlev = getByte();
+                cell.rssi = (cell.rxlev <= 96) ? -121 + cell.rxlev : 0;
+                break;
+
+            case RAT_UMTS:
+                cell.rat = 'UMTS';
+                cell.dlf = getVarint();
+                cell.ulf = getVarint();
+                cell.rscpLev = getByte();
+                cell.rssi = (cell.rscpLev <= 96) ? -121 + cell.rscpLev : 0;
+                break;
+
+            case RAT_LTE:
+                cell.rat = 'LTE';
+                cell.earfcn = getVarint() - 1;
+                cell.rxlev = getByte();
+                cell.rssi = (cell.rxlev <= 96) ? -121 + cell.rxlev : 0;
+                break;
+
+            default:
+                throw new Error('invalid RAT ' + rat);
+        }
+
+        cell.lacHex = cell.lac.toString(16);
+        cell.ciHex = cell.ci.toString(16);
+        cells.push(cell);
+    }
+
+    return cells;
+}
+
+module.exports = { decodeEnvironment };
+
+if (require.main === module) {
+    const decode = function(str) {
+        const cells = decodeEnvironment(Buffer.from(str.trim(), 'base64'));
+        console.log(JSON.stringify(cells, null, 2));
+    };
+
+    if (process.argv.length > 2) {
+        decode(process.argv[2]);
+    }
+    else {
+        let input = '';
+        process.stdin.on('data', function(data) {
+            input += data;
+        });
+        process.stdin.on('end', function() {
+            decode(input);
+        });
+    }
+}
@@ -0,0 +1,203 @@
+#!/usr/bin/env node
+// Generates a cell location table for CellularHelperCellLocationDB from an OpenCellID format CSV file
+//
+// Usage:
+//   node generate-cell-db.js <cells.csv> <cells.bin> [--cpp cells.cpp] [--name cellDB] [--mcc 310,311]
+//
+// The CSV file has the OpenCellID columns: radio,mcc,net,area,cell,unit,lon,lat,range,samples,...
+// If the first line is a header, the columns are found by name, so other column orders work too.
+// The full OpenCellID file is millions of cells, so use --mcc to only include some countries.
+//
+// --cpp also writes the table as a const array named by --name (default cellularHelperCellDB), with
+// a size_t <name>Size, that you can add to your project so the table is stored in flash.
+//
+// See CellularHelperCellLocationDB.h for a description of the format.
+
+const fs = require('fs');
+const readline = require('readline');
+
+const MAGIC = 'CHCL';
+const VERSION = 1;
+const HEADER_SIZE = 16;
+const KEY_SIZE = 8;
+const VALUE_SIZE = 12;
+
+// Number of skipped line numbers to report
+const MAX_SKIPPED_LINES = 10;
+
+const DEFAULT_COLUMNS = ['radio', 'mcc', 'net', 'area', 'cell', 'unit', 'lon', 'lat', 'range', 'samples'];
+
+function usage() {
+    console.error('usage: node generate-cell-db.js <cells.csv> <cells.bin> [--cpp cells.cpp] [--name cellDB] [--mcc 310,311]');
+    process.exit(1);
+}
+
+let csvPath;
+let binPath;
+let cppPath;
+let name = 'cellularHelperCellDB';
+let mccFilter;
+
+for (let ii = 2; ii < process.argv.length; ii++) {
+    const arg = process.argv[ii];
+    if (arg == '--cpp' && ii + 1 < process.argv.length) {
+        cppPath = process.argv[++ii];
+    }
+    else if (arg == '--name' && ii + 1 < process.argv.length) {
+        name = process.argv[++ii];
+    }
+    else if (arg == '--mcc' && ii + 1 < process.argv.length) {
+        mccFilter = new Set(process.argv[++ii].split(',').map(function(mcc) { return parseInt(mcc, 10); }));
+    }
+    else if (!csvPath) {
+        csvPath = arg;
+    }
+    else if (!binPath) {
+        binPath = arg;
+    }
+    else {
+        usage();
+    }
+}
+if (!csvPath || !binPath) {
+    usage();
+}
+
+async function readCells() {
+    // Keyed by mcc/mnc/lac/ci. The same cell can be listed more than once (for example, for
+    // different radio types); the one with the most samples is kept.
+    let cells = new Map();
+    let columns;
+    let lineNum = 0;
+    let numSkipped = 0;
+    // Line numbers of the first few skipped lines, so the bad data can be found in the CSV file
+    let skippedLines = [];
+
+    const rl = readline.createInterface({ input: fs.createReadStream(csvPath), crlfDelay: Infinity });
+    for await (const line of rl) {
+        lineNum++;
+        if (line.trim() == '') {
+            continue;
+        }
+        const fields = line.split(',');
+
+        if (!columns) {
+            if (fields[0].trim().toLowerCase() == 'radio') {
+                columns = fields.map(function(field) { return field.trim().toLowerCase(); });
+                continue;
+            }
+            columns = DEFAULT_COLUMNS;
+        }
+
+        let row = {};
+        for (let jj = 0; jj < columns.length && jj < fields.length; jj++) {
+            row[columns[jj]] = fields[jj];
+        }
+
+        const mcc = parseInt(row.mcc, 10);
+        const mnc = parseInt(row.net, 10);
+        const lac = parseInt(row.area, 10);
+        const ci = parseInt(row.cell, 10);
+        const lat = parseFloat(row.lat);
+        const lon = parseFloat(row.lon);
+        const range = parseInt(row.range, 10) || 0;
+        const samples = parseInt(row.samples, 10) || 0;
+
+        if (!(mcc >= 0 && mcc <= 999 && mnc >= 0 && mnc <= 999 && lac >= 0 && lac <= 0xffff &&
+            ci >= 0 && ci <= 0xfffffff && lat >= -90 && lat <= 90 && lon >= -180 && lon <= 180)) {
+            numSkipped++;
+            if (skippedLines.length < MAX_SKIPPED_LINES) {
+                skippedLines.push(lineNum);
+            }
+            continue;
+        }
+        if (mccFilter && !mccFilter.has(mcc)) {
+            continue;
+        }
+
+        const id = mcc + '/' + mnc + '/' + lac + '/' + ci;
+        const prev = cells.get(id);
+        if (!prev || samples > prev.samples) {
+            cells.set(id, { mcc, mnc, lac, ci, lat, lon, range, samples });
+        }
+    }
+
+    if (numSkipped) {
+        console.error('skipped ' + numSkipped + ' lines with values out of range (line ' + skippedLines.join(', ') +
+            ((numSkipped > skippedLines.length) ? ', ...)' : ')'));
+    }
+    return Array.from(cells.values());
+}
+
+function writeTable(cells) {
+    // Sorting by each field in turn is the same order as the 64-bit key
+    cells.sort(function(a, b) {
+        return (a.mcc - b.mcc) || (a.mnc - b.mnc) || (a.lac - b.lac) || (a.ci - b.ci);
+    });
+
+    const numCells = cells.length;
+    const keysOffset = HEADER_SIZE;
+    const valuesOffset = keysOffset + numCells * KEY_SIZE;
+    let buf = Buffer.alloc(valuesOffset + numCells * VALUE_SIZE);
+
+    buf.write(MAGIC, 0, 'latin1');
+    buf.writeUInt16LE(VERSION, 4);
+    buf.writeUInt16LE(VALUE_SIZE, 6);
+    buf.writeUInt32LE(numCells, 8);
+    buf.writeUInt32LE(0, 12);
+
+    for (let ii = 0; ii < numCells; ii++) {
+        const cell = cells[ii];
+
+        // mcc in bits 54 - 63, mnc in 44 - 53, lac in 28 - 43, ci in 0 - 27, written as two 32-bit halves
+        const high = (cell.mcc * 1024 + cell.mnc) * 4096 + Math.floor(cell.lac / 16);
+        const low = (cell.lac % 16) * 0x10000000 + cell.ci;
+        buf.writeUInt32LE(low, keysOffset + ii * KEY_SIZE);
+        buf.writeUInt32LE(high, keysOffset + ii * KEY_SIZE + 4);
+
+        const offset = valuesOffset + ii * VALUE_SIZE;
+        buf.writeInt32LE(Math.round(cell.lat * 10000000), offset);
+        buf.writeInt32LE(Math.round(cell.lon * 10000000), offset + 4);
+        buf.writeUInt16LE(Math.min(Math.max(cell.range, 0), 65535), offset + 8);
+        buf.writeUInt16LE(Math.min(Math.max(cell.samples, 0), 65535), offset + 10);
+    }
+    return buf;
+}
+
+function cppSource(buf) {
+    let out = '';
+    out += '// Generated by tools/generate-cell-db.js. Do not edit.\n';
+    out += '\n';
+    out += '#include "Particle.h"\n';
+    out += '\n';
+    out += 'extern const uint8_t ' + name + '[];\n';
+    out += 'extern const size_t ' + name + 'Size;\n';
+    out += '\n';
+    out += 'const uint8_t ' + name + '[] = {\n';
+    for (let ii = 0; ii < buf.length; ii += 16) {
+        let bytes = [];
+        for (let jj = ii; jj < ii + 16 && jj < buf.length; jj++) {
+            bytes.push('0x' + ('0' + buf[jj].toString(16)).slice(-2));
+        }
+        out += '\t' + bytes.join(', ') + ',\n';
+    }
+    out += '};\n';
+    out += '\n';
+    out += 'const size_t ' + name + 'Size = sizeof(' + name + ');\n';
+    return out;
+}
+
+readCells().then(function(cells) {
+    const buf = writeTable(cells);
+
+    fs.writeFileSync(binPath, buf);
+    console.log('wrote ' + cells.length + ' cells, ' + buf.length + ' bytes to ' + binPath);
+
+    if (cppPath) {
+        fs.writeFileSync(cppPath, cppSource(buf));
+        console.log('wrote ' + cppPath);
+    }
+}).catch(function(err) {
+    console.error(err.message);
+    process.exit(1);
+});
@@ -0,0 +1,152 @@
+#!/usr/bin/env node
+// Generates src/CellularHelperOperatorDBData.cpp from a CSV file of operators
+//
+// Usage:
+//   node generate-operator-db.js [operators.csv] [CellularHelperOperatorDBData.cpp]
+//
+// The defaults are operators.csv in this directory and src/CellularHelperOperatorDBData.cpp.
+// The CSV file has a header row, then mcc,mnc,name on each line. The name can be in
+// double quotes if it contains a comma.
+
+const fs = require('fs');
+const path = require('path');
+
+const csvPath = process.argv[2] || path.join(__dirname, 'operators.csv');
+const outPath = process.argv[3] || path.join(__dirname, '..', 'src', 'CellularHelperOperatorDBData.cpp');
+
+function parseCsvLine(line) {
+    let fields = [];
+    let field = '';
+    let inQuotes = false;
+
+    for (let ii = 0; ii < line.length; ii++) {
+        const c = line.charAt(ii);
+        if (inQuotes) {
+            if (c == '"' && line.charAt(ii + 1) == '"') {
+                field += '"';
+                ii++;
+            }
+            else if (c == '"') {
+                inQuotes = false;
+            }
+            else {
+                field += c;
+            }
+        }
+        else if (c == '"') {
+            inQuotes = true;
+        }
+        else if (c == ',') {
+            fields.push(field);
+            field = '';
+        }
+        else {
+            field += c;
+        }
+    }
+    fields.push(field);
+    return fields;
+}
+
+function cString(str) {
+    // Escape as octal so the following character can't be taken as part of the escape
+    let result = '';
+    for (const b of Buffer.from(str, 'utf8')) {
+        if (b == 0x22 || b == 0x5c) {
+            result += '\\' + String.fromCharCode(b);
+        }
+        else if (b < 0x20 || b >= 0x7f) {
+            result += '\\' + ('00' + b.toString(8)).slice(-3);
+        }
+        else {
+            result += String.fromCharCode(b);
+        }
+    }
+    return result;
+}
+
+const lines = fs.readFileSync(csvPath, 'utf8').split(/\r?\n/);
+
+let operators = [];
+for (let ii = 1; ii < lines.length; ii++) {
+    if (lines[ii].trim() == '') {
+        continue;
+    }
+    const fields = parseCsvLine(lines[ii]);
+    const mcc = parseInt(fields[0], 10);
+    const mnc = parseInt(fields[1], 10);
+    const name = (fields[2] || '').trim();
+
+    if (isNaN(mcc) || mcc < 0 || mcc > 999 || isNaN(mnc) || mnc < 0 || mnc > 999 || name == '') {
+        console.error(csvPath + ':' + (ii + 1) + ': invalid line ' + lines[ii]);
+        process.exit(1);
+    }
+    operators.push({ mcc, mnc, name });
+}
+
+operators.sort(function(a, b) {
+    return (a.mcc - b.mcc) || (a.mnc - b.mnc);
+});
+
+for (let ii = 1; ii < operators.length; ii++) {
+    if (operators[ii].mcc == operators[ii - 1].mcc && operators[ii].mnc == operators[ii - 1].mnc) {
+        console.error('duplicate operator ' + operators[ii].mcc + ' ' + operators[ii].mnc);
+        process.exit(1);
+    }
+}
+
+// Each distinct name is stored once in the pool
+let nameOffsets = {};
+let poolLines = [];
+let poolSize = 0;
+for (const op of operators) {
+    if (nameOffsets[op.name] === undefined) {
+        nameOffsets[op.name] = poolSize;
+        poolLines.push('\t"' + cString(op.name) + '\\0"');
+        poolSize += Buffer.byteLength(op.name, 'utf8') + 1;
+    }
+}
+if (poolSize > 65535) {
+    console.error('name pool is too large');
+    process.exit(1);
+}
+
+let out = '';
+out += '// Generated by tools/generate-operator-db.js from tools/operators.csv. Do not edit.\n';
+out += '\n';
+out += '#include "Particle.h"\n';
+out += '\n';
+out += '#include "CellularHelperOperatorDB.h"\n';
+out += '\n';
+out += '#if Wiring_Cellular\n';
+out += '\n';
+out += 'constexpr char cellularHelperOperatorDBNames[] =\n';
+out += poolLines.join('\n') + ';\n';
+out += '\n';
+out += 'constexpr CellularHelperOperatorDBEntry cellularHelperOperatorDBEntries[] = {\n';
+for (const op of operators) {
+    out += '\t{ ' + op.mcc + ', ' + op.mnc + ', ' + nameOffsets[op.name] + ' },\t// ' + op.name + '\n';
+}
+out += '};\n';
+out += '\n';
+out += 'constexpr size_t cellularHelperOperatorDBNumEntries = sizeof(cellularHelperOperatorDBEntries) / sizeof(cellularHelperOperatorDBEntries[0]);\n';
+out += '\n';
+out += '// getOperatorName() uses a binary search, so make sure the table is sorted. This splits the\n';
+out += '// range in half rather than checking one pair per call to stay within the constexpr recursion limit.\n';
+out += 'static constexpr bool operatorDBLess(size_t index) {\n';
+out += '\treturn (cellularHelperOperatorDBEntries[index].mcc < cellularHelperOperatorDBEntries[index + 1].mcc) ||\n';
+out += '\t\t(cellularHelperOperatorDBEntries[index].mcc == cellularHelperOperatorDBEntries[index + 1].mcc &&\n';
+out += '\t\t cellularHelperOperatorDBEntries[index].mnc < cellularHelperOperatorDBEntries[index + 1].mnc);\n';
+out += '}\n';
+out += 'static constexpr bool operatorDBIsSorted(size_t first, size_t last) {\n';
+out += '\treturn (last - first < 2) ||\n';
+out += '\t\t(operatorDBLess(first + (last - first) / 2 - 1) &&\n';
+out += '\t\t operatorDBIsSorted(first, first + (last - first) / 2) &&\n';
+out += '\t\t operatorDBIsSorted(first + (last - first) / 2, last));\n';
+out += '}\n';
+out += 'static_assert(operatorDBIsSorted(0, cellularHelperOperatorDBNumEntries), "cellularHelperOperatorDBEntries must be sorted by mcc then mnc");\n';
+out += '\n';
+out += '#endif /* Wiring_Cellular */\n';
+
+fs.writeFileSync(outPath, out);
+console.log('wrote ' + operators.length + ' operators, ' + poolSize + ' bytes of names to ' + outPath);